@@ -0,0 +1,1157 @@
+// *****************************************************************************
+// ** Maze Generation and Path Discovery Benchmarks                             **
+// *****************************************************************************
+
+// Benchmarks for the data structures and hot paths of the maze program.
+//
+// Build and run:
+//     g++ -O2 -std=c++17 -pthread Benchmark.cpp -o benchmark
+//     ./benchmark [max_threads]                   readable tables of every benchmark
+//     ./benchmark --json results.json [--quick]   the fixed suite below, as JSON
+//
+// The JSON suite runs every hot path over a fixed matrix of maze shapes (square, 1xN and Nx1)
+// with fixed seeds, so the files of two commits can be compared line by line.
+//
+// The stack benchmark compares the contiguous Stack from Stack.h (heap backed, reserved up
+// front and arena backed) with the linked-list stack the program used before, which is kept
+// below as LinkedListStack only for this comparison.
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include "Stack.h"
+#include "MazeGrid.h"
+#include "MazeRandom.h"
+#include "MazeGeneration.h"
+#include "WorkStealing.h"
+#include "TiledGenerator.h"
+#include "MazeSolver.h"
+#include "MazeFloodSolver.h"
+#include "MazeExternalSolver.h"
+#include "MazeTreeIndex.h"
+#include "MazePipeline.h"
+#include "MazeValidator.h"
+#include "MazeAnalytics.h"
+#include "MazeEditor.h"
+#include "StreamingGenerator.h"
+
+using namespace std;
+
+// The previous Stack<Object>: one node allocation per push, one delete per pop
+template <class Object>
+class LinkedListStack
+{
+public:
+    LinkedListStack() : topOfStack(NULL) {}
+    ~LinkedListStack() {
+        while (!isEmpty())
+            pop();
+    }
+    bool isEmpty() const {
+        return (topOfStack == NULL);
+    }
+    void pop() {
+        if (!isEmpty()) {
+            ListNode * newTop = topOfStack->next;
+            delete topOfStack;
+            topOfStack = newTop;
+        }
+    }
+    void push(const Object &x) {
+        topOfStack = new ListNode(x, topOfStack);
+    }
+    const Object &top() const {
+        return topOfStack->element;
+    }
+
+private:
+    struct ListNode
+    {
+        Object element;
+        ListNode *next;
+        ListNode(const Object &theElement, ListNode *n = NULL)
+            : element(theElement), next(n) {}
+    };
+    ListNode *topOfStack;
+};
+
+// Same layout as cell_of_maze in MazeGenerator.cpp
+struct benchmark_cell {
+    bool up, down, right, left;
+    int x, y;
+    bool is_visited;
+};
+
+// Two ints, like the cell_coordinate the generator pushes
+struct benchmark_coordinate {
+    int x, y;
+};
+
+// Keeps the optimizer from dropping the loops
+static long long benchmark_sink = 0;
+
+// Seconds elapsed since start
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Print one result line: name, element count and nanoseconds per push+pop pair
+static void report(const string & name, long long operations, double seconds) {
+    cout << left << setw(44) << name << right << setw(12) << operations
+         << setw(12) << fixed << setprecision(2) << seconds * 1e9 / operations << " ns/op" << endl;
+}
+
+// Fill the stack with n elements and drain it again, repeated rounds times.
+// This is the access pattern of generation and path discovery: long runs of pushes followed by backtracking.
+template <class StackType, class Element>
+static double fill_and_drain(StackType & stack, long long n, int rounds) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        Element element = Element();
+        for (long long i = 0; i < n; i++) {
+            element.x = (int)i;
+            stack.push(element);
+        }
+        while (!stack.isEmpty()) {
+            benchmark_sink += stack.top().x;
+            stack.pop();
+        }
+    }
+    return seconds_since(start);
+}
+
+// Alternate pushes and pops around a fixed depth, like a random walk over a maze
+template <class StackType, class Element>
+static double zigzag(StackType & stack, long long n, int depth) {
+    Element element = Element();
+    for (int i = 0; i < depth; i++) {
+        stack.push(element);
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (long long i = 0; i < n; i++) {
+        element.x = (int)i;
+        stack.push(element);
+        if (i & 1) {
+            benchmark_sink += stack.top().x;
+            stack.pop();
+            stack.pop();
+        }
+    }
+    double seconds = seconds_since(start);
+    while (!stack.isEmpty()) {
+        stack.pop();
+    }
+    return seconds;
+}
+
+template <class Element>
+static void stack_benchmarks(const string & element_name, long long n, int rounds) {
+    long long operations = n * rounds;
+    {
+        LinkedListStack<Element> stack;
+        report("linked list      fill/drain " + element_name, operations, fill_and_drain<LinkedListStack<Element>, Element>(stack, n, rounds));
+    }
+    {
+        Stack<Element> stack;
+        report("contiguous       fill/drain " + element_name, operations, fill_and_drain<Stack<Element>, Element>(stack, n, rounds));
+    }
+    {
+        Stack<Element> stack;
+        stack.reserve(n);
+        report("reserved         fill/drain " + element_name, operations, fill_and_drain<Stack<Element>, Element>(stack, n, rounds));
+    }
+    {
+        // A fresh arena backed stack per round, the way per-maze stacks are used
+        StackArena arena;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            Stack<Element> stack(arena);
+            fill_and_drain<Stack<Element>, Element>(stack, n, 1);
+            arena.reset();
+        }
+        report("arena            fill/drain " + element_name, operations, seconds_since(start));
+    }
+    {
+        LinkedListStack<Element> stack;
+        report("linked list      zigzag     " + element_name, n, zigzag<LinkedListStack<Element>, Element>(stack, n, 1024));
+    }
+    {
+        Stack<Element> stack;
+        report("contiguous       zigzag     " + element_name, n, zigzag<Stack<Element>, Element>(stack, n, 1024));
+    }
+}
+
+// Cost of one random direction (1 to 4): a RandInt(1, 4) call per direction, two bits of a
+// buffered word per direction, and directions filled 64 at a time
+static void random_direction_benchmark(long long count) {
+    cout << "Random directions (" << count << " draws)" << endl;
+    unsigned char buffer[64];
+    {
+        MazeRandom rnd(1);
+        long long sum = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (long long i = 0; i < count; i++) {
+            sum += rnd.RandInt(1, 4);
+        }
+        report("RandInt(1, 4)", count, seconds_since(start));
+        benchmark_sink += sum;
+    }
+    {
+        MazeRandom rnd(1);
+        long long sum = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (long long i = 0; i < count; i++) {
+            sum += rnd.direction();
+        }
+        report("direction()", count, seconds_since(start));
+        benchmark_sink += sum;
+    }
+    {
+        MazeRandom rnd(1);
+        long long sum = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (long long i = 0; i < count; i += 64) {
+            rnd.fillDirections(buffer, 64);
+            for (int k = 0; k < 64; k++) {
+                sum += buffer[k];
+            }
+        }
+        report("fillDirections(64)", count, seconds_since(start));
+        benchmark_sink += sum;
+    }
+}
+
+// Generate a batch of mazes of mixed sizes (in memory) with 1..max_threads threads.
+// The sizes vary so that the work stealing has something to balance.
+static void batch_scaling_benchmark(int max_threads) {
+    vector<maze_job> jobs;
+    const int sizes[4] = {32, 64, 128, 256};
+    for (int i = 0; i < 400; i++) {
+        jobs.push_back(maze_job(i + 1, sizes[i % 4], sizes[(i / 4) % 4]));
+    }
+    long long cells = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        cells += (long long)jobs[i].rows * jobs[i].columns;
+    }
+
+    cout << "Batch generation scaling (" << jobs.size() << " mazes, " << cells << " cells)" << endl;
+    double single = 0;
+    for (int threads = 1; threads <= max_threads; threads++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        parallel_for_stealing(jobs.size(), threads, [&](size_t i) {
+            MazeRandom rnd(maze_seed(1, jobs[i].mazeID));
+            MazeGrid maze(jobs[i].rows, jobs[i].columns);
+            generate_maze(maze, rnd);
+        });
+        double seconds = seconds_since(start);
+        if (threads == 1) single = seconds;
+        cout << left << setw(12) << (to_string(threads) + " threads") << right << fixed << setprecision(1)
+             << setw(12) << jobs.size() / seconds << " mazes/s" << setw(12) << cells / seconds / 1e6 << " Mcells/s"
+             << setw(10) << setprecision(2) << single / seconds << "x" << endl;
+    }
+}
+
+// Generate one large maze with the tiled generator on 1..max_threads threads,
+// next to the plain single-threaded backtracker on the same grid
+static void tiled_scaling_benchmark(int size, int tile, int max_threads) {
+    double cells = (double)size * size;
+    cout << "Tiled generation of one " << size << "x" << size << " maze, " << tile << "-cell tiles" << endl;
+    {
+        MazeRandom rnd(1);
+        MazeGrid maze(size, size);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        generate_maze(maze, rnd);
+        double seconds = seconds_since(start);
+        cout << left << setw(12) << "backtracker" << right << fixed << setprecision(1)
+             << setw(12) << cells / seconds / 1e6 << " Mcells/s" << endl;
+    }
+    double single = 0;
+    for (int threads = 1; threads <= max_threads; threads++) {
+        MazeGrid maze(size, size);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        generate_tiled_maze(maze, 1, tile, threads);
+        double seconds = seconds_since(start);
+        if (threads == 1) single = seconds;
+        cout << left << setw(12) << (to_string(threads) + " threads") << right << fixed << setprecision(1)
+             << setw(12) << cells / seconds / 1e6 << " Mcells/s" << setw(10) << setprecision(2) << single / seconds << "x" << endl;
+    }
+}
+
+// Latency of one path query per solver, for square mazes of the given sizes and three
+// entry/exit distances: a few cells apart near the middle, a quarter of the maze apart, and
+// corner to corner. "braided" mazes have a tenth of their inner walls removed as well, so
+// there are loops and more than one route (the perfect maze has exactly one).
+static void solver_latency_benchmark(const vector<int> & sizes) {
+    const char * names[5] = {"dfs", "bfs", "bidirectional", "astar", "flood"};
+    const solver_mode modes[5] = {SOLVER_DFS, SOLVER_BFS, SOLVER_BIDIRECTIONAL, SOLVER_ASTAR, SOLVER_FLOOD};
+    const char * distances[3] = {"near", "mid", "far"};
+
+    cout << "Path query latency (microseconds per query, cells explored per query)" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        int size = sizes[s];
+        for (int braided = 0; braided <= 1; braided++) {
+            MazeRandom rnd(maze_seed(7, size));
+            MazeGrid maze(size, size);
+            generate_maze(maze, rnd);
+            if (braided) {
+                for (long long k = 0; k < maze.cellCount() / 10; k++) {
+                    maze.removeWall(rnd.RandInt(0, size - 1), rnd.RandInt(0, size - 1), rnd.RandInt(DIR_LEFT, DIR_DOWN));
+                }
+            }
+            MazeSolver solver(maze);
+            FloodSolver flood(maze);
+            int middle = size / 2;
+            int entries[3][4] = {{middle, middle, middle + size / 32 + 1, middle + size / 32 + 1},
+                                 {size / 4, size / 4, size / 2, size / 2},
+                                 {0, 0, size - 1, size - 1}};
+            for (int d = 0; d < 3; d++) {
+                cout << left << setw(6) << size << setw(9) << (braided ? "braided" : "perfect") << setw(6) << distances[d] << right;
+                for (int m = 0; m < 5; m++) {
+                    int repeats = size <= 500 ? 20 : 3;
+                    long long explored = 0;
+                    MazeRandom walk(1);
+                    Stack<unsigned char> moves;
+                    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                    for (int r = 0; r < repeats; r++) {
+                        moves.clear();
+                        if (modes[m] == SOLVER_DFS) {
+                            random_path_search(maze, entries[d][0], entries[d][1], entries[d][2], entries[d][3], moves, walk);
+                        }
+                        else if (modes[m] == SOLVER_FLOOD) {
+                            flood.solve(entries[d][0], entries[d][1], entries[d][2], entries[d][3], moves);
+                            explored += flood.cellsExplored();
+                        }
+                        else {
+                            solver.solve(modes[m], entries[d][0], entries[d][1], entries[d][2], entries[d][3], moves);
+                            explored += solver.cellsExplored();
+                        }
+                        benchmark_sink += moves.size();
+                    }
+                    double seconds = seconds_since(start) / repeats;
+                    cout << "  " << names[m] << " " << fixed << setprecision(0) << seconds * 1e6;
+                    if (modes[m] != SOLVER_DFS) {
+                        cout << " (" << explored / repeats << ")";
+                    }
+                }
+                cout << endl;
+            }
+        }
+    }
+}
+
+// Many random entry/exit queries on one maze: build time of the tree index, then queries per
+// second for lengths and for full paths, next to a breadth-first search per query
+static void tree_index_benchmark(const vector<int> & sizes, int query_count) {
+    cout << "Tree index (LCA) queries, " << query_count << " random pairs per maze" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        int size = sizes[s];
+        MazeRandom rnd(maze_seed(9, size));
+        MazeGrid maze(size, size);
+        generate_maze(maze, rnd);
+        vector<path_query> queries(query_count);
+        for (int i = 0; i < query_count; i++) {
+            queries[i].x_entry = rnd.RandInt(0, size - 1);
+            queries[i].y_entry = rnd.RandInt(0, size - 1);
+            queries[i].x_exit = rnd.RandInt(0, size - 1);
+            queries[i].y_exit = rnd.RandInt(0, size - 1);
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        MazeTreeIndex index(maze);
+        double build = seconds_since(start);
+
+        start = chrono::steady_clock::now();
+        long long total_length = 0;
+        for (int i = 0; i < query_count; i++) {
+            total_length += index.pathLength(queries[i].x_entry, queries[i].y_entry, queries[i].x_exit, queries[i].y_exit);
+        }
+        double lengths = seconds_since(start);
+
+        // Paths in a backtracker maze are long (a good part of the cells), so fewer of them are timed
+        int path_count = query_count < 1000 ? query_count : 1000;
+        Stack<unsigned char> moves;
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < path_count; i++) {
+            moves.clear();
+            index.path(queries[i].x_entry, queries[i].y_entry, queries[i].x_exit, queries[i].y_exit, moves);
+            benchmark_sink += moves.size();
+        }
+        double paths = seconds_since(start);
+
+        // A breadth-first search per query is much slower, so only a sample of them is timed
+        int bfs_count = query_count < 50 ? query_count : 50;
+        MazeSolver solver(maze);
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < bfs_count; i++) {
+            moves.clear();
+            solver.solve(SOLVER_BFS, queries[i].x_entry, queries[i].y_entry, queries[i].x_exit, queries[i].y_exit, moves);
+            benchmark_sink += moves.size();
+        }
+        double bfs = seconds_since(start);
+        benchmark_sink += total_length;
+
+        cout << left << setw(6) << size << right << fixed << setprecision(1)
+             << "  build " << build * 1e3 << " ms"
+             << "  length " << setprecision(0) << query_count / lengths << " q/s"
+             << "  path " << path_count / paths << " q/s"
+             << "  bfs " << bfs_count / bfs << " q/s"
+             << "  mean length " << total_length / query_count << endl;
+    }
+}
+
+// Random toggles of inner walls, each one changing the wall it names: the maze as the edits
+// before it left it decides whether an edit opens or closes
+static vector<wall_edit> random_wall_toggles(const MazeGrid & maze, int count, MazeRandom & rnd) {
+    MazeGrid state(maze);
+    vector<wall_edit> edits;
+    while ((int)edits.size() < count) {
+        wall_edit edit;
+        edit.x = rnd.RandInt(0, maze.columns() - 1);
+        edit.y = rnd.RandInt(0, maze.rows() - 1);
+        edit.direction = rnd.RandInt(0, 1) ? DIR_RIGHT : DIR_UP;
+        if (!maze.contains(edit.x + DIR_DX[edit.direction], edit.y + DIR_DY[edit.direction])) {
+            continue;
+        }
+        edit.open = state.hasWall(edit.x, edit.y, edit.direction);
+        state.setWall(edit.x, edit.y, edit.direction, !edit.open);
+        edits.push_back(edit);
+    }
+    return edits;
+}
+
+// Wall edits that keep the corner to corner path up to date, in batches of 1, 16 and 256 edits
+// (microseconds per edit), against one breadth-first solve of the edited maze. The first half of
+// the edits open walls (loops), the rest are random toggles.
+static void edit_benchmark(const vector<int> & sizes, int edit_count) {
+    const size_t batches[3] = {1, 16, 256};
+    cout << "Incremental wall edits, " << edit_count << " per maze (us per edit), against a full BFS solve" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        int size = sizes[s];
+        MazeRandom rnd(maze_seed(13, size));
+        MazeGrid maze(size, size);
+        generate_maze(maze, rnd);
+        vector<wall_edit> edits = random_wall_toggles(maze, edit_count, rnd);
+        for (int i = 0; i < edit_count / 2; i++) {
+            edits[i].open = true;
+        }
+
+        cout << left << setw(6) << size << right << fixed << setprecision(1);
+        MazeGrid edited(maze);
+        for (int b = 0; b < 3; b++) {
+            edited = maze;
+            MazeEditor editor(edited, 0, 0, size - 1, size - 1);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (size_t i = 0; i < edits.size(); i += batches[b]) {
+                editor.apply(&edits[i], min(batches[b], edits.size() - i));
+            }
+            double seconds = seconds_since(start);
+            benchmark_sink += editor.pathLength();
+            cout << "  batch " << batches[b] << " " << seconds / edits.size() * 1e6;
+        }
+        // The re-solve the editor saves: one search of the maze as the edits left it
+        MazeSolver solver(edited);
+        Stack<unsigned char> moves;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        solver.solve(SOLVER_BFS, 0, 0, size - 1, size - 1, moves);
+        cout << "  bfs " << seconds_since(start) * 1e6 << endl;
+        benchmark_sink += moves.size();
+    }
+}
+
+// Corner to corner queries on large mazes: breadth-first search against the flood fill with the
+// 64-bit and the AVX2 kernel, with the cells each one explored. Perfect mazes from the
+// backtracker have long winding corridors, where a block fill rarely gains more than a few
+// cells; Prim and sidewinder mazes have many short branches, where whole rows fill at once.
+static void flood_solver_benchmark(const vector<int> & sizes) {
+    const uint32_t algorithms[3] = {MAZE_ALGORITHM_BACKTRACKER, MAZE_ALGORITHM_PRIM, MAZE_ALGORITHM_SIDEWINDER};
+    cout << "Flood fill against breadth-first search, corner to corner (seconds per query, cells explored)" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        int size = sizes[s];
+        for (int a = 0; a < 3; a++) {
+            MazeGrid maze(size, size);
+            {
+                MazeRandom rnd(maze_seed(11, size));
+                generate_maze_with(maze, algorithms[a], rnd);
+            }
+            cout << left << setw(7) << size << setw(13) << maze_algorithm_name(algorithms[a]) << right << fixed;
+            Stack<unsigned char> moves;
+            {
+                MazeSolver solver(maze);
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                solver.solve(SOLVER_BFS, 0, 0, size - 1, size - 1, moves);
+                cout << "  bfs " << setprecision(3) << seconds_since(start) << " (" << solver.cellsExplored() << ")";
+            }
+            benchmark_sink += moves.size();
+            for (int vectorized = 0; vectorized <= 1; vectorized++) {
+                FloodSolver flood(maze, vectorized != 0);
+                if (vectorized && !flood.vectorized()) {
+                    cout << "  flood-avx2 n/a";
+                    continue;
+                }
+                moves.clear();
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                flood.solve(0, 0, size - 1, size - 1, moves);
+                cout << (vectorized ? "  flood-avx2 " : "  flood-64 ") << setprecision(3) << seconds_since(start)
+                     << " (" << flood.cellsExplored() << ")";
+                benchmark_sink += moves.size();
+            }
+            cout << "  path " << moves.size() << endl;
+        }
+    }
+}
+
+// End-to-end time per maze for generate + solve (BFS, corner to corner): the file round trip
+// (write the maze, load it back, solve, write the path) against the in-memory pipeline without
+// files, with files written before returning and with files written on a background thread.
+// The files go to the working directory under maze IDs from 990001 and are removed afterwards.
+static void pipeline_benchmark(const vector<int> & sizes, int maze_count, maze_file_format format) {
+    cout << "Generate and solve, " << maze_count << " mazes per size, "
+         << (format == MAZE_FORMAT_BINARY ? "binary" : format == MAZE_FORMAT_COMPRESSED ? "compressed" : "text") << " files (milliseconds per maze)" << endl;
+    const int first_id = 990001;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        int size = sizes[s];
+        cout << left << setw(6) << size << right << fixed << setprecision(2);
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int i = 0; i < maze_count; i++) {
+            int mazeID = first_id + i;
+            uint64_t seed = maze_seed(3, mazeID);
+            MazeRandom rnd(seed);
+            MazeGrid generated(size, size);
+            generate_maze(generated, rnd);
+            writing_output_file(generated, mazeID, format, seed);
+            MazeFile loaded(maze_file_name(mazeID, format));
+            MazeSolver solver(loaded.grid());
+            Stack<unsigned char> moves;
+            solver.solve(SOLVER_BFS, 0, 0, size - 1, size - 1, moves);
+            writing_path_file(moves, mazeID, 0, 0, size - 1, size - 1);
+        }
+        cout << "  file round trip " << seconds_since(start) * 1e3 / maze_count;
+
+        const char * names[3] = {"none", "sync", "async"};
+        const persistence_mode modes[3] = {PERSIST_NONE, PERSIST_SYNC, PERSIST_ASYNC};
+        for (int m = 0; m < 3; m++) {
+            AsyncMazeWriter writer(format);
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < maze_count; i++) {
+                benchmark_sink += generate_and_solve(size, size, first_id + i, 0, 0, size - 1, size - 1, SOLVER_BFS, 3,
+                                                     modes[m], format, &writer);
+            }
+            double returned = seconds_since(start);
+            writer.finish();
+            double written = seconds_since(start);
+            cout << "  " << names[m] << " " << returned * 1e3 / maze_count;
+            if (modes[m] == PERSIST_ASYNC) {
+                cout << " (" << written * 1e3 / maze_count << " with files)";
+            }
+        }
+        cout << endl;
+
+        for (int i = 0; i < maze_count; i++) {
+            remove(maze_file_name(first_id + i, format).c_str());
+            remove(path_file_name(first_id + i, 0, 0, size - 1, size - 1).c_str());
+        }
+    }
+}
+
+// Time fn until at least min_seconds have passed (at least min_repeats runs, at most
+// max_repeats) and return the seconds of every run
+template <class Function>
+static vector<double> time_runs(Function fn, double min_seconds, int min_repeats, int max_repeats) {
+    vector<double> runs;
+    double total = 0;
+    while ((int)runs.size() < max_repeats && ((int)runs.size() < min_repeats || total < min_seconds)) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        fn();
+        double seconds = seconds_since(start);
+        runs.push_back(seconds);
+        total += seconds;
+    }
+    return runs;
+}
+
+// Results of the JSON suite, one object per measurement
+class BenchmarkRecords
+{
+public:
+    // Record a measurement of amount units per run ("value" is amount per second of the median run)
+    void add(const string & benchmark, const string & shape, int rows, int columns, uint64_t seed,
+             vector<double> runs, double amount, const string & unit)
+    {
+        sort(runs.begin(), runs.end());
+        double median = runs[runs.size() / 2];
+        ostringstream record;
+        record << setprecision(9)
+               << "{\"benchmark\": \"" << benchmark << "\", \"shape\": \"" << shape << "\", \"rows\": " << rows
+               << ", \"columns\": " << columns << ", \"seed\": " << seed << ", \"repeats\": " << runs.size()
+               << ", \"median_seconds\": " << median << ", \"min_seconds\": " << runs.front()
+               << ", \"value\": " << amount / median << ", \"unit\": \"" << unit << "\"}";
+        records.push_back(record.str());
+        cout << left << setw(22) << benchmark << setw(8) << shape << right << setw(9) << rows << " x " << left << setw(9) << columns
+             << right << setw(16) << setprecision(4) << amount / median << " " << unit << endl;
+    }
+
+    void write(const string & filename, bool quick) const
+    {
+        ofstream outFile(filename);
+        if (!outFile) {
+            throw runtime_error("cannot write " + filename);
+        }
+        outFile << "{\n  \"suite\": \"maze\",\n  \"version\": 1,\n  \"quick\": " << (quick ? "true" : "false")
+                << ",\n  \"compiler\": \"" << __VERSION__ << "\",\n  \"results\": [\n";
+        for (size_t i = 0; i < records.size(); i++) {
+            outFile << "    " << records[i] << (i + 1 < records.size() ? ",\n" : "\n");
+        }
+        outFile << "  ]\n}\n";
+    }
+
+private:
+    vector<string> records;
+};
+
+// Size of a file in bytes
+static double file_bytes(const string & filename) {
+    ifstream file(filename, ios::binary | ios::ate);
+    return file ? (double)file.tellg() : 0;
+}
+
+// Generation speed of every algorithm (million cells per second) and the memory it needs on
+// top of the grid, at a few square sizes
+static void generator_benchmark(const vector<int> & sizes) {
+    const uint32_t algorithms[6] = {MAZE_ALGORITHM_BACKTRACKER, MAZE_ALGORITHM_KRUSKAL, MAZE_ALGORITHM_WILSON,
+                                    MAZE_ALGORITHM_PRIM, MAZE_ALGORITHM_SIDEWINDER, MAZE_ALGORITHM_BINARY_TREE};
+    const char * extra_memory[6] = {"1 bit + 1 B/step", "~13 B/cell", "1 B + 1 bit/cell", "1 B/cell + frontier", "none", "none"};
+    cout << "Generation, million cells per second" << endl;
+    for (int a = 0; a < 6; a++) {
+        cout << left << setw(13) << maze_algorithm_name(algorithms[a]) << setw(21) << extra_memory[a] << right << fixed << setprecision(1);
+        for (size_t s = 0; s < sizes.size(); s++) {
+            MazeRandom rnd(5);
+            MazeGrid maze(sizes[s], sizes[s]);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            generate_maze_with(maze, algorithms[a], rnd);
+            double seconds = seconds_since(start);
+            benchmark_sink += maze.hasWall(0, 0, DIR_UP);
+            cout << "  " << sizes[s] << ": " << setw(8) << (double)sizes[s] * sizes[s] / seconds / 1e6;
+        }
+        cout << endl;
+    }
+}
+
+// One small maze made and solved corner to corner (solve 0: not solved, 1: the random walk,
+// 2: BFS) with the generic code on a MazeGrid; returns the steps of the path
+template<int N>
+static long long small_maze_generic(uint64_t seed, int solve) {
+    MazeRandom rnd(seed);
+    MazeGrid maze(N, N);
+    generate_maze_region(maze, 0, 0, N, N, rnd);
+    Stack<unsigned char> moves;
+    if (solve == 1) {
+        generic_random_path_search(maze, 0, 0, N - 1, N - 1, moves, rnd);
+    }
+    else if (solve == 2) {
+        MazeSolver solver(maze);
+        solver.solve(SOLVER_BFS, 0, 0, N - 1, N - 1, moves);
+    }
+    return (long long)moves.size();
+}
+
+// The same maze and path with the Maze<N, N> kernels, everything on the stack
+template<int N>
+static long long small_maze_fixed(uint64_t seed, int solve) {
+    MazeRandom rnd(seed);
+    Maze<N, N> maze;
+    fixed_maze_counts counts;
+    maze.generate(rnd, counts);
+    typename Maze<N, N>::path moves;
+    if (solve == 1) {
+        return maze.randomWalk(0, 0, N - 1, N - 1, rnd, moves, counts);
+    }
+    if (solve == 2) {
+        return maze.shortestPath(0, 0, N - 1, N - 1, moves);
+    }
+    return 0;
+}
+
+// Mazes per second of maze_count small mazes, generic against fixed-size, for generation alone,
+// generation with the random walk and generation with BFS
+template<int N>
+static void small_maze_benchmark_size(int maze_count) {
+    const char * names[3] = {"generate", "+dfs", "+bfs"};
+    cout << left << setw(7) << N << right << fixed << setprecision(0);
+    for (int solve = 0; solve < 3; solve++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int i = 0; i < maze_count; i++) {
+            benchmark_sink += small_maze_generic<N>((uint64_t)i, solve);
+        }
+        double generic = maze_count / seconds_since(start);
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < maze_count; i++) {
+            benchmark_sink += small_maze_fixed<N>((uint64_t)i, solve);
+        }
+        double fixed_size = maze_count / seconds_since(start);
+        cout << "  " << names[solve] << " " << setw(9) << generic << " / " << setw(9) << fixed_size
+             << " (x" << setprecision(1) << fixed_size / generic << ")" << setprecision(0);
+    }
+    cout << endl;
+}
+
+// Small mazes, where the generic code spends more on allocation and bounds checks than on the
+// maze itself: the generic code against the compile-time kernels of FixedMaze.h
+static void small_maze_benchmark(int maze_count) {
+    cout << "Small mazes, generic / fixed-size kernels (mazes per second, corner to corner)" << endl;
+    small_maze_benchmark_size<8>(maze_count);
+    small_maze_benchmark_size<16>(maze_count);
+    small_maze_benchmark_size<32>(maze_count / 4);
+    small_maze_benchmark_size<64>(maze_count / 16);
+}
+
+// Suite records of one small size: 100 mazes made and walked corner to corner per run, with the
+// generic code and with the fixed-size kernels
+template<int N>
+static void small_maze_records(BenchmarkRecords & records, uint64_t seed, double min_seconds) {
+    const int maze_count = 100;
+    vector<double> runs = time_runs([&]() {
+        for (int i = 0; i < maze_count; i++) {
+            benchmark_sink += small_maze_generic<N>(seed + (uint64_t)i, 1);
+        }
+    }, min_seconds, 3, 100000);
+    records.add("small_generic", "square", N, N, seed, runs, maze_count, "mazes/s");
+    runs = time_runs([&]() {
+        for (int i = 0; i < maze_count; i++) {
+            benchmark_sink += small_maze_fixed<N>(seed + (uint64_t)i, 1);
+        }
+    }, min_seconds, 3, 100000);
+    records.add("small_fixed", "square", N, N, seed, runs, maze_count, "mazes/s");
+}
+
+// Size and speed of the maze file formats and of the two path formats: bytes per cell (per step
+// for paths) and milliseconds to write and read back one file.
+// Mazes come from the backtracker, except the "eller" row, streamed with Eller's algorithm.
+static void file_format_benchmark() {
+    struct maze_shape { const char * name; int rows, columns; };
+    vector<maze_shape> shapes;
+    shapes.push_back({"square", 1000, 1000});
+    shapes.push_back({"1xN", 1, 1000000});
+    shapes.push_back({"Nx1", 1000000, 1});
+    shapes.push_back({"eller", 1000, 1000});
+    const maze_file_format formats[3] = {MAZE_FORMAT_TEXT, MAZE_FORMAT_BINARY, MAZE_FORMAT_COMPRESSED};
+    const char * format_names[3] = {"text", "binary", "compressed"};
+    const int mazeID = 990100;
+
+    cout << "Maze files: bytes per cell, write and read milliseconds" << endl;
+    for (size_t s = 0; s < shapes.size(); s++) {
+        const maze_shape & shape = shapes[s];
+        double cells = (double)shape.rows * shape.columns;
+        MazeGrid maze(shape.rows, shape.columns);
+        if (string(shape.name) == "eller") {
+            MazeRandom rnd(5);
+            streaming_maze_generator(shape.rows, shape.columns, maze_file_name(mazeID, MAZE_FORMAT_BINARY), MAZE_FORMAT_BINARY, rnd, 5);
+            MazeFile loaded(maze_file_name(mazeID, MAZE_FORMAT_BINARY));
+            maze = loaded.grid();
+        }
+        else {
+            MazeRandom rnd(5);
+            generate_maze(maze, rnd);
+        }
+        cout << left << setw(7) << shape.name << right << setw(8) << shape.rows << " x " << left << setw(8) << shape.columns
+             << right << fixed;
+        for (int f = 0; f < 3; f++) {
+            string filename = maze_file_name(mazeID, formats[f]);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            writing_output_file(maze, mazeID, formats[f], 5);
+            double written = seconds_since(start);
+            start = chrono::steady_clock::now();
+            MazeFile loaded(filename);
+            const uint64_t * words = loaded.grid().data();
+            uint64_t mixed = 0;
+            for (size_t i = 0; i < loaded.grid().wordCount(); i++) {
+                mixed ^= words[i];
+            }
+            benchmark_sink += (long long)(mixed & 0xFF);
+            double read = seconds_since(start);
+            cout << "  " << format_names[f] << " " << setprecision(3) << file_bytes(filename) / cells << " B "
+                 << setprecision(1) << written * 1e3 << "/" << read * 1e3 << " ms";
+            remove(filename.c_str());
+        }
+        cout << endl;
+    }
+
+    cout << "Path files: bytes per step, write and read milliseconds" << endl;
+    for (int size = 500; size <= 2000; size *= 2) {
+        MazeRandom rnd(5);
+        MazeGrid maze(size, size);
+        generate_maze(maze, rnd);
+        MazeSolver solver(maze);
+        Stack<unsigned char> path;
+        solver.solve(SOLVER_BFS, 0, 0, size - 1, size - 1, path);
+        cout << left << setw(6) << size << right << setw(9) << path.size() << " steps";
+        const path_file_format path_formats[2] = {PATH_FORMAT_TEXT, PATH_FORMAT_COMPACT};
+        const char * path_format_names[2] = {"text", "compact"};
+        for (int f = 0; f < 2; f++) {
+            string filename = path_file_name(mazeID, 0, 0, size - 1, size - 1, path_formats[f]);
+            Stack<unsigned char> moves(path);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            write_path_result(true, moves, mazeID, 0, 0, size - 1, size - 1, path_formats[f]);
+            double written = seconds_since(start);
+            start = chrono::steady_clock::now();
+            long long steps = 0;
+            if (path_formats[f] == PATH_FORMAT_TEXT) {
+                ifstream inFile(filename);
+                int x, y;
+                while (inFile >> x >> y) {
+                    steps++;
+                }
+                steps--;
+            }
+            else {
+                CompactPathReader reader(filename);
+                while (reader.next()) {
+                    steps++;
+                }
+            }
+            double read = seconds_since(start);
+            benchmark_sink += steps;
+            cout << "  " << path_format_names[f] << " " << setprecision(3) << file_bytes(filename) / (double)path.size() << " B "
+                 << setprecision(2) << written * 1e3 << "/" << read * 1e3 << " ms";
+            remove(filename.c_str());
+        }
+        cout << endl;
+    }
+}
+
+// The out-of-core solver on one binary maze file under several memory limits: time, I/O passes
+// (sweeps over the bands), band loads and the bytes read and written, next to the in-memory
+// flood fill of the same file
+static void external_solver_benchmark(int size, const vector<size_t> & limits) {
+    const int mazeID = 990001;
+    {
+        MazeRandom rnd(maze_seed(13, size));
+        MazeGrid maze(size, size);
+        generate_maze(maze, rnd);
+        writing_output_file(maze, mazeID, MAZE_FORMAT_BINARY, maze_seed(13, size));
+    }
+    string filename = maze_file_name(mazeID, MAZE_FORMAT_BINARY);
+    cout << "Out-of-core solver, " << size << " x " << size << " backtracker maze, corner to corner ("
+         << fixed << setprecision(0) << file_bytes(filename) / 1e6 << " MB file)" << endl;
+    {
+        MazeFile loaded(filename);
+        FloodSolver flood(loaded.grid());
+        Stack<unsigned char> moves;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        flood.solve(0, 0, size - 1, size - 1, moves);
+        cout << "in memory (flood)   " << setprecision(2) << seconds_since(start) << " s, path " << moves.size() << endl;
+    }
+    for (size_t i = 0; i < limits.size(); i++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        OutOfCoreSolver external(filename, limits[i], ".");
+        external.solve(0, 0, size - 1, size - 1);
+        double seconds = seconds_since(start);
+        cout << "limit " << left << setw(6) << to_string(limits[i] >> 20) + "M" << right << setw(8) << setprecision(2)
+             << seconds << " s, " << external.bands() << " bands, " << external.passes() << " passes, "
+             << external.bandLoads() << " loads, read " << setprecision(0) << external.bytesRead() / 1e6 << " MB, wrote "
+             << external.bytesWritten() / 1e6 << " MB, path " << external.pathLength() << endl;
+        benchmark_sink += external.pathLength();
+    }
+    remove(filename.c_str());
+}
+
+// The fixed benchmark suite: for every shape of the matrix, generation with every algorithm (cells/s), path
+// discovery corner to corner (the random walk and BFS, queries/s), text, binary and compressed
+// writes and reads and text and compact path writes and reads (MB/s of the file), then small mazes
+// made and walked with the generic code and the fixed-size kernels (mazes/s) and the Stack push+pop
+// cost (operations/s). Files go to the working directory as maze_990000 and are removed afterwards.
+static void benchmark_suite(const string & json_path, bool quick) {
+    struct maze_shape { const char * name; int rows, columns; };
+    vector<maze_shape> shapes = {{"square", 100, 100}, {"square", 300, 300}, {"1xN", 1, 10000}, {"Nx1", 10000, 1}};
+    if (!quick) {
+        shapes.push_back({"square", 1000, 1000});
+        shapes.push_back({"1xN", 1, 1000000});
+        shapes.push_back({"Nx1", 1000000, 1});
+    }
+    double min_seconds = quick ? 0.05 : 0.3;
+    const uint64_t seed = 20231109;
+    const int mazeID = 990000;
+    BenchmarkRecords records;
+
+    for (size_t s = 0; s < shapes.size(); s++) {
+        const maze_shape & shape = shapes[s];
+        double cells = (double)shape.rows * shape.columns;
+
+        vector<double> runs = time_runs([&]() {
+            MazeRandom rnd(seed);
+            MazeGrid maze(shape.rows, shape.columns);
+            generate_maze(maze, rnd);
+            benchmark_sink += maze.hasWall(0, 0, DIR_RIGHT);
+        }, min_seconds, 3, 1000);
+        records.add("generate", shape.name, shape.rows, shape.columns, seed, runs, cells, "cells/s");
+
+        // The other generators. A random walk on a 1-cell wide maze takes time quadratic in its
+        // length, so Wilson only runs on the smaller of those.
+        const uint32_t algorithms[5] = {MAZE_ALGORITHM_KRUSKAL, MAZE_ALGORITHM_WILSON, MAZE_ALGORITHM_PRIM,
+                                        MAZE_ALGORITHM_SIDEWINDER, MAZE_ALGORITHM_BINARY_TREE};
+        for (int a = 0; a < 5; a++) {
+            if (algorithms[a] == MAZE_ALGORITHM_WILSON && (shape.rows == 1 || shape.columns == 1) && cells > 10000) {
+                continue;
+            }
+            runs = time_runs([&]() {
+                MazeRandom rnd(seed);
+                MazeGrid maze(shape.rows, shape.columns);
+                generate_maze_with(maze, algorithms[a], rnd);
+                benchmark_sink += maze.hasWall(0, 0, DIR_RIGHT);
+            }, min_seconds, 3, 1000);
+            records.add("generate_" + maze_algorithm_name(algorithms[a]), shape.name, shape.rows, shape.columns, seed, runs, cells, "cells/s");
+        }
+
+        MazeRandom rnd(seed);
+        MazeGrid maze(shape.rows, shape.columns);
+        generate_maze(maze, rnd);
+        int x_exit = shape.columns - 1, y_exit = shape.rows - 1;
+
+        runs = time_runs([&]() {
+            MazeRandom walk(seed);
+            Stack<unsigned char> moves;
+            random_path_search(maze, 0, 0, x_exit, y_exit, moves, walk);
+            benchmark_sink += moves.size();
+        }, min_seconds, 3, 1000);
+        records.add("solve_dfs", shape.name, shape.rows, shape.columns, seed, runs, 1, "queries/s");
+
+        MazeSolver solver(maze);
+        runs = time_runs([&]() {
+            Stack<unsigned char> moves;
+            solver.solve(SOLVER_BFS, 0, 0, x_exit, y_exit, moves);
+            benchmark_sink += moves.size();
+        }, min_seconds, 3, 1000);
+        records.add("solve_bfs", shape.name, shape.rows, shape.columns, seed, runs, 1, "queries/s");
+
+        for (int vectorized = 1; vectorized >= 0; vectorized--) {
+            FloodSolver flood(maze, vectorized != 0);
+            runs = time_runs([&]() {
+                Stack<unsigned char> moves;
+                flood.solve(0, 0, x_exit, y_exit, moves);
+                benchmark_sink += moves.size();
+            }, min_seconds, 3, 1000);
+            records.add(vectorized ? "solve_flood" : "solve_flood_scalar", shape.name, shape.rows, shape.columns, seed, runs, 1,
+                        "queries/s");
+        }
+
+        // Difficulty metrics of the whole maze, on one thread
+        runs = time_runs([&]() {
+            MazeAnalyzer analyzer(maze, 1);
+            benchmark_sink += analyzer.analyze().diameter;
+        }, min_seconds, 3, 200);
+        records.add("analyze", shape.name, shape.rows, shape.columns, seed, runs, cells, "cells/s");
+
+        // Random wall toggles applied one at a time and then undone, with the corner to corner
+        // path kept up to date, against setting the wall and solving again with BFS
+        {
+            MazeRandom editRandom(seed);
+            vector<wall_edit> edits = random_wall_toggles(maze, 200, editRandom);
+            vector<wall_edit> undo(edits.rbegin(), edits.rend());
+            for (size_t i = 0; i < undo.size(); i++) {
+                undo[i].open = !undo[i].open;
+            }
+            MazeGrid edited(maze);
+            MazeEditor editor(edited, 0, 0, x_exit, y_exit);
+            runs = time_runs([&]() {
+                for (size_t i = 0; i < edits.size(); i++) {
+                    editor.apply(edits[i]);
+                }
+                for (size_t i = 0; i < undo.size(); i++) {
+                    editor.apply(undo[i]);
+                }
+                benchmark_sink += editor.pathLength();
+            }, min_seconds, 3, 200);
+            records.add("edit_incremental", shape.name, shape.rows, shape.columns, seed, runs, 2.0 * edits.size(), "edits/s");
+
+            // A solve per edit is slow on the larger mazes, so fewer edits are timed
+            size_t resolved = min(edits.size(), (size_t)10);
+            MazeSolver editedSolver(edited);
+            runs = time_runs([&]() {
+                Stack<unsigned char> moves;
+                for (size_t i = 0; i < resolved; i++) {
+                    edited.setWall(edits[i].x, edits[i].y, edits[i].direction, !edits[i].open);
+                    moves.clear();
+                    editedSolver.solve(SOLVER_BFS, 0, 0, x_exit, y_exit, moves);
+                    benchmark_sink += moves.size();
+                }
+                for (size_t i = resolved; i-- > 0;) {
+                    edited.setWall(edits[i].x, edits[i].y, edits[i].direction, edits[i].open);
+                }
+            }, min_seconds, 3, 200);
+            records.add("edit_resolve", shape.name, shape.rows, shape.columns, seed, runs, (double)resolved, "edits/s");
+        }
+
+        const maze_file_format formats[3] = {MAZE_FORMAT_TEXT, MAZE_FORMAT_BINARY, MAZE_FORMAT_COMPRESSED};
+        const char * format_names[3] = {"text", "binary", "compressed"};
+        for (int f = 0; f < 3; f++) {
+            string filename = maze_file_name(mazeID, formats[f]);
+            runs = time_runs([&]() {
+                writing_output_file(maze, mazeID, formats[f], seed);
+            }, min_seconds, 3, 200);
+            double megabytes = file_bytes(filename) / 1e6;
+            records.add(string("write_") + format_names[f], shape.name, shape.rows, shape.columns, seed, runs, megabytes, "MB/s");
+
+            runs = time_runs([&]() {
+                if (formats[f] == MAZE_FORMAT_TEXT) {
+                    MazeGrid loaded = read_maze_file(filename);
+                    benchmark_sink += loaded.rows();
+                }
+                else {
+                    // Mapping alone reads nothing, so touch every wall word as a solver would
+                    MazeFile loaded(filename);
+                    const uint64_t * words = loaded.grid().data();
+                    uint64_t mixed = 0;
+                    for (size_t i = 0; i < loaded.grid().wordCount(); i++) {
+                        mixed ^= words[i];
+                    }
+                    benchmark_sink += (long long)(mixed & 0xFF);
+                }
+            }, min_seconds, 3, 200);
+            records.add(string("read_") + format_names[f], shape.name, shape.rows, shape.columns, seed, runs, megabytes, "MB/s");
+
+            // Every ingest check of the file (a perfect maze must pass), on one thread
+            runs = time_runs([&]() {
+                benchmark_sink += validate_maze_file(filename, 1).openPassages;
+            }, min_seconds, 3, 200);
+            records.add(string("validate_") + format_names[f], shape.name, shape.rows, shape.columns, seed, runs, cells, "cells/s");
+
+            if (formats[f] == MAZE_FORMAT_BINARY) {
+                // Out of core from the file, with 4 MB of memory
+                runs = time_runs([&]() {
+                    OutOfCoreSolver external(filename, (size_t)4 << 20, ".");
+                    benchmark_sink += external.solve(0, 0, x_exit, y_exit) ? external.pathLength() : 0;
+                }, min_seconds, 3, 200);
+                records.add("solve_external", shape.name, shape.rows, shape.columns, seed, runs, 1, "queries/s");
+            }
+            remove(filename.c_str());
+        }
+
+        // The shortest path corner to corner, written and read back in both path formats
+        Stack<unsigned char> path;
+        solver.solve(SOLVER_BFS, 0, 0, x_exit, y_exit, path);
+        const path_file_format path_formats[2] = {PATH_FORMAT_TEXT, PATH_FORMAT_COMPACT};
+        const char * path_format_names[2] = {"path_text", "path_compact"};
+        for (int f = 0; f < 2; f++) {
+            string filename = path_file_name(mazeID, 0, 0, x_exit, y_exit, path_formats[f]);
+            runs = time_runs([&]() {
+                // Writing empties the stack it is given
+                Stack<unsigned char> moves(path);
+                write_path_result(true, moves, mazeID, 0, 0, x_exit, y_exit, path_formats[f]);
+            }, min_seconds, 3, 200);
+            double megabytes = file_bytes(filename) / 1e6;
+            records.add(string("write_") + path_format_names[f], shape.name, shape.rows, shape.columns, seed, runs, megabytes, "MB/s");
+
+            runs = time_runs([&]() {
+                long long cells = 0;
+                if (path_formats[f] == PATH_FORMAT_TEXT) {
+                    ifstream inFile(filename);
+                    int x, y;
+                    while (inFile >> x >> y) {
+                        cells++;
+                    }
+                }
+                else {
+                    CompactPathReader reader(filename);
+                    for (cells = 1; reader.next(); cells++) {
+                    }
+                }
+                benchmark_sink += cells;
+            }, min_seconds, 3, 200);
+            records.add(string("read_") + path_format_names[f], shape.name, shape.rows, shape.columns, seed, runs, megabytes, "MB/s");
+            remove(filename.c_str());
+        }
+    }
+
+    // Small mazes made and walked, generic against the fixed-size kernels (mazes/s)
+    small_maze_records<8>(records, seed, min_seconds);
+    small_maze_records<16>(records, seed, min_seconds);
+    small_maze_records<32>(records, seed, min_seconds);
+    small_maze_records<64>(records, seed, min_seconds);
+
+    // Stack push+pop pairs of the direction stack, filled to a shallow and a deep walk
+    // (recorded with the depth as the columns)
+    const long long depths[2] = {1000, quick ? 100000 : 1000000};
+    for (int d = 0; d < 2; d++) {
+        vector<double> runs = time_runs([&]() {
+            Stack<unsigned char> stack;
+            for (long long i = 0; i < depths[d]; i++) {
+                stack.push((unsigned char)i);
+            }
+            while (!stack.isEmpty()) {
+                benchmark_sink += stack.top();
+                stack.pop();
+            }
+        }, min_seconds, 3, 100000);
+        records.add("stack_push_pop", "depth", 1, (int)depths[d], 0, runs, (double)depths[d], "pairs/s");
+    }
+
+    records.write(json_path, quick);
+    cout << "results written to " << json_path << endl;
+}
+
+int main(int argc, char * argv[]) {
+    if (argc > 2 && string(argv[1]) == "--json") {
+        try {
+            benchmark_suite(argv[2], argc > 3 && string(argv[3]) == "--quick");
+        }
+        catch (const exception & error) {
+            cerr << error.what() << endl;
+            return 1;
+        }
+        cerr << "checksum " << benchmark_sink << endl;
+        return 0;
+    }
+    int max_threads = argc > 1 ? atoi(argv[1]) : default_thread_count(0);
+
+    cout << "Stack push+pop cost" << endl;
+    stack_benchmarks<benchmark_cell>("cell", 1000000, 10);
+    stack_benchmarks<benchmark_coordinate>("coordinate", 1000000, 10);
+
+    cout << endl;
+    random_direction_benchmark(100000000);
+
+    cout << endl;
+    batch_scaling_benchmark(max_threads);
+
+    cout << endl;
+    tiled_scaling_benchmark(4000, 512, max_threads);
+
+    cout << endl;
+    solver_latency_benchmark(vector<int>{100, 500, 1000, 2000});
+
+    cout << endl;
+    tree_index_benchmark(vector<int>{100, 1000, 2000}, 100000);
+
+    cout << endl;
+    pipeline_benchmark(vector<int>{50, 200, 1000}, 20, MAZE_FORMAT_TEXT);
+    pipeline_benchmark(vector<int>{50, 200, 1000}, 20, MAZE_FORMAT_BINARY);
+
+    cout << endl;
+    file_format_benchmark();
+
+    cout << endl;
+    generator_benchmark(vector<int>{100, 1000, 2000});
+
+    cout << endl;
+    small_maze_benchmark(100000);
+
+    cout << endl;
+    edit_benchmark(vector<int>{300, 1000, 2000}, 10000);
+
+    cout << endl;
+    flood_solver_benchmark(vector<int>{10000, 15000});
+
+    cout << endl;
+    external_solver_benchmark(10000, vector<size_t>{(size_t)256 << 20, (size_t)16 << 20, (size_t)4 << 20, (size_t)1 << 20});
+
+    // Print the sink so the work cannot be optimized away
+    cerr << "checksum " << benchmark_sink << endl;
+    return 0;
+}
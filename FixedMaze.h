@@ -0,0 +1,378 @@
+//
+//  FixedMaze.h
+//
+//  Generation and path search kernels for small mazes whose size is known at compile time.
+//  A Maze<W, H> of up to 64 x 64 cells keeps one right-wall and one up-wall word per row in
+//  std::arrays, and its kernels keep their visited bits, stacks and queues in fixed arrays on
+//  the stack, so a small maze is made and solved without touching the heap. The bounds are
+//  template arguments, so the compiler folds the border checks, and every kernel is constexpr.
+//
+//  The kernels draw exactly the random numbers the generic code draws and look at the
+//  directions in the same order, so a maze and its paths are the same either way.
+//
+
+#ifndef FixedMaze_h
+#define FixedMaze_h
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include "Stack.h"
+#include "MazeGrid.h"
+#include "MazeRandom.h"
+#include "MazeStats.h"
+
+// What a kernel did, added to the maze_stats of the thread once it is done
+struct fixed_maze_counts {
+    long long draws;      // Random numbers drawn
+    long long rejected;   // Directions drawn that could not be taken
+    long long pops;       // Steps taken back from a dead end
+    long long checks;     // Dead end checks
+    long long peakDepth;  // Most steps on the stack at once
+
+    constexpr fixed_maze_counts() : draws(), rejected(), pops(), checks(), peakDepth() {}
+};
+
+// A maze of W columns and H rows (1 to 64 each), with the wall layout of a MazeGrid row that
+// fits in one word: bit x of right[y] is the wall right of cell (x, y) and bit x of up[y] the
+// wall above it, a set bit meaning the wall is there. Bits past column W - 1 stay set.
+template<int W, int H>
+class Maze
+{
+    static_assert(W >= 1 && W <= 64 && H >= 1 && H <= 64, "a fixed-size maze has 1 to 64 rows and columns");
+
+public:
+    static constexpr int CELLS = W * H;
+
+    // Steps of a path, first step first (a path never has more steps than the maze has cells)
+    typedef std::array<unsigned char, CELLS> path;
+
+    // Constructor for a maze where every wall is still standing
+    constexpr Maze() : right(), up() {
+        reset();
+    }
+
+    static constexpr int rows() { return H; }
+    static constexpr int columns() { return W; }
+
+    static constexpr bool contains(int x, int y) {
+        return x >= 0 && x < W && y >= 0 && y < H;
+    }
+
+    // Put every wall back
+    constexpr void reset() {
+        for (int y = 0; y < H; y++) {
+            right[y] = ~(uint64_t)0;
+            up[y] = ~(uint64_t)0;
+        }
+    }
+
+    // Check if there is a wall on the given side of cell (x, y)
+    constexpr bool hasWall(int x, int y, int direction) const
+    {
+        if (direction == DIR_LEFT) {
+            return x == 0 || ((right[y] >> (x - 1)) & 1);
+        }
+        else if (direction == DIR_RIGHT) {
+            return x == W - 1 || ((right[y] >> x) & 1);
+        }
+        else if (direction == DIR_UP) {
+            return y == H - 1 || ((up[y] >> x) & 1);
+        }
+        return y == 0 || ((up[y - 1] >> x) & 1);
+    }
+
+    // Knock down the wall on the given side of cell (x, y); border walls stay closed
+    constexpr void removeWall(int x, int y, int direction)
+    {
+        if (direction == DIR_LEFT) {
+            if (x > 0) right[y] &= ~bit(x - 1);
+        }
+        else if (direction == DIR_RIGHT) {
+            if (x < W - 1) right[y] &= ~bit(x);
+        }
+        else if (direction == DIR_UP) {
+            if (y < H - 1) up[y] &= ~bit(x);
+        }
+        else if (y > 0) {
+            up[y - 1] &= ~bit(x);
+        }
+    }
+
+    // Take the walls of a MazeGrid of the same size
+    void load(const MazeGrid & grid) {
+        for (int y = 0; y < H; y++) {
+            right[y] = grid.rightWalls(y)[0];
+            up[y] = grid.upWalls(y)[0];
+        }
+    }
+
+    // Write the walls to a MazeGrid of the same size
+    void store(MazeGrid & grid) const {
+        for (int y = 0; y < H; y++) {
+            grid.rightWalls(y)[0] = right[y];
+            grid.upWalls(y)[0] = up[y];
+        }
+    }
+
+    // Recursive backtracker from cell (0, 0), the kernel of generate_maze_region: the same
+    // candidate order and the same draws, so the same seed gives the same maze
+    constexpr void generate(MazeRandom & rnd, fixed_maze_counts & counts)
+    {
+        std::array<uint64_t, H> visited{};
+        std::array<unsigned char, CELLS> stack{};
+        int depth = 0, visitedCount = 1;
+        int x = 0, y = 0;
+        visited[0] = 1;
+
+        while (visitedCount < CELLS) {
+            int candidates[4] = {0, 0, 0, 0};
+            int count = 0;
+            if (x > 0 && !((visited[y] >> (x - 1)) & 1)) {candidates[count++] = DIR_LEFT;}
+            if (x + 1 < W && !((visited[y] >> (x + 1)) & 1)) {candidates[count++] = DIR_RIGHT;}
+            if (y + 1 < H && !((visited[y + 1] >> x) & 1)) {candidates[count++] = DIR_UP;}
+            if (y > 0 && !((visited[y - 1] >> x) & 1)) {candidates[count++] = DIR_DOWN;}
+
+            if (count == 0) {
+                // Dead end, walk back to the cell we came from
+                int way_back = opposite(stack[--depth]);
+                counts.pops++;
+                x += dx(way_back);
+                y += dy(way_back);
+                continue;
+            }
+
+            int way_of_the_cell = candidates[rnd.choice(count)];
+            counts.draws += count > 1;
+            removeWall(x, y, way_of_the_cell);
+            x += dx(way_of_the_cell);
+            y += dy(way_of_the_cell);
+
+            visited[y] |= bit(x);
+            visitedCount++;
+            stack[depth++] = (unsigned char)way_of_the_cell;
+            if (depth > counts.peakDepth) counts.peakDepth = depth;
+        }
+    }
+
+    // Randomized backtracking search, the kernel of random_path_search: directions are drawn
+    // 64 at a time from rnd until one leads to an open, unvisited neighbour.
+    // Returns the number of steps in moves, or -1 when the exit cannot be reached.
+    constexpr int randomWalk(int x_entry, int y_entry, int x_exit, int y_exit, MazeRandom & rnd, path & moves,
+                             fixed_maze_counts & counts) const
+    {
+        std::array<uint64_t, H> visited{};
+        unsigned char directions[64] = {};
+        int next_direction = 64;
+        int depth = 0;
+        int x = x_entry, y = y_entry;
+        visited[y] |= bit(x);
+
+        while (true) {
+            if (x == x_exit && y == y_exit) {
+                return depth;
+            }
+            counts.checks++;
+            unsigned open = openUnvisited(visited, x, y);
+            if (open != 0) {
+                if (next_direction == 64) {
+                    rnd.fillDirections(directions, 64);
+                    next_direction = 0;
+                }
+                int way_of_the_cell = directions[next_direction++];
+                counts.draws++;
+                if (open & (1u << way_of_the_cell)) {
+                    x += dx(way_of_the_cell);
+                    y += dy(way_of_the_cell);
+                    visited[y] |= bit(x);
+                    moves[depth++] = (unsigned char)way_of_the_cell;
+                    if (depth > counts.peakDepth) counts.peakDepth = depth;
+                }
+                else {
+                    counts.rejected++;
+                }
+            }
+            else if (depth == 0) {
+                return -1;
+            }
+            else {
+                int way_back = opposite(moves[--depth]);
+                counts.pops++;
+                x += dx(way_back);
+                y += dy(way_back);
+            }
+        }
+    }
+
+    // Breadth-first search, the kernel of MazeSolver's SOLVER_BFS: neighbours in the same order
+    // and the search stops as soon as the exit is reached, so it finds the same shortest path.
+    // Returns the number of steps in moves, or -1 when the exit cannot be reached.
+    constexpr int shortestPath(int x_entry, int y_entry, int x_exit, int y_exit, path & moves) const
+    {
+        // parent: 0 unseen, ROOT for the entry, otherwise the direction of the step that reached the cell
+        std::array<unsigned char, CELLS> parent{};
+        std::array<uint16_t, CELLS> queue{};
+        int entry = y_entry * W + x_entry, exit = y_exit * W + x_exit;
+        int head = 0, tail = 0;
+        parent[entry] = ROOT;
+        queue[tail++] = (uint16_t)entry;
+        bool found = (entry == exit);
+
+        while (!found && head < tail) {
+            int cell = queue[head++];
+            int x = cell % W, y = cell / W;
+            for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                if (hasWall(x, y, direction)) continue;
+                int next = cell + offset(direction);
+                if (parent[next] == 0) {
+                    parent[next] = (unsigned char)direction;
+                    queue[tail++] = (uint16_t)next;
+                    if (next == exit) {
+                        found = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (!found) {
+            return -1;
+        }
+
+        // Count the steps back to the entry, then write them out from the last one
+        int length = 0;
+        for (int cell = exit; parent[cell] != ROOT; cell -= offset(parent[cell])) {
+            length++;
+        }
+        int i = length;
+        for (int cell = exit; parent[cell] != ROOT; cell -= offset(parent[cell])) {
+            moves[--i] = parent[cell];
+        }
+        return length;
+    }
+
+private:
+    static constexpr unsigned char ROOT = 7;
+
+    static constexpr uint64_t bit(int x) { return (uint64_t)1 << x; }
+
+    // Direction helpers that can run in constant expressions
+    static constexpr int opposite(int direction) { return ((direction - 1) ^ 1) + 1; }
+    static constexpr int dx(int direction) { return direction == DIR_LEFT ? -1 : direction == DIR_RIGHT ? 1 : 0; }
+    static constexpr int dy(int direction) { return direction == DIR_UP ? 1 : direction == DIR_DOWN ? -1 : 0; }
+    static constexpr int offset(int direction) { return dx(direction) + dy(direction) * W; }
+
+    // Bit d set for every direction d that leads through an open wall to an unvisited cell
+    constexpr unsigned openUnvisited(const std::array<uint64_t, H> & visited, int x, int y) const
+    {
+        unsigned open = 0;
+        if (!hasWall(x, y, DIR_LEFT) && !((visited[y] >> (x - 1)) & 1)) open |= 1u << DIR_LEFT;
+        if (!hasWall(x, y, DIR_RIGHT) && !((visited[y] >> (x + 1)) & 1)) open |= 1u << DIR_RIGHT;
+        if (!hasWall(x, y, DIR_UP) && !((visited[y + 1] >> x) & 1)) open |= 1u << DIR_UP;
+        if (!hasWall(x, y, DIR_DOWN) && !((visited[y - 1] >> x) & 1)) open |= 1u << DIR_DOWN;
+        return open;
+    }
+
+    std::array<uint64_t, H> right;
+    std::array<uint64_t, H> up;
+};
+
+// A maze generated from seed with the fixed-size backtracker; it can be made at compile time:
+//     constexpr Maze<8, 8> maze = fixed_maze<8, 8>(seed);
+template<int W, int H>
+constexpr Maze<W, H> fixed_maze(uint64_t seed)
+{
+    MazeRandom rnd(seed);
+    Maze<W, H> maze;
+    fixed_maze_counts counts;
+    maze.generate(rnd, counts);
+    return maze;
+}
+
+// Call visit with a fixed-size maze (every wall standing) for a rows x columns maze and return
+// true, or return false when that size has no kernel. Kernels are compiled for the square sizes
+// most mazes come in; every other size takes the generic code.
+template<typename Visitor>
+inline bool with_fixed_maze(int rows, int columns, Visitor && visit)
+{
+    if (rows != columns) {
+        return false;
+    }
+    switch (rows) {
+        case 8: { Maze<8, 8> maze; visit(maze); return true; }
+        case 16: { Maze<16, 16> maze; visit(maze); return true; }
+        case 32: { Maze<32, 32> maze; visit(maze); return true; }
+        case 64: { Maze<64, 64> maze; visit(maze); return true; }
+        default: return false;
+    }
+}
+
+// Check if a rows x columns maze has fixed-size kernels
+inline bool has_fixed_maze(int rows, int columns) {
+    return with_fixed_maze(rows, columns, [](auto &) {});
+}
+
+// Add what a kernel did to the counters of the thread
+inline void add_fixed_maze_counts(const fixed_maze_counts & counts) {
+    MAZE_STAT_ADD(rng_draws, counts.draws);
+    MAZE_STAT_ADD(rejected_draws, counts.rejected);
+    MAZE_STAT_ADD(backtrack_pops, counts.pops);
+    MAZE_STAT_ADD(deadend_checks, counts.checks);
+    MAZE_STAT_MAX(peak_stack_depth, counts.peakDepth);
+    (void)counts;
+}
+
+// Push the first length steps of a kernel's path onto moves, last step on top
+template<typename Path>
+inline void push_fixed_path(const Path & path, int length, Stack<unsigned char> & moves) {
+    if (length <= 0) {
+        return;
+    }
+    moves.reserve(moves.size() + (size_t)length);
+    for (int i = 0; i < length; i++) {
+        moves.push(path[i]);
+    }
+}
+
+// Carve the maze with the fixed-size backtracker when its size has a kernel; false when it has none
+inline bool fixed_generate_maze(MazeGrid & grid, MazeRandom & rnd)
+{
+    return with_fixed_maze(grid.rows(), grid.columns(), [&](auto & maze) {
+        fixed_maze_counts counts;
+        maze.load(grid);
+        maze.generate(rnd, counts);
+        maze.store(grid);
+        add_fixed_maze_counts(counts);
+    });
+}
+
+// random_path_search with the fixed-size kernel when the maze size has one; false when it has
+// none. reached tells if the exit was found.
+inline bool fixed_random_path_search(const MazeGrid & grid, int x_entry, int y_entry, int x_exit, int y_exit,
+                                     Stack<unsigned char> & moves, MazeRandom & rnd, bool & reached)
+{
+    return with_fixed_maze(grid.rows(), grid.columns(), [&](auto & maze) {
+        typename std::decay<decltype(maze)>::type::path steps{};
+        fixed_maze_counts counts;
+        maze.load(grid);
+        int length = maze.randomWalk(x_entry, y_entry, x_exit, y_exit, rnd, steps, counts);
+        add_fixed_maze_counts(counts);
+        reached = length >= 0;
+        push_fixed_path(steps, length, moves);
+    });
+}
+
+// Breadth-first search with the fixed-size kernel when the maze size has one; false when it has
+// none. The entry and the exit must be inside the maze; reached tells if the exit was found.
+inline bool fixed_shortest_path(const MazeGrid & grid, int x_entry, int y_entry, int x_exit, int y_exit,
+                                Stack<unsigned char> & moves, bool & reached)
+{
+    return with_fixed_maze(grid.rows(), grid.columns(), [&](auto & maze) {
+        typename std::decay<decltype(maze)>::type::path steps{};
+        maze.load(grid);
+        int length = maze.shortestPath(x_entry, y_entry, x_exit, y_exit, steps);
+        reached = length >= 0;
+        push_fixed_path(steps, length, moves);
+    });
+}
+
+#endif /* FixedMaze_h */
@@ -0,0 +1,284 @@
+//
+//  MazeAlgorithms.h
+//
+//  Maze generators other than the recursive backtracker: Kruskal, Wilson, Prim, sidewinder and
+//  binary tree. Each one carves a perfect maze into a grid whose walls are all standing, so the
+//  result goes through the same files and solvers as a backtracker maze.
+//
+
+#ifndef MazeAlgorithms_h
+#define MazeAlgorithms_h
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include "MazeGrid.h"
+#include "MazeRandom.h"
+#include "MazeStats.h"
+
+// Disjoint sets of cells (union-find) with union by rank and path halving
+class DisjointSets
+{
+public:
+    explicit DisjointSets(uint32_t count) : parent(count), rank(count, 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            parent[i] = i;
+        }
+    }
+
+    uint32_t find(uint32_t element) {
+        while (parent[element] != element) {
+            parent[element] = parent[parent[element]];
+            element = parent[element];
+        }
+        return element;
+    }
+
+    // Join the sets of a and b; false when they were the same set already
+    bool unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return false;
+        }
+        if (rank[a] < rank[b]) {
+            std::swap(a, b);
+        }
+        parent[b] = a;
+        if (rank[a] == rank[b]) {
+            rank[a]++;
+        }
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> parent;
+    std::vector<unsigned char> rank;
+};
+
+// The generators that number their cells use 32-bit indices
+inline void check_generator_size(const MazeGrid & maze, long long limit, const char * name) {
+    if ((long long)maze.rows() * maze.columns() > limit) {
+        throw std::length_error(std::string(name) + " supports at most " + std::to_string(limit) + " cells");
+    }
+}
+
+// Directions from cell (x, y) that stay inside the maze, written to candidates; returns how many
+inline int neighbour_directions(const MazeGrid & maze, int x, int y, int candidates[4]) {
+    int count = 0;
+    if (x > 0) candidates[count++] = DIR_LEFT;
+    if (x + 1 < maze.columns()) candidates[count++] = DIR_RIGHT;
+    if (y + 1 < maze.rows()) candidates[count++] = DIR_UP;
+    if (y > 0) candidates[count++] = DIR_DOWN;
+    return count;
+}
+
+// Kruskal: every inner wall in random order, knocked down when the cells on its two sides are
+// not connected yet. Memory: a shuffled list of the walls (4 bytes each, about 2 per cell) and
+// the disjoint sets (5 bytes per cell).
+inline void generate_kruskal(MazeGrid & maze, MazeRandom & rnd) {
+    check_generator_size(maze, (long long)(UINT32_MAX / 2), "Kruskal");
+    int rows = maze.rows(), columns = maze.columns();
+    uint32_t cellCount = (uint32_t)((long long)rows * columns);
+    if (cellCount == 0) {
+        return;
+    }
+
+    // Wall 2 * cell is the right wall of cell, 2 * cell + 1 its up wall
+    std::vector<uint32_t> walls;
+    walls.reserve((size_t)cellCount * 2);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < columns; x++) {
+            uint32_t cell = (uint32_t)y * (uint32_t)columns + (uint32_t)x;
+            if (x + 1 < columns) walls.push_back(cell * 2);
+            if (y + 1 < rows) walls.push_back(cell * 2 + 1);
+        }
+    }
+    // Fisher-Yates shuffle
+    for (size_t i = walls.size(); i > 1; i--) {
+        std::swap(walls[i - 1], walls[rnd.below((uint32_t)i)]);
+    }
+    MAZE_STAT_ADD(rng_draws, walls.size() > 1 ? (long long)walls.size() - 1 : 0);
+
+    DisjointSets sets(cellCount);
+    uint32_t joined = 0;
+    for (size_t i = 0; i < walls.size() && joined + 1 < cellCount; i++) {
+        uint32_t cell = walls[i] / 2;
+        bool up = walls[i] & 1;
+        if (sets.unite(cell, up ? cell + (uint32_t)columns : cell + 1)) {
+            maze.removeWall((int)(cell % (uint32_t)columns), (int)(cell / (uint32_t)columns), up ? DIR_UP : DIR_RIGHT);
+            joined++;
+        }
+        else {
+            MAZE_STAT_ADD(rejected_draws, 1);
+        }
+    }
+}
+
+// Wilson: loop-erased random walks. From every cell not in the maze yet, walk at random until
+// the walk meets the maze, remembering only the last step taken out of each cell (which erases
+// the loops), then carve the walk into the maze. Every spanning tree is equally likely.
+// Memory: one byte per cell for the walk and one bit per cell for the maze.
+inline void generate_wilson(MazeGrid & maze, MazeRandom & rnd) {
+    check_generator_size(maze, (long long)UINT32_MAX, "Wilson");
+    int rows = maze.rows(), columns = maze.columns();
+    long long cellCount = (long long)rows * columns;
+    if (cellCount == 0) {
+        return;
+    }
+    std::vector<unsigned char> walk((size_t)cellCount, 0);
+    CellBitset inMaze(rows, columns);
+    uint32_t root = rnd.below((uint32_t)cellCount);
+    inMaze.set((int)(root % (uint32_t)columns), (int)(root / (uint32_t)columns));
+
+    for (int startY = 0; startY < rows; startY++) {
+        for (int startX = 0; startX < columns; startX++) {
+            // Walk until the maze is reached
+            int x = startX, y = startY;
+            while (!inMaze.test(x, y)) {
+                int candidates[4];
+                int count = neighbour_directions(maze, x, y, candidates);
+                int direction = candidates[rnd.choice(count)];
+                MAZE_STAT_ADD(rng_draws, 1);
+                walk[(size_t)y * columns + x] = (unsigned char)direction;
+                x += DIR_DX[direction];
+                y += DIR_DY[direction];
+            }
+            // Follow the loop-erased walk from its start and carve it
+            x = startX;
+            y = startY;
+            while (!inMaze.test(x, y)) {
+                int direction = walk[(size_t)y * columns + x];
+                maze.removeWall(x, y, direction);
+                inMaze.set(x, y);
+                x += DIR_DX[direction];
+                y += DIR_DY[direction];
+            }
+        }
+    }
+}
+
+// Prim: grow the maze from a random cell, each time joining a random cell of the frontier (the
+// cells next to the maze) to a random neighbour already in the maze. The many short dead ends
+// make it the opposite of the backtracker's long corridors.
+// Memory: one state byte per cell and the frontier (4 bytes per frontier cell).
+inline void generate_prim(MazeGrid & maze, MazeRandom & rnd) {
+    check_generator_size(maze, (long long)UINT32_MAX, "Prim");
+    int rows = maze.rows(), columns = maze.columns();
+    long long cellCount = (long long)rows * columns;
+    if (cellCount == 0) {
+        return;
+    }
+    const unsigned char OUTSIDE = 0, FRONTIER = 1, INSIDE = 2;
+    std::vector<unsigned char> state((size_t)cellCount, OUTSIDE);
+    std::vector<uint32_t> frontier;
+
+    uint32_t cell = rnd.below((uint32_t)cellCount);
+    while (true) {
+        int x = (int)(cell % (uint32_t)columns), y = (int)(cell / (uint32_t)columns);
+        state[cell] = INSIDE;
+        int candidates[4];
+        int count = neighbour_directions(maze, x, y, candidates);
+        for (int i = 0; i < count; i++) {
+            uint32_t next = (uint32_t)(y + DIR_DY[candidates[i]]) * (uint32_t)columns + (uint32_t)(x + DIR_DX[candidates[i]]);
+            if (state[next] == OUTSIDE) {
+                state[next] = FRONTIER;
+                frontier.push_back(next);
+            }
+        }
+        MAZE_STAT_MAX(peak_stack_depth, frontier.size());
+        if (frontier.empty()) {
+            return;
+        }
+
+        // Take a random frontier cell out of the list and join it to the maze
+        size_t pick = rnd.below((uint32_t)frontier.size());
+        cell = frontier[pick];
+        frontier[pick] = frontier.back();
+        frontier.pop_back();
+        x = (int)(cell % (uint32_t)columns);
+        y = (int)(cell / (uint32_t)columns);
+        count = 0;
+        int inside[4];
+        int neighbours = neighbour_directions(maze, x, y, candidates);
+        for (int i = 0; i < neighbours; i++) {
+            size_t next = (size_t)(y + DIR_DY[candidates[i]]) * columns + (x + DIR_DX[candidates[i]]);
+            if (state[next] == INSIDE) inside[count++] = candidates[i];
+        }
+        maze.removeWall(x, y, inside[rnd.choice(count)]);
+        MAZE_STAT_ADD(rng_draws, 1 + (count > 1));
+    }
+}
+
+// Mask of the columns of word w that are inside a maze of the given width, and of its last column
+inline void row_word_masks(int columns, size_t w, uint64_t & inside, uint64_t & lastColumn) {
+    int first = (int)(w * 64);
+    int count = columns - first < 64 ? columns - first : 64;
+    inside = count == 64 ? ~(uint64_t)0 : (((uint64_t)1 << count) - 1);
+    lastColumn = first + count == columns ? (uint64_t)1 << (count - 1) : 0;
+}
+
+// Binary tree: every cell opens its up or its right wall, chosen by a coin flip; cells of the
+// top row can only open right and cells of the last column only up. One random bit per cell,
+// so 64 cells are carved with a single draw and two word operations, and no memory is needed
+// beyond the grid. Every path leads up and right, so the maze has a strong diagonal bias.
+inline void generate_binary_tree(MazeGrid & maze, MazeRandom & rnd) {
+    int rows = maze.rows(), columns = maze.columns();
+    size_t words = maze.wordsPerRow();
+    for (int y = 0; y < rows; y++) {
+        uint64_t * right = maze.rightWalls(y);
+        uint64_t * up = maze.upWalls(y);
+        for (size_t w = 0; w < words; w++) {
+            uint64_t inside, lastColumn;
+            row_word_masks(columns, w, inside, lastColumn);
+            if (y + 1 == rows) {
+                right[w] &= ~(inside & ~lastColumn);
+                continue;
+            }
+            // A set bit opens the up wall, a clear bit the right wall
+            uint64_t coins = rnd.next() | lastColumn;
+            MAZE_STAT_ADD(rng_draws, 1);
+            up[w] &= ~(coins & inside);
+            right[w] &= ~(~coins & inside);
+        }
+    }
+}
+
+// Sidewinder: each row is cut into runs of cells joined left to right (a coin flip per cell
+// decides whether the run goes on), and every run opens the up wall of one random cell of it.
+// The top row is a single run with no way up. The right walls of 64 cells come from one draw;
+// only the end of a run needs a draw of its own. No memory is needed beyond the grid.
+inline void generate_sidewinder(MazeGrid & maze, MazeRandom & rnd) {
+    int rows = maze.rows(), columns = maze.columns();
+    size_t words = maze.wordsPerRow();
+    for (int y = 0; y < rows; y++) {
+        uint64_t * right = maze.rightWalls(y);
+        uint64_t * up = maze.upWalls(y);
+        int runStart = 0;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t inside, lastColumn;
+            row_word_masks(columns, w, inside, lastColumn);
+            if (y + 1 == rows) {
+                right[w] &= ~(inside & ~lastColumn);
+                continue;
+            }
+            // A set bit carries the run on to the right, a clear bit ends it
+            uint64_t carry = rnd.next() & inside & ~lastColumn;
+            MAZE_STAT_ADD(rng_draws, 1);
+            right[w] &= ~carry;
+            uint64_t ends = inside & ~carry;
+            for (int b = 0; ends != 0; b++, ends >>= 1) {
+                if (ends & 1) {
+                    int x = (int)(w * 64) + b;
+                    int chosen = rnd.RandInt(runStart, x);
+                    MAZE_STAT_ADD(rng_draws, 1);
+                    up[chosen >> 6] &= ~((uint64_t)1 << (chosen & 63));
+                    runStart = x + 1;
+                }
+            }
+        }
+    }
+}
+
+#endif /* MazeAlgorithms_h */
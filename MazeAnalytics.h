@@ -0,0 +1,488 @@
+//
+//  MazeAnalytics.h
+//
+//  Difficulty metrics of a maze from a few whole-maze passes instead of many path searches.
+//  A perfect maze is a tree, so a breadth-first search from any cell ends at one end of the
+//  longest path and a second search from there ends at the other: the diameter, and the hardest
+//  entry and exit. The second search is also the distance map. The per-cell statistics (dead
+//  ends, junctions, turns, corridors) are then gathered over bands of rows on all threads.
+//
+
+#ifndef MazeAnalytics_h
+#define MazeAnalytics_h
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include "MazeGrid.h"
+#include "MazeFile.h"
+#include "WorkStealing.h"
+
+// Buckets of the corridor length histogram: bucket b counts corridors of 2^b to 2^(b+1) - 1
+// cells, the last bucket everything longer
+const int CORRIDOR_BUCKETS = 16;
+
+// Metrics of one maze, written as one CSV line
+struct maze_metrics {
+    int rows, columns;
+    long long diameter;                 // Steps of the longest path
+    int x_entry, y_entry, x_exit, y_exit;  // Its ends: the entry and exit with the longest path
+    long long reachable;                // Cells reached from the entry, all of them in a connected maze
+    double meanDistance;                // Mean steps from the entry to the reached cells
+    long long degree[5];                // Cells with 0 to 4 open walls; degree[1] are the dead ends
+    long long turns;                    // Cells with two open walls that are not opposite
+    long long pathJunctions;            // Cells of the longest path with more than two ways to go
+    long long corridors;                // Chains of two-way cells between dead ends and junctions
+    long long longestCorridor;
+    long long corridorLengths[CORRIDOR_BUCKETS];
+    double seconds;
+
+    maze_metrics(): rows(), columns(), diameter(), x_entry(), y_entry(), x_exit(), y_exit(), reachable(), meanDistance(),
+                    degree(), turns(), pathJunctions(), corridors(), longestCorridor(), corridorLengths(), seconds() {}
+};
+
+// Header line of the metrics CSV
+inline std::string maze_metrics_header() {
+    return "mazeID,rows,columns,diameter,x_entry,y_entry,x_exit,y_exit,reachable,mean_distance,isolated,dead_ends,"
+           "corridor_cells,junctions_3,junctions_4,turns,path_junctions,corridors,longest_corridor,corridor_lengths,seconds";
+}
+
+// One CSV line; the corridor histogram is one field of space-separated bucket counts
+inline std::string maze_metrics_line(int mazeID, const maze_metrics & metrics) {
+    std::ostringstream line;
+    line << mazeID << ',' << metrics.rows << ',' << metrics.columns << ',' << metrics.diameter << ',' << metrics.x_entry << ','
+         << metrics.y_entry << ',' << metrics.x_exit << ',' << metrics.y_exit << ',' << metrics.reachable << ','
+         << metrics.meanDistance << ',' << metrics.degree[0] << ',' << metrics.degree[1] << ',' << metrics.degree[2] << ','
+         << metrics.degree[3] << ',' << metrics.degree[4] << ',' << metrics.turns << ',' << metrics.pathJunctions << ','
+         << metrics.corridors << ',' << metrics.longestCorridor << ',';
+    for (int b = 0; b < CORRIDOR_BUCKETS; b++) {
+        line << (b ? " " : "") << metrics.corridorLengths[b];
+    }
+    line << ',' << metrics.seconds;
+    return line.str();
+}
+
+// Distance map file: this header, then one little-endian uint32 per cell, row by row, holding
+// the steps from the source cell (MAZE_UNREACHED for cells it cannot reach)
+const char MAZE_DISTANCE_MAGIC[8] = {'M', 'A', 'Z', 'E', 'D', 'I', 'S', 'T'};
+const uint32_t MAZE_UNREACHED = UINT32_MAX;
+
+struct distance_file_header {
+    char magic[8];       // MAZE_DISTANCE_MAGIC
+    uint32_t rows;
+    uint32_t columns;
+    uint32_t x_source;
+    uint32_t y_source;
+    uint64_t reserved;   // Zero
+};
+
+static_assert(sizeof(distance_file_header) == 32, "the distance map header must stay 32 bytes");
+
+inline std::string distance_file_name(int mazeID) {
+    return "maze_" + std::to_string(mazeID) + "_distances.bin";
+}
+
+class MazeAnalyzer
+{
+public:
+    MazeAnalyzer(const MazeGrid & theMaze, int threadCount = 0)
+        : maze(theMaze), rows(theMaze.rows()), columns(theMaze.columns()), cellCount(theMaze.cellCount()),
+          threads(default_thread_count(threadCount)), source(0), stride(theMaze.wordsPerRow()), rightMask(stride), columnMask(stride)
+    {
+        if (cellCount >= (long long)UINT32_MAX) {
+            throw std::length_error("MazeAnalyzer supports fewer than 2^32 cells");
+        }
+        for (size_t w = 0; w < stride; w++) {
+            long long first = (long long)w * 64;
+            rightMask[w] = columns - 1 - first >= 64 ? ~(uint64_t)0 : columns - 1 - first <= 0 ? 0 : ((uint64_t)1 << (columns - 1 - first)) - 1;
+            columnMask[w] = columns - first >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << (columns - first)) - 1;
+        }
+    }
+
+    maze_metrics analyze()
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        maze_metrics metrics;
+        metrics.rows = rows;
+        metrics.columns = columns;
+        if (cellCount == 0) {
+            return metrics;
+        }
+        distance.resize((size_t)cellCount);
+
+        // The far end of a search from (0, 0) is one end of the longest path, the far end of a
+        // search from there the other. Perfect mazes are walked as trees; a loop sends the
+        // analysis to breadth-first search.
+        uint32_t far = 0;
+        if (!treeWalk(0, false, metrics, source) || !treeWalk(source, true, metrics, far)) {
+            metrics = maze_metrics();
+            metrics.rows = rows;
+            metrics.columns = columns;
+            queue.resize((size_t)cellCount);
+            visited = CellBitset(rows, columns);
+            source = breadthFirst(0, false, metrics);
+            far = breadthFirst(source, true, metrics);
+            queue = std::vector<uint32_t>();
+            visited = CellBitset();
+        }
+        metrics.x_entry = (int)(source % columns);
+        metrics.y_entry = (int)(source / columns);
+        metrics.x_exit = (int)(far % columns);
+        metrics.y_exit = (int)(far / columns);
+        metrics.pathJunctions = junctionsOnPath(far);
+
+        // The walk has measured the corridors when it went everywhere
+        bool corridorsDone = metrics.corridors > 0 && metrics.reachable == cellCount;
+        if (!corridorsDone) {
+            metrics.corridors = metrics.longestCorridor = 0;
+            std::fill(metrics.corridorLengths, metrics.corridorLengths + CORRIDOR_BUCKETS, 0);
+        }
+        cellStatistics(metrics, !corridorsDone);
+        metrics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return metrics;
+    }
+
+    // Steps from the entry of the last analysis to every cell, row by row
+    const std::vector<uint32_t> & distances() const { return distance; }
+
+    // Write the distance map of the last analysis
+    void writeDistances(const std::string & filename) const
+    {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("cannot write " + filename);
+        }
+        distance_file_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAZE_DISTANCE_MAGIC, sizeof(header.magic));
+        header.rows = (uint32_t)rows;
+        header.columns = (uint32_t)columns;
+        header.x_source = columns ? (uint32_t)(source % columns) : 0;
+        header.y_source = columns ? (uint32_t)(source / columns) : 0;
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(distance.data()), (std::streamsize)(distance.size() * sizeof(uint32_t)));
+        if (!file) {
+            throw std::runtime_error("cannot write " + filename);
+        }
+    }
+
+private:
+    bool openRight(int x, int y) const {
+        return x < columns - 1 && !((maze.rightWalls(y)[x >> 6] >> (x & 63)) & 1);
+    }
+    bool openUp(int x, int y) const {
+        return y < rows - 1 && !((maze.upWalls(y)[x >> 6] >> (x & 63)) & 1);
+    }
+
+    // Open walls of cell (x, y) as DIR_* bits: 1 << DIR_LEFT and so on
+    unsigned openings(int x, int y) const {
+        return (x > 0 && openRight(x - 1, y) ? 1u << DIR_LEFT : 0) | (openRight(x, y) ? 1u << DIR_RIGHT : 0) |
+               (openUp(x, y) ? 1u << DIR_UP : 0) | (y > 0 && openUp(x, y - 1) ? 1u << DIR_DOWN : 0);
+    }
+
+    // Depth-first walk of the tree that holds the given cell: every open wall leads to a new
+    // cell except the one the walk came in through, so no visited set is needed, and the walk
+    // follows a corridor cell by cell instead of jumping around the maze like a search frontier.
+    // It stops and fails when it has taken more steps than there are cells, which only a loop
+    // can cause; otherwise it has found the same distances as a breadth-first search would.
+    // The full walk also records the distances and measures the corridors, which it goes
+    // through from end to end when it starts from a dead end (as the far end of a walk is).
+    bool treeWalk(uint32_t from, bool full, maze_metrics & metrics, uint32_t & farthest)
+    {
+        if (full) {
+            std::fill(distance.begin(), distance.end(), MAZE_UNREACHED);
+        }
+        struct walk_step {
+            int x, y;
+            uint32_t level;
+            int entered;     // Direction the walk came in through, 0 at the start
+        };
+        std::vector<walk_step> branches;
+        walk_step step = {(int)(from % columns), (int)(from / columns), 0, 0};
+        long long reached = 0, distanceSum = 0, corridor = 0;
+        uint32_t deepest = 0;
+        farthest = from;
+        while (true) {
+            if (++reached > cellCount) {
+                return false;
+            }
+            uint32_t cell = (uint32_t)step.y * (uint32_t)columns + (uint32_t)step.x;
+            distanceSum += step.level;
+            if (step.level > deepest) {
+                deepest = step.level;
+                farthest = cell;
+            }
+            unsigned open = openings(step.x, step.y);
+            if (full) {
+                distance[cell] = step.level;
+                if (count_bits(open) == 2) {
+                    corridor++;
+                }
+                else if (corridor > 0) {
+                    countCorridor(corridor, metrics);
+                    corridor = 0;
+                }
+            }
+            open &= ~(1u << step.entered);
+            if (open == 0) {
+                if (branches.empty()) {
+                    break;
+                }
+                step = branches.back();
+                branches.pop_back();
+                continue;
+            }
+            // Leave the other openings for later and go on through the first
+            int out = lowest_bit(open);
+            for (open &= open - 1; open; open &= open - 1) {
+                int direction = lowest_bit(open);
+                walk_step branch = {step.x + DIR_DX[direction], step.y + DIR_DY[direction], step.level + 1, opposite_direction(direction)};
+                branches.push_back(branch);
+            }
+            step.x += DIR_DX[out];
+            step.y += DIR_DY[out];
+            step.level++;
+            step.entered = opposite_direction(out);
+        }
+        if (corridor > 0) {
+            countCorridor(corridor, metrics);
+        }
+        metrics.diameter = deepest;
+        metrics.reachable = reached;
+        metrics.meanDistance = (double)distanceSum / (double)reached;
+        return true;
+    }
+
+    // Breadth-first search from the given cell, level by level; returns the last cell reached,
+    // one of the farthest. Whether a cell was seen is kept in a bitset that stays in cache, so
+    // the distances are only written (and only when asked for) and never read back here.
+    uint32_t breadthFirst(uint32_t from, bool recordDistances, maze_metrics & metrics)
+    {
+        visited.clear();
+        if (recordDistances) {
+            std::fill(distance.begin(), distance.end(), MAZE_UNREACHED);
+        }
+        size_t head = 0, tail = 0, levelEnd = 1;
+        uint32_t level = 0;
+        long long distanceSum = 0;
+        visited.set((int)(from % columns), (int)(from / columns));
+        queue[tail++] = from;
+        uint32_t cell = from;
+        while (head < tail) {
+            if (head == levelEnd) {
+                level++;
+                levelEnd = tail;
+            }
+            cell = queue[head++];
+            if (recordDistances) {
+                distance[cell] = level;
+            }
+            distanceSum += level;
+            int x = (int)(cell % columns), y = (int)(cell / columns);
+            // The four neighbours, each only when the wall between is open and it is new
+            if (x > 0 && openRight(x - 1, y) && !visited.test(x - 1, y)) {
+                visited.set(x - 1, y);
+                queue[tail++] = cell - 1;
+            }
+            if (openRight(x, y) && !visited.test(x + 1, y)) {
+                visited.set(x + 1, y);
+                queue[tail++] = cell + 1;
+            }
+            if (openUp(x, y) && !visited.test(x, y + 1)) {
+                visited.set(x, y + 1);
+                queue[tail++] = cell + columns;
+            }
+            if (y > 0 && openUp(x, y - 1) && !visited.test(x, y - 1)) {
+                visited.set(x, y - 1);
+                queue[tail++] = cell - columns;
+            }
+        }
+        metrics.diameter = level;
+        metrics.reachable = (long long)tail;
+        metrics.meanDistance = (double)distanceSum / (double)tail;
+        return cell;
+    }
+
+    // Walk the longest path back from its far end, counting the cells where a solver has a
+    // choice to make (more than two open walls, the ends excluded)
+    long long junctionsOnPath(uint32_t far) const
+    {
+        long long junctions = 0;
+        uint32_t cell = far;
+        while (distance[cell] > 0) {
+            int x = (int)(cell % columns), y = (int)(cell / columns);
+            unsigned open = openings(x, y);
+            if (cell != far && count_bits(open) > 2) {
+                junctions++;
+            }
+            for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                uint32_t neighbour = (uint32_t)((long long)cell + DIR_DX[direction] + (long long)DIR_DY[direction] * columns);
+                if ((open >> direction & 1) && distance[neighbour] == distance[cell] - 1) {
+                    cell = neighbour;
+                    break;
+                }
+            }
+        }
+        return junctions;
+    }
+
+    // Open walls of word w of row y as bit planes (bit x % 64 for column x), and their count
+    // per cell, bit-sliced into ones, twos and fours. Rows outside the maze have no cells.
+    struct word_openings {
+        uint64_t left, right, up, down;
+        uint64_t ones, twos, fours;
+        uint64_t twoWay;     // Exactly two
+    };
+
+    word_openings wordOpenings(int y, size_t w) const
+    {
+        word_openings open = {0, 0, 0, 0, 0, 0, 0, 0};
+        if (y < 0 || y >= rows || w >= stride) {
+            return open;
+        }
+        const uint64_t * rightWalls = maze.rightWalls(y);
+        open.right = ~rightWalls[w] & rightMask[w];
+        uint64_t before = w > 0 ? ~rightWalls[w - 1] & rightMask[w - 1] : 0;
+        open.left = (open.right << 1) | (before >> 63);
+        open.up = y < rows - 1 ? ~maze.upWalls(y)[w] & columnMask[w] : 0;
+        open.down = y > 0 ? ~maze.upWalls(y - 1)[w] & columnMask[w] : 0;
+        uint64_t ones1 = open.left ^ open.right, twos1 = open.left & open.right;
+        uint64_t ones2 = open.up ^ open.down, twos2 = open.up & open.down;
+        uint64_t carry = ones1 & ones2;
+        open.ones = ones1 ^ ones2;
+        open.twos = twos1 ^ twos2 ^ carry;
+        open.fours = (twos1 & twos2) | (twos1 & carry) | (twos2 & carry);
+        open.twoWay = ~open.ones & open.twos & ~open.fours;
+        return open;
+    }
+
+    // Degrees, turns and, when asked, corridors, by bands of rows, 64 cells at a time.
+    // Corridors are walked from their end cells (two-way cells next to a dead end or junction);
+    // a corridor is found from both ends and counted from the one with the smaller index.
+    void cellStatistics(maze_metrics & metrics, bool corridors) const
+    {
+        int bandCount = std::max(1, std::min(rows, threads * 4));
+        std::vector<maze_metrics> bands((size_t)bandCount);
+        parallel_for_stealing((size_t)bandCount, threads, [&](size_t band) {
+            maze_metrics & part = bands[band];
+            int y0 = (int)((long long)rows * band / bandCount), y1 = (int)((long long)rows * (band + 1) / bandCount);
+            for (int y = y0; y < y1; y++) {
+                for (size_t w = 0; w < stride; w++) {
+                    word_openings open = wordOpenings(y, w);
+                    part.degree[0] += count_bits(~open.ones & ~open.twos & ~open.fours & columnMask[w]);
+                    part.degree[1] += count_bits(open.ones & ~open.twos & ~open.fours);
+                    part.degree[2] += count_bits(open.twoWay);
+                    part.degree[3] += count_bits(open.ones & open.twos);
+                    part.degree[4] += count_bits(open.fours);
+                    part.turns += count_bits(open.twoWay & ~(open.left & open.right) & ~(open.up & open.down));
+
+                    if (!corridors) {
+                        continue;
+                    }
+                    // Two-way neighbours on each side
+                    uint64_t leftTwoWay = (open.twoWay << 1) | (wordOpenings(y, w - 1).twoWay >> 63);
+                    uint64_t rightTwoWay = (open.twoWay >> 1) | (wordOpenings(y, w + 1).twoWay << 63);
+                    uint64_t ends = open.twoWay & ((open.left & ~leftTwoWay) | (open.right & ~rightTwoWay) |
+                                                   (open.up & ~wordOpenings(y + 1, w).twoWay) |
+                                                   (open.down & ~wordOpenings(y - 1, w).twoWay));
+                    for (; ends; ends &= ends - 1) {
+                        walkCorridor((int)(w * 64) + lowest_bit(ends), y, part);
+                    }
+                }
+            }
+        });
+        for (int band = 0; band < bandCount; band++) {
+            const maze_metrics & part = bands[band];
+            for (int d = 0; d < 5; d++) {
+                metrics.degree[d] += part.degree[d];
+            }
+            metrics.turns += part.turns;
+            metrics.corridors += part.corridors;
+            metrics.longestCorridor = std::max(metrics.longestCorridor, part.longestCorridor);
+            for (int b = 0; b < CORRIDOR_BUCKETS; b++) {
+                metrics.corridorLengths[b] += part.corridorLengths[b];
+            }
+        }
+    }
+
+    bool twoWay(int x, int y, int direction) const {
+        return count_bits(openings(x + DIR_DX[direction], y + DIR_DY[direction])) == 2;
+    }
+
+    // Follow a corridor from its end cell (x, y) to its other end cell and count it if (x, y)
+    // has the smaller index
+    void walkCorridor(int x, int y, maze_metrics & part) const
+    {
+        const int startX = x, startY = y;
+        unsigned open = openings(x, y);
+        // Enter through the opening that does not lead to a two-way cell
+        int entered = DIR_LEFT;
+        while (!(open >> entered & 1) || twoWay(x, y, entered)) {
+            entered++;
+        }
+        long long length = 1;
+        while (true) {
+            int out = otherOpening(open, entered);
+            if (!twoWay(x, y, out)) {
+                break;
+            }
+            x += DIR_DX[out];
+            y += DIR_DY[out];
+            entered = opposite_direction(out);
+            open = openings(x, y);
+            length++;
+        }
+        if ((long long)y * columns + x >= (long long)startY * columns + startX) {
+            countCorridor(length, part);
+        }
+    }
+
+    static void countCorridor(long long length, maze_metrics & metrics) {
+        metrics.corridors++;
+        metrics.longestCorridor = std::max(metrics.longestCorridor, length);
+        int bucket = 0;
+        while (bucket < CORRIDOR_BUCKETS - 1 && (length >> (bucket + 1)) != 0) {
+            bucket++;
+        }
+        metrics.corridorLengths[bucket]++;
+    }
+
+    // The open direction of a two-way cell other than the one it was entered from
+    static int otherOpening(unsigned open, int entered) {
+        open &= ~(1u << entered);
+        int direction = DIR_LEFT;
+        while (!(open >> direction & 1)) direction++;
+        return direction;
+    }
+
+    const MazeGrid & maze;
+    int rows, columns;
+    long long cellCount;
+    int threads;
+    uint32_t source;
+    size_t stride;
+    std::vector<uint64_t> rightMask;    // Per word of a row: the columns with a right neighbour
+    std::vector<uint64_t> columnMask;   // and all columns
+    CellBitset visited;
+    std::vector<uint32_t> distance;
+    std::vector<uint32_t> queue;
+};
+
+// Metrics of a maze file of any format
+inline maze_metrics analyze_maze_file(const std::string & filename, int threads, const std::string & distanceFile = "")
+{
+    MazeFile file(filename);
+    MazeAnalyzer analyzer(file.grid(), threads);
+    maze_metrics metrics = analyzer.analyze();
+    if (!distanceFile.empty()) {
+        analyzer.writeDistances(distanceFile);
+    }
+    return metrics;
+}
+
+#endif /* MazeAnalytics_h */
@@ -0,0 +1,527 @@
+//
+//  MazeEditor.h
+//
+//  Opening and closing walls of a loaded maze while its connectivity and the path between an
+//  entry and an exit are kept up to date. An edit costs about the size of the part of the maze it
+//  changes, not a new search of the whole maze.
+//
+
+#ifndef MazeEditor_h
+#define MazeEditor_h
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <utility>
+#include "Stack.h"
+#include "MazeGrid.h"
+
+// One wall edit: open or close the wall on the given side of cell (x, y)
+struct wall_edit {
+    int x, y, direction;
+    bool open;
+};
+
+// Direction from its name in an edit file
+inline int direction_from_name(const std::string & name) {
+    if (name == "left") return DIR_LEFT;
+    if (name == "right") return DIR_RIGHT;
+    if (name == "up") return DIR_UP;
+    if (name == "down") return DIR_DOWN;
+    throw std::invalid_argument("unknown direction " + name + " (left, right, up or down)");
+}
+
+// Read an edit file of "open|close x y left|right|up|down" lines; empty lines and lines starting
+// with # are skipped
+inline std::vector<wall_edit> read_edit_file(const std::string & filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("cannot open " + filename);
+    }
+    std::vector<wall_edit> edits;
+    std::string text;
+    for (long long lineNumber = 1; std::getline(file, text); lineNumber++) {
+        std::istringstream line(text);
+        std::string action, direction;
+        wall_edit edit;
+        if (!(line >> action) || action[0] == '#') {
+            continue;
+        }
+        if ((action != "open" && action != "close") || !(line >> edit.x >> edit.y >> direction)) {
+            throw std::runtime_error(filename + " line " + std::to_string(lineNumber) + ": expected \"open|close x y direction\"");
+        }
+        edit.direction = direction_from_name(direction);
+        edit.open = (action == "open");
+        edits.push_back(edit);
+    }
+    return edits;
+}
+
+// Position of a cell that is not on the path
+const uint32_t MAZE_OFF_PATH = UINT32_MAX;
+
+// Connectivity and one entry-to-exit path of a maze under wall edits.
+//
+// Every cell carries the label of the connected part of the maze it is in. Opening a wall between
+// two parts relabels the smaller one. Closing a wall searches from both of its sides, one cell of
+// each in turn, until the searches meet (the part is still connected) or one of them runs out of
+// cells: that side has become a part of its own and gets a new label, for about twice its size.
+// A close that cuts a part into two halves costs half of it, but most walls of a maze are near
+// its dead ends.
+//
+// The path is a list of cells plus each cell's position in it. A closed wall on the path is
+// bypassed with a breadth-first search from the cell before it to the nearest later cell of the
+// path, a wall opened between two cells of the path shortens it, and the path is only searched
+// for from scratch when the entry and exit become connected. With loops the path stays a valid
+// path, but not always the shortest one. Edits come in batches: the connectivity is updated
+// after every edit, the path once per batch.
+//
+// Memory: 13 bytes per cell (a label, a position on the path, a search queue entry and a parent
+// byte). Cells are numbered y * columns + x, which limits a maze to 2^32 cells.
+class MazeEditor
+{
+public:
+    MazeEditor(MazeGrid & theMaze, int x_entry, int y_entry, int x_exit, int y_exit)
+        : maze(theMaze), columns(theMaze.columns()), label((size_t)theMaze.cellCount(), 0),
+          position((size_t)theMaze.cellCount(), MAZE_OFF_PATH), queue((size_t)theMaze.cellCount()),
+          parent((size_t)theMaze.cellCount(), 0), components(0), searched(0)
+    {
+        if (theMaze.cellCount() > (long long)UINT32_MAX) {
+            throw std::length_error("MazeEditor supports at most 2^32 cells");
+        }
+        if (!maze.contains(x_entry, y_entry) || !maze.contains(x_exit, y_exit)) {
+            throw std::invalid_argument("the entry and exit must be inside the maze");
+        }
+        entry = cellIndex(x_entry, y_entry);
+        exit = cellIndex(x_exit, y_exit);
+        labelParts();
+        updatePath();
+    }
+
+    // Apply one edit
+    void apply(const wall_edit & edit) { apply(&edit, 1); }
+
+    // Apply a batch of edits in order
+    void apply(const std::vector<wall_edit> & edits) { apply(edits.data(), edits.size()); }
+
+    void apply(const wall_edit * edits, size_t count)
+    {
+        // Check the whole batch first, so a bad edit leaves the maze as it was
+        for (size_t i = 0; i < count; i++) {
+            const wall_edit & edit = edits[i];
+            if (!maze.contains(edit.x, edit.y) || edit.direction < DIR_LEFT || edit.direction > DIR_DOWN) {
+                throw std::invalid_argument("edit of cell (" + std::to_string(edit.x) + ", " + std::to_string(edit.y) +
+                                            ") direction " + std::to_string(edit.direction) + " is outside the maze");
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            const wall_edit & edit = edits[i];
+            int x = edit.x + DIR_DX[edit.direction], y = edit.y + DIR_DY[edit.direction];
+            // The outer border stays closed, and a wall already as asked needs nothing
+            if (!maze.contains(x, y) || maze.hasWall(edit.x, edit.y, edit.direction) != edit.open) {
+                continue;
+            }
+            uint32_t a = cellIndex(edit.x, edit.y), b = cellIndex(x, y);
+            if (edit.open) {
+                maze.removeWall(edit.x, edit.y, edit.direction);
+                if (label[a] != label[b]) {
+                    join(a, b);
+                }
+            }
+            else {
+                maze.addWall(edit.x, edit.y, edit.direction);
+                split(a, b);
+            }
+            if (position[a] != MAZE_OFF_PATH && position[b] != MAZE_OFF_PATH) {
+                path_change change = {std::min(position[a], position[b]), std::max(position[a], position[b]), edit.open};
+                pathChanges.push_back(change);
+            }
+        }
+        updatePath();
+    }
+
+    // Check if there is a path between two cells
+    bool connected(int x1, int y1, int x2, int y2) const {
+        return maze.contains(x1, y1) && maze.contains(x2, y2) && label[cellIndex(x1, y1)] == label[cellIndex(x2, y2)];
+    }
+
+    // Number of connected parts of the maze, 1 for a connected maze
+    long long componentCount() const { return components; }
+
+    bool hasPath() const { return !pathCells.empty(); }
+
+    // Steps of the current path, -1 without a path
+    long long pathLength() const { return (long long)pathCells.size() - 1; }
+
+    // The current path. On success moves holds the direction of every step from the entry, last
+    // step on top, as writing_path_file expects.
+    bool path(Stack<unsigned char> & moves) const
+    {
+        if (pathCells.empty()) {
+            return false;
+        }
+        moves.reserve(moves.size() + pathCells.size() - 1);
+        for (size_t i = 1; i < pathCells.size(); i++) {
+            moves.push((unsigned char)stepDirection(pathCells[i - 1], pathCells[i]));
+        }
+        return true;
+    }
+
+    // Cells visited by relabelling and searching since the editor was made, the work the edits took
+    long long cellsSearched() const { return searched; }
+
+private:
+    // parent byte: 0 unseen, SEEN for the start of a search, otherwise the direction of the step
+    // that reached the cell; OTHER_SIDE marks the cells of the search from the second side of a
+    // closed wall
+    static const unsigned char SEEN = 7;
+    static const unsigned char STEP = 7;
+    static const unsigned char OTHER_SIDE = 8;
+
+    uint32_t cellIndex(int x, int y) const { return (uint32_t)y * (uint32_t)columns + (uint32_t)x; }
+
+    // Neighbour of cell in the given direction if there is no wall in between
+    bool step(uint32_t cell, int direction, uint32_t & next) const
+    {
+        int x = (int)(cell % (uint32_t)columns), y = (int)(cell / (uint32_t)columns);
+        if (maze.hasWall(x, y, direction)) {
+            return false;
+        }
+        next = cellIndex(x + DIR_DX[direction], y + DIR_DY[direction]);
+        return true;
+    }
+
+    // Cell the step in the given direction came from
+    uint32_t stepBack(uint32_t cell, int direction) const {
+        return cellIndex((int)(cell % (uint32_t)columns) - DIR_DX[direction], (int)(cell / (uint32_t)columns) - DIR_DY[direction]);
+    }
+
+    // Direction of the step between two neighbouring cells
+    int stepDirection(uint32_t from, uint32_t to) const {
+        int dx = (int)(to % (uint32_t)columns) - (int)(from % (uint32_t)columns);
+        int dy = (int)(to / (uint32_t)columns) - (int)(from / (uint32_t)columns);
+        return dx < 0 ? DIR_LEFT : dx > 0 ? DIR_RIGHT : dy > 0 ? DIR_UP : DIR_DOWN;
+    }
+
+    // Check if two cells of the path are neighbours with an open wall between them
+    bool linked(uint32_t from, uint32_t to) const {
+        uint32_t next;
+        for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+            if (step(from, direction, next) && next == to) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t newLabel() {
+        if (!freeLabels.empty()) {
+            uint32_t free = freeLabels.back();
+            freeLabels.pop_back();
+            return free;
+        }
+        partSize.push_back(0);
+        return (uint32_t)partSize.size() - 1;
+    }
+
+    // Give every cell reached from start, through cells labelled from, the label to.
+    // Relabelling marks a cell as seen, so no other mark is needed.
+    uint32_t relabel(uint32_t start, uint32_t from, uint32_t to)
+    {
+        size_t head = 0, tail = 0;
+        label[start] = to;
+        queue[tail++] = start;
+        while (head < tail) {
+            uint32_t cell = queue[head++];
+            for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                uint32_t next;
+                if (step(cell, direction, next) && label[next] == from) {
+                    label[next] = to;
+                    queue[tail++] = next;
+                }
+            }
+        }
+        searched += (long long)tail;
+        return (uint32_t)tail;
+    }
+
+    // Label every part of the maze, as the editor starts
+    void labelParts()
+    {
+        const uint32_t UNLABELLED = UINT32_MAX;
+        std::fill(label.begin(), label.end(), UNLABELLED);
+        for (uint32_t cell = 0; cell < (uint32_t)label.size(); cell++) {
+            if (label[cell] == UNLABELLED) {
+                uint32_t part = newLabel();
+                partSize[part] = relabel(cell, UNLABELLED, part);
+                components++;
+            }
+        }
+    }
+
+    // A wall between two parts was opened: the smaller part takes the label of the larger one
+    void join(uint32_t a, uint32_t b)
+    {
+        uint32_t large = label[a], small = label[b];
+        if (partSize[large] < partSize[small]) {
+            std::swap(large, small);
+            std::swap(a, b);
+        }
+        relabel(b, small, large);
+        partSize[large] += partSize[small];
+        partSize[small] = 0;
+        freeLabels.push_back(small);
+        components--;
+    }
+
+    // Expand one cell of a split search; true when it reaches the search from the other side
+    bool expandSplit(uint32_t cell, unsigned char side, size_t & tail, bool forward)
+    {
+        for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+            uint32_t next;
+            if (!step(cell, direction, next)) continue;
+            if (parent[next] == 0) {
+                parent[next] = SEEN | side;
+                if (forward) {
+                    queue[tail++] = next;
+                }
+                else {
+                    queue[--tail] = next;
+                }
+            }
+            else if ((parent[next] & OTHER_SIDE) != side) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The wall between a and b was closed: search from both sides in turn, the first side's cells
+    // from the front of the queue and the second side's from the back, until they meet or one
+    // side runs out and becomes a part of its own
+    void split(uint32_t a, uint32_t b)
+    {
+        size_t n = queue.size();
+        size_t headA = 0, tailA = 0, headB = n, tailB = n;
+        parent[a] = SEEN;
+        queue[tailA++] = a;
+        parent[b] = SEEN | OTHER_SIDE;
+        queue[--headB] = b;
+        size_t nextB = n;     // Cells of the second side are expanded from the back, downwards
+        while (true) {
+            if (headA == tailA) {
+                separate(0, tailA);
+                break;
+            }
+            if (expandSplit(queue[headA++], 0, tailA, true)) {
+                break;
+            }
+            if (nextB == headB) {
+                separate(headB, tailB);
+                break;
+            }
+            if (expandSplit(queue[--nextB], OTHER_SIDE, headB, false)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < tailA; i++) {
+            parent[queue[i]] = 0;
+        }
+        for (size_t i = headB; i < tailB; i++) {
+            parent[queue[i]] = 0;
+        }
+        searched += (long long)(tailA + tailB - headB);
+    }
+
+    // The cells queue[begin, end) are a part of their own now
+    void separate(size_t begin, size_t end)
+    {
+        uint32_t part = newLabel(), old = label[queue[begin]];
+        for (size_t i = begin; i < end; i++) {
+            label[queue[i]] = part;
+        }
+        partSize[part] = (uint32_t)(end - begin);
+        partSize[old] -= (uint32_t)(end - begin);
+        components++;
+    }
+
+    // Shortest way from cell (at position at of the path) to the nearest later cell of the path.
+    // The cells of the detour after cell are added to walk, and the position it rejoins returned.
+    uint32_t bypass(uint32_t cell, uint32_t at, std::vector<uint32_t> & walk)
+    {
+        size_t head = 0, tail = 0;
+        parent[cell] = SEEN;
+        queue[tail++] = cell;
+        uint32_t rejoin = cell;
+        while (rejoin == cell && head < tail) {
+            uint32_t current = queue[head++];
+            for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                uint32_t next;
+                if (!step(current, direction, next) || parent[next] != 0) continue;
+                parent[next] = (unsigned char)direction;
+                queue[tail++] = next;
+                if (position[next] != MAZE_OFF_PATH && position[next] > at) {
+                    rejoin = next;
+                    break;
+                }
+            }
+        }
+        if (rejoin == cell) {
+            // Only possible if the labels were wrong: the exit is in the part of cell
+            throw std::logic_error("MazeEditor lost the path to the exit");
+        }
+        size_t start = walk.size();
+        for (uint32_t c = rejoin; c != cell; c = stepBack(c, parent[c] & STEP)) {
+            walk.push_back(c);
+        }
+        std::reverse(walk.begin() + (std::ptrdiff_t)start, walk.end());
+        for (size_t i = 0; i < tail; i++) {
+            parent[queue[i]] = 0;
+        }
+        searched += (long long)tail;
+        return position[rejoin];
+    }
+
+    // Make cells the path. A cell that comes twice is only given the position of its last visit,
+    // and each repeat is added to jumps as a pair of positions.
+    void setPath(std::vector<uint32_t> & cells, std::vector<std::pair<uint32_t, uint32_t> > & jumps)
+    {
+        for (size_t i = 0; i < pathCells.size(); i++) {
+            position[pathCells[i]] = MAZE_OFF_PATH;
+        }
+        pathCells.swap(cells);
+        for (uint32_t i = 0; i < (uint32_t)pathCells.size(); i++) {
+            uint32_t & at = position[pathCells[i]];
+            if (at != MAZE_OFF_PATH) {
+                jumps.push_back(std::make_pair(at, i));
+            }
+            at = i;
+        }
+    }
+
+    // Bring the path up to date after a batch, from the edits between cells of the path
+    void updatePath()
+    {
+        std::vector<path_change> changes;
+        changes.swap(pathChanges);
+        std::vector<std::pair<uint32_t, uint32_t> > jumps;
+        std::vector<uint32_t> walk;
+        if (label[entry] != label[exit]) {
+            setPath(walk, jumps);
+            return;
+        }
+        std::vector<uint32_t> broken;
+        if (pathCells.empty()) {
+            // Newly connected: a path of one closed link from the entry to the exit, bypassed below
+            walk.push_back(entry);
+            if (exit != entry) {
+                walk.push_back(exit);
+                broken.push_back(0);
+            }
+            setPath(walk, jumps);
+        }
+        for (size_t i = 0; i < changes.size(); i++) {
+            if (!changes[i].open && changes[i].to == changes[i].from + 1 && !linked(pathCells[changes[i].from], pathCells[changes[i].to])) {
+                broken.push_back(changes[i].from);
+            }
+        }
+        if (broken.empty() && changes.empty()) {
+            return;
+        }
+        std::sort(broken.begin(), broken.end());
+
+        // Copy the path up to each closed link and bypass it; the detours are new to the path
+        std::vector<std::pair<size_t, size_t> > detours;
+        walk.reserve(pathCells.size());
+        size_t next = 0;    // Position of the next path cell to copy
+        for (size_t b = 0; b < broken.size(); b++) {
+            uint32_t at = broken[b];
+            if (at + 1 < next) {
+                continue;       // Inside a part the last detour went around
+            }
+            walk.insert(walk.end(), pathCells.begin() + (std::ptrdiff_t)next, pathCells.begin() + (std::ptrdiff_t)at + 1);
+            size_t start = walk.size();
+            next = (size_t)bypass(pathCells[at], at, walk) + 1;
+            detours.push_back(std::make_pair(start, walk.size() - 1));
+        }
+        walk.insert(walk.end(), pathCells.begin() + (std::ptrdiff_t)next, pathCells.end());
+
+        // Positions in the walk, and the pairs of them that a path can jump between: a cell the
+        // detours came back to, a wall opened between two cells (and not closed again later in the
+        // batch), and a detour cell next to another cell of the walk. Anywhere else the walk has no
+        // shortcut, as the last path had none.
+        std::vector<uint32_t> opened;
+        for (size_t i = 0; i < changes.size(); i++) {
+            if (changes[i].open && linked(pathCells[changes[i].from], pathCells[changes[i].to])) {
+                opened.push_back(pathCells[changes[i].from]);
+                opened.push_back(pathCells[changes[i].to]);
+            }
+        }
+        setPath(walk, jumps);
+        for (size_t i = 0; i + 1 < opened.size(); i += 2) {
+            uint32_t from = position[opened[i]], to = position[opened[i + 1]];
+            if (from != MAZE_OFF_PATH && to != MAZE_OFF_PATH) {
+                jumps.push_back(std::make_pair(std::min(from, to), std::max(from, to)));
+            }
+        }
+        for (size_t d = 0; d < detours.size(); d++) {
+            for (size_t i = detours[d].first; i < detours[d].second; i++) {
+                uint32_t at = position[pathCells[i]], next;
+                for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                    if (step(pathCells[at], direction, next) && position[next] != MAZE_OFF_PATH) {
+                        jumps.push_back(std::make_pair(std::min(at, position[next]), std::max(at, position[next])));
+                    }
+                }
+            }
+        }
+        if (jumps.empty()) {
+            return;
+        }
+
+        // Go along the walk, from every cell to its last visit (cutting out any loop through it,
+        // however many times the detours came back to it) and from there by the jump that reaches
+        // the latest cell. Positions only grow, so no cell is left on the path twice.
+        std::sort(jumps.begin(), jumps.end());
+        std::vector<uint32_t> shortened;
+        shortened.reserve(pathCells.size());
+        size_t j = 0;
+        for (size_t k = 0; k < pathCells.size(); ) {
+            k = position[pathCells[k]];
+            shortened.push_back(pathCells[k]);
+            while (j < jumps.size() && jumps[j].first < k) {
+                j++;
+            }
+            size_t to = k + 1;
+            for (; j < jumps.size() && jumps[j].first == k; j++) {
+                to = std::max(to, (size_t)jumps[j].second);
+            }
+            k = to;
+        }
+        jumps.clear();
+        setPath(shortened, jumps);
+    }
+
+    MazeGrid & maze;
+    int columns;
+    uint32_t entry, exit;
+    std::vector<uint32_t> label;
+    std::vector<uint32_t> partSize;     // Cells per label, 0 for a free label
+    std::vector<uint32_t> freeLabels;
+    std::vector<uint32_t> pathCells;
+    std::vector<uint32_t> position;     // Position of each cell on the path, MAZE_OFF_PATH if none
+    // Edits of this batch between two cells of the path, by their positions
+    struct path_change {
+        uint32_t from, to;
+        bool open;
+    };
+    std::vector<path_change> pathChanges;
+    std::vector<uint32_t> queue;
+    std::vector<unsigned char> parent;
+    long long components;
+    long long searched;
+};
+
+#endif /* MazeEditor_h */
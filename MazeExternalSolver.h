@@ -0,0 +1,618 @@
+//
+//  MazeExternalSolver.h
+//
+//  Path finder for binary maze files larger than the memory it may use. The maze is read in
+//  bands of rows and flooded one band at a time with the block fill of MazeFloodSolver.h; the
+//  reached cells and their steps are spilled to a scratch file between bands, so the working
+//  set stays under a given number of bytes however large the maze is.
+//
+
+#ifndef MazeExternalSolver_h
+#define MazeExternalSolver_h
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include "Stack.h"
+#include "MazeGrid.h"
+#include "MazeFile.h"
+#include "MazeFloodSolver.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Memory the out-of-core solver may use when no limit is given (256 MB)
+const size_t DEFAULT_SOLVER_MEMORY = (size_t)256 << 20;
+
+// Memory size from the command line: a number of bytes, or a number with a K, M or G suffix
+inline size_t memory_size_from_name(const std::string & name) {
+    size_t digits = 0;
+    while (digits < name.size() && name[digits] >= '0' && name[digits] <= '9') {
+        digits++;
+    }
+    std::string suffix = name.substr(digits);
+    uint64_t scale = suffix.empty() || suffix == "B" ? 1 : suffix == "K" ? (uint64_t)1 << 10 :
+                     suffix == "M" ? (uint64_t)1 << 20 : suffix == "G" ? (uint64_t)1 << 30 : 0;
+    if (digits == 0 || digits > 12 || scale == 0) {
+        throw std::invalid_argument("bad memory size " + name + " (bytes, or a number with K, M or G)");
+    }
+    return (size_t)(std::stoull(name.substr(0, digits)) * scale);
+}
+
+// A file read and written at given offsets, counting the bytes that go through it. Made from a
+// name it opens that file for reading; made from a directory it creates an empty scratch file
+// there that is removed when it is closed.
+class OutOfCoreFile
+{
+public:
+    explicit OutOfCoreFile(const std::string & filename)
+        : name(filename), scratch(false), readBytes(0), writtenBytes(0)
+    {
+#if !defined(_WIN32)
+        fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + filename);
+        }
+#else
+        file.open(filename, std::ios::in | std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("cannot open " + filename);
+        }
+#endif
+    }
+
+    OutOfCoreFile(const std::string & directory, const char * purpose)
+        : scratch(true), readBytes(0), writtenBytes(0)
+    {
+#if !defined(_WIN32)
+        std::string pattern = directory + "/maze_" + purpose + "_XXXXXX";
+        std::vector<char> path(pattern.begin(), pattern.end());
+        path.push_back('\0');
+        fd = mkstemp(path.data());
+        if (fd < 0) {
+            throw std::runtime_error("cannot create a scratch file in " + directory);
+        }
+        // The name goes at once; the file lives until it is closed
+        unlink(path.data());
+        name = path.data();
+#else
+        static int counter = 0;
+        name = directory + "/maze_" + purpose + "_" + std::to_string(counter++) + ".tmp";
+        file.open(name, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("cannot create a scratch file in " + directory);
+        }
+#endif
+    }
+
+    ~OutOfCoreFile() {
+#if !defined(_WIN32)
+        close(fd);
+#else
+        file.close();
+        if (scratch) {
+            std::remove(name.c_str());
+        }
+#endif
+    }
+
+    OutOfCoreFile(const OutOfCoreFile &) = delete;
+    OutOfCoreFile & operator=(const OutOfCoreFile &) = delete;
+
+    // Read bytes at offset; the part past the end of the file reads as zeros
+    void read(uint64_t offset, void * buffer, size_t bytes)
+    {
+        char * out = static_cast<char *>(buffer);
+        size_t done = 0;
+#if !defined(_WIN32)
+        while (done < bytes) {
+            ssize_t count = pread(fd, out + done, bytes - done, (off_t)(offset + done));
+            if (count < 0 && errno == EINTR) continue;
+            if (count < 0) throw std::runtime_error("cannot read " + name);
+            if (count == 0) break;
+            done += (size_t)count;
+        }
+#else
+        file.clear();
+        file.seekg((std::streamoff)offset);
+        file.read(out, (std::streamsize)bytes);
+        done = file.gcount() > 0 ? (size_t)file.gcount() : 0;
+#endif
+        std::fill(out + done, out + bytes, 0);
+        readBytes += bytes;
+    }
+
+    void write(uint64_t offset, const void * buffer, size_t bytes)
+    {
+        const char * in = static_cast<const char *>(buffer);
+#if !defined(_WIN32)
+        size_t done = 0;
+        while (done < bytes) {
+            ssize_t count = pwrite(fd, in + done, bytes - done, (off_t)(offset + done));
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) throw std::runtime_error("cannot write " + name);
+            done += (size_t)count;
+        }
+#else
+        file.clear();
+        file.seekp((std::streamoff)offset);
+        file.write(in, (std::streamsize)bytes);
+        if (!file) throw std::runtime_error("cannot write " + name);
+#endif
+        writtenBytes += bytes;
+    }
+
+    // Drop the contents of a scratch file, so everything reads as zeros again
+    void clear()
+    {
+#if !defined(_WIN32)
+        if (ftruncate(fd, 0) != 0) {
+            throw std::runtime_error("cannot clear " + name);
+        }
+#else
+        file.close();
+        file.open(name, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+#endif
+    }
+
+    uint64_t bytesRead() const { return readBytes; }
+    uint64_t bytesWritten() const { return writtenBytes; }
+
+private:
+    std::string name;
+    bool scratch;
+#if !defined(_WIN32)
+    int fd;
+#else
+    std::fstream file;
+#endif
+    uint64_t readBytes;
+    uint64_t writtenBytes;
+};
+
+// Out-of-core path finder over a binary maze file (header, then the right and up wall words of
+// every row, see MazeFile.h).
+//
+// The rows are cut into bands as tall as the memory limit allows. A band is read with a row of
+// reached cells on either side of it (its halo) and flooded until nothing more can be reached
+// inside it, then its reached cells and steps go back to the scratch file. A band whose border
+// row opens onto unreached cells of the next band marks that band for another visit. The bands
+// are swept upwards and downwards in turn, each sweep (an I/O pass) visiting only the marked
+// bands, until the exit is reached or no band is marked. A flooded band stays closed until its
+// halo changes, so a visit only restarts the fill from its two border rows, and its rows are
+// read in chunks of 8 when the fill gets to them; only the chunks that changed are written back.
+//
+// The path is then read back from the steps, a band of rows at a time around the cell being
+// traced, into a scratch file of 2 bits per step that is read backwards to write the path file.
+// The path is the only one in a perfect maze and a valid one in a maze with loops, as with
+// FloodSolver.
+//
+// Memory: the wall words and 3 bits of state per cell of a band, a byte and a stack entry per
+// block of 256 cells, and fixed buffers. Disk: 3 bits per cell of scratch state.
+class OutOfCoreSolver
+{
+public:
+    // Memory limit in bytes for everything the solver keeps; scratch files go to scratchDirectory
+    OutOfCoreSolver(const std::string & mazeFilename, size_t memoryLimit, const std::string & scratchDirectory = ".",
+                    bool vectorized = true)
+        : mazeFile(mazeFilename), spill(scratchDirectory, "state"), steps(scratchDirectory, "steps"),
+          useAvx2(vectorized && flood_cpu_has_avx2()), entryX(0), entryY(0), exitX(0), exitY(0), found(false), stepCount(0), passCount(0), loadCount(0), explored(0)
+    {
+        memset(&header, 0, sizeof(header));
+        mazeFile.read(0, &header, sizeof(header));
+        std::ifstream sizeCheck(mazeFilename, std::ios::binary | std::ios::ate);
+        check_maze_header(header, (uint64_t)sizeCheck.tellg(), mazeFilename);
+        rows = (int)header.rows;
+        columns = (int)header.columns;
+        mazeWords = (size_t)header.words_per_row;
+        blocksPerRow = (mazeWords + FLOOD_BLOCK_WORDS - 1) / FLOOD_BLOCK_WORDS;
+        stride = blocksPerRow * FLOOD_BLOCK_WORDS;
+
+        // One band row: its two wall planes, three state planes, and a state byte and a
+        // stack entry per block. Fixed: the halo rows, the wall row under the band and the
+        // two step buffers.
+        size_t rowBytes = (2 * mazeWords + 3 * stride) * sizeof(uint64_t) + blocksPerRow * (1 + sizeof(uint32_t));
+        size_t fixedBytes = (2 * mazeWords + 6 * stride) * sizeof(uint64_t) + 2 * STEP_BUFFER_BYTES;
+        if (memoryLimit < fixedBytes + rowBytes) {
+            throw std::invalid_argument("memory limit of " + std::to_string(memoryLimit) + " bytes is below the " +
+                                        std::to_string(fixedBytes + rowBytes) + " bytes one row of this maze needs");
+        }
+        size_t fit = (memoryLimit - fixedBytes) / rowBytes;
+        bandRowCount = fit < (size_t)rows ? (int)fit : rows;
+        if (bandRowCount < 1) {
+            bandRowCount = 1;
+        }
+        bandCount = (rows + bandRowCount - 1) / bandRowCount;
+
+        walls.resize((size_t)(bandRowCount + 1) * 2 * mazeWords);
+        state.resize((size_t)(bandRowCount + 2) * 3 * stride);
+        blockState.resize((size_t)bandRowCount * blocksPerRow);
+        chunkState.resize(((size_t)bandRowCount + CHUNK_ROWS - 1) / CHUNK_ROWS);
+        stepBuffer.reserve(STEP_BUFFER_BYTES);
+    }
+
+    int mazeRows() const { return rows; }
+    int mazeColumns() const { return columns; }
+
+    // Find a path from the entry to the exit; the path can then be written with writePath
+    bool solve(int x_entry, int y_entry, int x_exit, int y_exit)
+    {
+        spill.clear();
+        steps.clear();
+        stepCount = 0;
+        passCount = 0;
+        loadCount = 0;
+        explored = 0;
+        entryX = x_entry;
+        entryY = y_entry;
+        exitX = x_exit;
+        exitY = y_exit;
+        found = false;
+        if (x_entry < 0 || x_entry >= columns || y_entry < 0 || y_entry >= rows ||
+            x_exit < 0 || x_exit >= columns || y_exit < 0 || y_exit >= rows) {
+            return false;
+        }
+        explored = 1;
+        if (x_entry == x_exit && y_entry == y_exit) {
+            found = true;
+            return true;
+        }
+
+        std::vector<unsigned char> marked(bandCount, 0);
+        marked[y_entry / bandRowCount] = 1;
+        bool entrySeeded = false;
+        bool upwards = true;
+        while (!found) {
+            bool visited = false;
+            for (int i = 0; i < bandCount && !found; i++) {
+                int band = upwards ? i : bandCount - 1 - i;
+                if (!marked[band]) {
+                    continue;
+                }
+                marked[band] = 0;
+                visited = true;
+                int y0 = band * bandRowCount;
+                bool seedEntry = !entrySeeded && y_entry >= y0 && y_entry < y0 + bandRowCount;
+                entrySeeded = entrySeeded || seedEntry;
+                found = floodBand(band, seedEntry ? x_entry : -1, seedEntry ? y_entry - y0 + 1 : -1, marked);
+            }
+            if (!visited) {
+                break;
+            }
+            passCount++;
+            upwards = !upwards;
+        }
+        if (found) {
+            tracePath(x_exit, y_exit);
+        }
+        return found;
+    }
+
+    // Write the path of the last query to its path file, or an empty file when there is none
+    void writePath(int mazeID, int x_exit, int y_exit, path_file_format format)
+    {
+        std::string filename = path_file_name(mazeID, entryX, entryY, x_exit, y_exit, format);
+        if (!found) {
+            std::ofstream emptyPath(filename);
+            return;
+        }
+        if (format == PATH_FORMAT_COMPACT) {
+            CompactPathWriter writer(filename, entryX, entryY);
+            forEachStep([&](int direction) { writer.step(direction); });
+            writer.finish();
+            return;
+        }
+        std::ofstream outFile(filename);
+        int x = entryX, y = entryY;
+        outFile << x << " " << y << '\n';
+        forEachStep([&](int direction) {
+            x += DIR_DX[direction];
+            y += DIR_DY[direction];
+            outFile << x << " " << y << '\n';
+        });
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + filename);
+        }
+    }
+
+    // Push the steps of the last path onto moves, first step at the bottom (for paths that fit in memory)
+    void path(Stack<unsigned char> & moves)
+    {
+        moves.reserve(moves.size() + (size_t)stepCount);
+        forEachStep([&](int direction) { moves.push((unsigned char)direction); });
+    }
+
+    // Steps of the last path, cells it reached, I/O passes (sweeps over the bands), band reads,
+    // and the bytes moved from and to the maze and scratch files
+    long long pathLength() const { return found ? (long long)stepCount : -1; }
+    long long cellsExplored() const { return explored; }
+    long long passes() const { return passCount; }
+    long long bandLoads() const { return loadCount; }
+    uint64_t bytesRead() const { return mazeFile.bytesRead() + spill.bytesRead() + steps.bytesRead(); }
+    uint64_t bytesWritten() const { return spill.bytesWritten() + steps.bytesWritten(); }
+
+    // Rows in a band, and the number of bands
+    int bandRows() const { return bandRowCount; }
+    int bands() const { return bandCount; }
+
+private:
+    static const size_t STEP_BUFFER_BYTES = 1 << 12;
+    static const unsigned char QUEUED = 1;
+    static const unsigned char DONE = 2;
+    static const int CHUNK_ROWS = 8;
+    static const unsigned char CHUNK_LOADED = 1;
+    static const unsigned char CHUNK_CHANGED = 2;
+
+    // Local row r of a band is maze row y0 + r - 1: row 0 and row bandRowCount + 1 are the halo
+    uint64_t * reachRow(int r) { return &state[(size_t)r * 3 * stride]; }
+    uint64_t * lowRow(int r) { return reachRow(r) + stride; }
+    uint64_t * highRow(int r) { return reachRow(r) + 2 * stride; }
+
+    // Wall row r holds the walls of maze row y0 + r - 1 (row 0 only for its up walls)
+    const uint64_t * rightWalls(int r) const { return &walls[(size_t)r * 2 * mazeWords]; }
+    const uint64_t * upWalls(int r) const { return &walls[(size_t)r * 2 * mazeWords + mazeWords]; }
+
+    uint64_t wallOffset(int y) const { return sizeof(maze_file_header) + (uint64_t)y * 2 * mazeWords * sizeof(uint64_t); }
+    uint64_t stateOffset(int y) const { return (uint64_t)y * 3 * stride * sizeof(uint64_t); }
+
+    // Start a band of rows y0 .. y1 - 1: read the reached cells of its halo rows and the walls of
+    // the row underneath; its own rows are read a chunk at a time when the fill gets to them
+    void openBand(int y0, int y1)
+    {
+        loadCount++;
+        bandFirstRow = y0;
+        bandHeight = y1 - y0;
+        std::fill(chunkState.begin(), chunkState.end(), 0);
+        std::fill(reachRow(0), reachRow(0) + stride, 0);
+        std::fill(reachRow(bandHeight + 1), reachRow(bandHeight + 1) + stride, 0);
+        if (y0 > 0) {
+            spill.read(stateOffset(y0 - 1), reachRow(0), stride * sizeof(uint64_t));
+            mazeFile.read(wallOffset(y0 - 1), &walls[0], 2 * mazeWords * sizeof(uint64_t));
+        }
+        if (y1 < rows) {
+            spill.read(stateOffset(y1), reachRow(bandHeight + 1), stride * sizeof(uint64_t));
+        }
+    }
+
+    // Make sure local row r (1 .. bandHeight) of the band is in memory
+    void needRow(int r)
+    {
+        size_t chunk = (size_t)(r - 1) / CHUNK_ROWS;
+        if (chunkState[chunk] & CHUNK_LOADED) {
+            return;
+        }
+        int first = 1 + (int)chunk * CHUNK_ROWS;
+        int count = first + CHUNK_ROWS - 1 <= bandHeight ? CHUNK_ROWS : bandHeight - first + 1;
+        int y = bandFirstRow + first - 1;
+        mazeFile.read(wallOffset(y), &walls[(size_t)first * 2 * mazeWords], (size_t)count * 2 * mazeWords * sizeof(uint64_t));
+        spill.read(stateOffset(y), reachRow(first), (size_t)count * 3 * stride * sizeof(uint64_t));
+        chunkState[chunk] = CHUNK_LOADED;
+    }
+
+    // Write the chunks of the band that reached new cells back to the scratch file
+    void closeBand()
+    {
+        for (size_t chunk = 0; chunk < chunkState.size(); chunk++) {
+            if (!(chunkState[chunk] & CHUNK_CHANGED)) {
+                continue;
+            }
+            int first = 1 + (int)chunk * CHUNK_ROWS;
+            int count = first + CHUNK_ROWS - 1 <= bandHeight ? CHUNK_ROWS : bandHeight - first + 1;
+            spill.write(stateOffset(bandFirstRow + first - 1), reachRow(first), (size_t)count * 3 * stride * sizeof(uint64_t));
+        }
+    }
+
+    // Read the state of rows y0 .. y1 - 1 into the band rows, for following the steps
+    void loadSteps(int y0, int y1)
+    {
+        loadCount++;
+        spill.read(stateOffset(y0), reachRow(1), (size_t)(y1 - y0) * 3 * stride * sizeof(uint64_t));
+    }
+
+    // Flood one band to closure (or until the exit is reached), write it back and mark the bands
+    // its border rows open onto. (x_entry, entryRow) is a cell to reach first, entryRow -1 for none.
+    // Returns true when the exit was reached.
+    bool floodBand(int band, int x_entry, int entryRow, std::vector<unsigned char> & marked)
+    {
+        int y0 = band * bandRowCount;
+        int y1 = y0 + bandRowCount < rows ? y0 + bandRowCount : rows;
+        int height = y1 - y0;
+        openBand(y0, y1);
+
+        std::fill(blockState.begin(), blockState.end(), 0);
+        pending.clear();
+        if (entryRow > 0) {
+            needRow(entryRow);
+            reachRow(entryRow)[x_entry >> 6] |= (uint64_t)1 << (x_entry & 63);
+            chunkState[(size_t)(entryRow - 1) / CHUNK_ROWS] |= CHUNK_CHANGED;
+            size_t b = (size_t)(x_entry >> 6) / FLOOD_BLOCK_WORDS;
+            push(entryRow, b);
+            if (entryRow < height) push(entryRow + 1, b);
+            if (entryRow > 1) push(entryRow - 1, b);
+            if (b + 1 < blocksPerRow) push(entryRow, b + 1);
+            if (b > 0) push(entryRow, b - 1);
+        }
+        // Anything new comes in over the border rows
+        for (size_t b = 0; b < blocksPerRow; b++) {
+            if (y0 > 0) push(1, b);
+            if (y1 < rows) push(height, b);
+        }
+        // The exit can only be reached once its chunk is in memory
+        bool exitInBand = exitY >= y0 && exitY < y1;
+        int exitRow = exitY - y0 + 1;
+        const unsigned char * exitChunk = exitInBand ? &chunkState[(size_t)(exitRow - 1) / CHUNK_ROWS] : NULL;
+        const uint64_t * exitWord = exitInBand ? &reachRow(exitRow)[exitX >> 6] : NULL;
+        uint64_t exitBit = (uint64_t)1 << (exitX & 63);
+        bool exitReached = false;
+        while (!pending.empty() && !exitReached) {
+            uint32_t blockIndex = pending.back();
+            pending.pop_back();
+            blockState[blockIndex] = DONE;
+            expand((int)(blockIndex / blocksPerRow) + 1, blockIndex % blocksPerRow);
+            exitReached = exitInBand && (*exitChunk & CHUNK_LOADED) && (*exitWord & exitBit);
+        }
+        if (y0 > 0) needRow(1);
+        if (y1 < rows) needRow(height);
+        closeBand();
+
+        // Mark the neighbours whose border cells can be reached from here
+        uint64_t upward = 0, downward = 0;
+        for (size_t w = 0; w < mazeWords; w++) {
+            if (y1 < rows) upward |= reachRow(height)[w] & ~upWalls(height)[w] & ~reachRow(height + 1)[w];
+            if (y0 > 0) downward |= reachRow(1)[w] & ~upWalls(0)[w] & ~reachRow(0)[w];
+        }
+        if (upward) marked[band + 1] = 1;
+        if (downward) marked[band - 1] = 1;
+        return exitReached;
+    }
+
+    void push(int r, size_t b)
+    {
+        uint32_t blockIndex = (uint32_t)((size_t)(r - 1) * blocksPerRow + b);
+        if (blockState[blockIndex] == QUEUED) {
+            return;
+        }
+        blockState[blockIndex] = QUEUED;
+        pending.push_back(blockIndex);
+    }
+
+    // Fill block b of local row r and push the blocks of the band its new cells open onto
+    void expand(int r, size_t b)
+    {
+        int height = bandHeight;
+        needRow(r);
+        if (r > 1) needRow(r - 1);
+        if (r < height) needRow(r + 1);
+        size_t firstWord = b * FLOOD_BLOCK_WORDS;
+        uint64_t * row = reachRow(r);
+        flood_block block;
+        flood_load_block(row, reachRow(r - 1), reachRow(r + 1), rightWalls(r), bandFirstRow + r < rows ? upWalls(r) : NULL,
+                         r > 1 || bandFirstRow > 0 ? upWalls(r - 1) : NULL, mazeWords, columns, b, block);
+        flood_result result;
+        if (!flood_fill_block(block, result, useAvx2)) {
+            return;
+        }
+        chunkState[(size_t)(r - 1) / CHUNK_ROWS] |= CHUNK_CHANGED;
+
+        uint64_t upward = 0, downward = 0;
+        for (int i = 0; i < FLOOD_BLOCK_WORDS; i++) {
+            uint64_t reached = result.reached[i];
+            if (reached == 0) continue;
+            row[firstWord + i] |= reached;
+            lowRow(r)[firstWord + i] |= result.low[i];
+            highRow(r)[firstWord + i] |= result.high[i];
+            explored += count_bits(reached);
+            upward |= reached & block.openUp[i] & ~block.above[i];
+            downward |= reached & block.openDown[i] & ~block.below[i];
+        }
+        if (upward && r < height) push(r + 1, b);
+        if (downward && r > 1) push(r - 1, b);
+        if (firstWord + FLOOD_BLOCK_WORDS < mazeWords &&
+            ((result.reached[FLOOD_BLOCK_WORDS - 1] & block.openRight[FLOOD_BLOCK_WORDS - 1]) >> 63) &&
+            !(row[firstWord + FLOOD_BLOCK_WORDS] & 1)) {
+            push(r, b + 1);
+        }
+        if (b > 0 && (result.reached[0] & 1) && !(rightWalls(r)[firstWord - 1] >> 63) && !(row[firstWord - 1] >> 63)) {
+            push(r, b - 1);
+        }
+    }
+
+    // Follow the steps back from the exit, loading the band of rows around the cell being traced
+    void tracePath(int x, int y)
+    {
+        stepBuffer.clear();
+        int y0 = 0, y1 = 0;
+        while (x != entryX || y != entryY) {
+            if (y < y0 || y >= y1) {
+                y0 = y - bandRowCount / 2 > 0 ? y - bandRowCount / 2 : 0;
+                y1 = y0 + bandRowCount < rows ? y0 + bandRowCount : rows;
+                loadSteps(y0, y1);
+            }
+            int r = y - y0 + 1;
+            size_t word = (size_t)(x >> 6);
+            int shift = x & 63;
+            int direction = 1 + (int)((lowRow(r)[word] >> shift) & 1) + 2 * (int)((highRow(r)[word] >> shift) & 1);
+            writeStep(direction);
+            x -= DIR_DX[direction];
+            y -= DIR_DY[direction];
+        }
+        flushSteps();
+    }
+
+    // Steps are packed 4 to a byte in tracing order, the last step of the path first
+    void writeStep(int direction)
+    {
+        if ((stepCount & 3) == 0) {
+            if (stepBuffer.size() == STEP_BUFFER_BYTES) {
+                flushSteps();
+            }
+            stepBuffer.push_back(0);
+        }
+        stepBuffer.back() |= (unsigned char)((direction - 1) << (2 * (stepCount & 3)));
+        stepCount++;
+    }
+
+    void flushSteps()
+    {
+        if (stepBuffer.empty()) {
+            return;
+        }
+        uint64_t firstByte = (stepCount - 1) / 4 + 1 - stepBuffer.size();
+        steps.write(firstByte, stepBuffer.data(), stepBuffer.size());
+        stepBuffer.clear();
+    }
+
+    // Call visit with every step of the path from the entry, reading the step file backwards
+    template <class Visit>
+    void forEachStep(Visit visit)
+    {
+        std::vector<unsigned char> buffer(STEP_BUFFER_BYTES);
+        uint64_t step = stepCount;
+        while (step > 0) {
+            uint64_t lastByte = (step - 1) / 4;
+            uint64_t firstByte = lastByte + 1 >= STEP_BUFFER_BYTES ? lastByte + 1 - STEP_BUFFER_BYTES : 0;
+            steps.read(firstByte, buffer.data(), (size_t)(lastByte + 1 - firstByte));
+            for (; step > firstByte * 4; step--) {
+                uint64_t t = step - 1;
+                visit(1 + ((buffer[(size_t)(t / 4 - firstByte)] >> (2 * (t & 3))) & 3));
+            }
+        }
+    }
+
+    OutOfCoreFile mazeFile;
+    OutOfCoreFile spill;
+    OutOfCoreFile steps;
+    maze_file_header header;
+    int rows, columns;
+    size_t mazeWords;
+    size_t blocksPerRow;
+    size_t stride;
+    int bandRowCount;
+    int bandCount;
+    int bandFirstRow;
+    int bandHeight;
+    std::vector<uint64_t> walls;
+    std::vector<uint64_t> state;
+    std::vector<unsigned char> blockState;
+    std::vector<unsigned char> chunkState;
+    std::vector<uint32_t> pending;
+    std::vector<unsigned char> stepBuffer;
+    bool useAvx2;
+    int entryX, entryY;
+    int exitX, exitY;
+    bool found;
+    uint64_t stepCount;
+    long long passCount;
+    long long loadCount;
+    long long explored;
+};
+
+#endif /* MazeExternalSolver_h */
@@ -0,0 +1,892 @@
+//
+//  MazeFile.h
+//
+//  Reading and writing maze files, in the text format (maze_N.txt), the binary format (maze_N.bin)
+//  and the compressed format (maze_N.rle), and path files as text or in the compact encoding.
+//
+
+#ifndef MazeFile_h
+#define MazeFile_h
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include "MazeGrid.h"
+#include "Stack.h"
+#include "MazeStats.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct cell_of_maze {
+
+    // Indicates whether there is an opening to the up/down/left/right from this cell
+    bool up;
+    bool down;
+    bool right;
+    bool left;
+    int x,y;  // The coordinates of the cell in the maze
+    bool is_visited; // Indicates whether this cell has been visited
+
+    // Constructor with parameters
+    cell_of_maze(): up(true), down(true), right(true), left(true), x(), y(), is_visited(false) {}
+
+    // Constructor with custom values
+    cell_of_maze(bool upValue, bool downValue, bool rightValue, bool leftValue, int xValue, int yValue, bool isVisitedValue)
+
+            : up(upValue), down(downValue), right(rightValue), left(leftValue), x(xValue), y(yValue), is_visited(isVisitedValue) {}
+
+    //Copy constructor
+    cell_of_maze(const cell_of_maze &other)
+            : up(other.up), down(other.down), right(other.right), left(other.left), x(other.x), y(other.y), is_visited(other.is_visited) {}
+};
+
+// Formats a maze file can be written in
+enum maze_file_format { MAZE_FORMAT_TEXT, MAZE_FORMAT_BINARY, MAZE_FORMAT_COMPRESSED };
+
+// Formats a path file can be written in
+enum path_file_format { PATH_FORMAT_TEXT, PATH_FORMAT_COMPACT };
+
+// Generation algorithms recorded in the maze files
+const uint32_t MAZE_ALGORITHM_BACKTRACKER = 0;
+const uint32_t MAZE_ALGORITHM_ELLER = 1;
+const uint32_t MAZE_ALGORITHM_TILED_BACKTRACKER = 2;
+const uint32_t MAZE_ALGORITHM_KRUSKAL = 3;
+const uint32_t MAZE_ALGORITHM_WILSON = 4;
+const uint32_t MAZE_ALGORITHM_PRIM = 5;
+const uint32_t MAZE_ALGORITHM_SIDEWINDER = 6;
+const uint32_t MAZE_ALGORITHM_BINARY_TREE = 7;
+const uint32_t MAZE_ALGORITHM_EDITED = 8;        // Walls edited after generation (MazeEditor.h), cannot be regenerated
+
+// Name of the file that holds maze mazeID in the given format
+inline std::string maze_file_name(int mazeID, maze_file_format format) {
+    if (format == MAZE_FORMAT_BINARY) return "maze_" + std::to_string(mazeID) + ".bin";
+    if (format == MAZE_FORMAT_COMPRESSED) return "maze_" + std::to_string(mazeID) + ".rle";
+    return "maze_" + std::to_string(mazeID) + ".txt";
+}
+
+// Name of the file that holds the path between an entry and an exit of maze mazeID
+inline std::string path_file_name(int mazeID, int x_entry, int y_entry, int x_exit, int y_exit, path_file_format format = PATH_FORMAT_TEXT) {
+    return "maze_" + std::to_string(mazeID) + "_path_" + std::to_string(x_entry) + "_" + std::to_string(y_entry) + "_" +
+           std::to_string(x_exit) + "_" + std::to_string(y_exit) + (format == PATH_FORMAT_COMPACT ? ".path" : ".txt");
+}
+
+// ---------------------------------------------------------------------------
+// Text format: a "rows columns seed [algorithm]" line, then one "x=.. y=.. l=.. r=.. u=.. d=.." line
+// per cell, column by column. The algorithm is left out for the backtracker, and files from before
+// the seed was recorded have no seed (read as 0).
+// ---------------------------------------------------------------------------
+
+// Read a text maze file into a grid, and the seed and algorithm it was generated with.
+// Only the right and up walls of each line are used, the left and down walls are the same walls seen from the neighbour.
+inline MazeGrid read_maze_file(const std::string & filename, uint64_t & seed, uint32_t & algorithm) {
+
+    int row = 0, column = 0;
+    seed = 0;
+    algorithm = MAZE_ALGORITHM_BACKTRACKER;
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("cannot open " + filename);
+    }
+    std::string x, y, left, right, up, down;
+
+    // Read the row and column information from the first line of the file
+    std::string line;
+    getline(file, line);
+    std::istringstream ss(line);
+    ss >> row >> column >> seed >> algorithm;
+    MazeGrid maze(row, column);
+
+    // Read each line of cell information from the file and store its walls in the grid
+    while(getline(file, line)) {
+        std::istringstream ss(line);
+        // Extract and store cell attributes
+        cell_of_maze cell;
+        ss>>x >> y>>left>>right>>up>>down;
+        cell.x = stoi(x.substr(2));
+        cell.y= stoi(y.substr(2));
+        cell.right = stoi(right.substr(2));
+        cell.up = stoi(up.substr(2));
+        if (!maze.contains(cell.x, cell.y)) {
+            throw std::runtime_error(filename + ": cell (" + std::to_string(cell.x) + ", " + std::to_string(cell.y) + ") is outside the maze");
+        }
+        maze.setWall(cell.x, cell.y, DIR_RIGHT, cell.right);
+        maze.setWall(cell.x, cell.y, DIR_UP, cell.up);
+    }
+    return maze;
+}
+
+inline MazeGrid read_maze_file(const std::string & filename, uint64_t & seed) {
+    uint32_t algorithm;
+    return read_maze_file(filename, seed, algorithm);
+}
+
+inline MazeGrid read_maze_file(const std::string & filename) {
+    uint64_t seed;
+    return read_maze_file(filename, seed);
+}
+
+// Write a maze to a text file, with the seed and algorithm it was generated with
+inline void write_text_maze(const MazeGrid & output_maze, const std::string & filename, uint64_t seed = 0,
+                            uint32_t algorithm = MAZE_ALGORITHM_BACKTRACKER) {
+
+    // Open the output file
+    std::ofstream outFile(filename);
+
+    // Write maze size (rows anf columns), seed and algorithm to the file
+    outFile << output_maze.rows() << " " << output_maze.columns() << " " << seed;
+    if (algorithm != MAZE_ALGORITHM_BACKTRACKER) {
+        outFile << " " << algorithm;
+    }
+    outFile << '\n';
+
+    // Write the cells in the desired order; '\n' instead of endl so the stream is not flushed on every line
+    for (int x = 0; x < output_maze.columns(); x++) {
+        for (int y = 0; y < output_maze.rows(); y++) {
+            outFile << "x=" << x << " y=" << y << " l=" << output_maze.hasWall(x, y, DIR_LEFT) << " r=" << output_maze.hasWall(x, y, DIR_RIGHT)
+                    << " u=" << output_maze.hasWall(x, y, DIR_UP) << " d=" << output_maze.hasWall(x, y, DIR_DOWN) << '\n';
+        }
+    }
+
+    // Close the file; a failed write (a full disk) shows in the stream state once it is flushed
+    outFile.close();
+    if (!outFile) {
+        throw std::runtime_error("cannot write " + filename);
+    }
+}
+
+// Write the path information to a file for a specific maze.
+// moves holds the direction of every step taken from the entry, the last step on top.
+inline void writing_path_file(Stack<unsigned char>& moves, int mazeID, int x_entry, int y_entry,int x_exit,int y_exit) {
+
+
+    // Generate the path file's filename based on mazeID and entry/exit coordinates
+    std::string filename = path_file_name(mazeID, x_entry, y_entry, x_exit, y_exit);
+    Stack<unsigned char> stack2;
+    stack2.reserve(moves.size());
+
+    // Open the output file for writing
+    std::ofstream outFile(filename);
+
+    // Copy the steps from moves to stack2 so the first step ends up on top
+    while(!moves.isEmpty()) {
+        stack2.push(moves.top());
+        moves.pop();
+    }
+
+    // Walk the steps from the entry and write the coordinates of the path cells to the output file
+    int x = x_entry, y = y_entry;
+    outFile << x << " "<<y << '\n';
+    while (!stack2.isEmpty()) {
+        x += DIR_DX[stack2.top()];
+        y += DIR_DY[stack2.top()];
+        outFile << x << " "<<y << '\n';
+        stack2.pop();
+
+    }
+    // Close the file, which flushes it, and report a failed write
+    outFile.close();
+    if (!outFile) {
+        throw std::runtime_error("cannot write " + filename);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Compact path format: a 32-byte header with the entry cell and the number of steps, then two
+// bits per step (direction - 1), four steps per byte starting from the low bits. The cells of
+// the path are found by walking the steps from the entry. As with text path files, an empty
+// file means there is no path.
+// ---------------------------------------------------------------------------
+
+const char MAZE_PATH_MAGIC[8] = {'M', 'A', 'Z', 'E', 'P', 'T', 'H', 0};
+const uint32_t MAZE_PATH_VERSION = 1;
+
+struct path_file_header {
+    char magic[8];        // MAZE_PATH_MAGIC
+    uint32_t version;     // MAZE_PATH_VERSION
+    uint32_t reserved;    // Zero
+    int32_t x_entry;
+    int32_t y_entry;
+    uint64_t steps;       // Number of 2-bit steps after the header
+};
+
+static_assert(sizeof(path_file_header) == 32, "the compact path header must stay 32 bytes");
+
+// Writes a compact path file one step at a time; the step count goes into the header at the end
+class CompactPathWriter
+{
+public:
+    CompactPathWriter(const std::string & filename, int x_entry, int y_entry)
+        : outFile(filename, std::ios::binary), name(filename), stepCount(0), pending(0)
+    {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAZE_PATH_MAGIC, sizeof(header.magic));
+        header.version = MAZE_PATH_VERSION;
+        header.x_entry = x_entry;
+        header.y_entry = y_entry;
+        outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + filename);
+        }
+    }
+
+    // Append one step (DIR_LEFT .. DIR_DOWN)
+    void step(int direction)
+    {
+        pending |= (unsigned)(direction - 1) << (2 * (stepCount & 3));
+        stepCount++;
+        if ((stepCount & 3) == 0) {
+            outFile.put((char)pending);
+            pending = 0;
+        }
+    }
+
+    void finish()
+    {
+        if ((stepCount & 3) != 0) {
+            outFile.put((char)pending);
+            pending = 0;
+        }
+        header.steps = stepCount;
+        outFile.seekp(0);
+        outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        outFile.flush();
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + name);
+        }
+    }
+
+private:
+    std::ofstream outFile;
+    std::string name;
+    path_file_header header;
+    uint64_t stepCount;
+    unsigned pending;
+};
+
+// Reads a compact path file one cell at a time, starting at the entry
+class CompactPathReader
+{
+public:
+    explicit CompactPathReader(const std::string & filename)
+        : inFile(filename, std::ios::binary), stepsRead(0), pending(0)
+    {
+        if (!inFile) {
+            throw std::runtime_error("cannot open " + filename);
+        }
+        inFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!inFile || memcmp(header.magic, MAZE_PATH_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error(filename + " is not a compact path file");
+        }
+        if (header.version != MAZE_PATH_VERSION) {
+            throw std::runtime_error(filename + " has unsupported path version " + std::to_string(header.version));
+        }
+        xCurrent = header.x_entry;
+        yCurrent = header.y_entry;
+        name = filename;
+    }
+
+    int x() const { return xCurrent; }
+    int y() const { return yCurrent; }
+    uint64_t steps() const { return header.steps; }
+
+    // Move to the next cell of the path; false at the end
+    bool next()
+    {
+        if (stepsRead == header.steps) {
+            return false;
+        }
+        if ((stepsRead & 3) == 0) {
+            int byte = inFile.get();
+            if (byte == EOF) {
+                throw std::runtime_error(name + " is truncated");
+            }
+            pending = (unsigned)byte;
+        }
+        int direction = (int)(pending & 3) + 1;
+        pending >>= 2;
+        stepsRead++;
+        xCurrent += DIR_DX[direction];
+        yCurrent += DIR_DY[direction];
+        return true;
+    }
+
+private:
+    std::ifstream inFile;
+    std::string name;
+    path_file_header header;
+    uint64_t stepsRead;
+    unsigned pending;
+    int xCurrent, yCurrent;
+};
+
+// Check if a file starts with the compact path magic
+inline bool is_compact_path_file(const std::string & filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[8] = {0};
+    file.read(magic, sizeof(magic));
+    return file && memcmp(magic, MAZE_PATH_MAGIC, sizeof(magic)) == 0;
+}
+
+// Write a path in the compact format; moves holds the steps with the first step at the bottom
+// and is empty afterwards, as with writing_path_file
+inline void writing_compact_path_file(Stack<unsigned char>& moves, int mazeID, int x_entry, int y_entry, int x_exit, int y_exit) {
+
+    // Copy the steps from moves to stack2 so the first step ends up on top
+    Stack<unsigned char> stack2;
+    stack2.reserve(moves.size());
+    while(!moves.isEmpty()) {
+        stack2.push(moves.top());
+        moves.pop();
+    }
+    CompactPathWriter writer(path_file_name(mazeID, x_entry, y_entry, x_exit, y_exit, PATH_FORMAT_COMPACT), x_entry, y_entry);
+    while (!stack2.isEmpty()) {
+        writer.step(stack2.top());
+        stack2.pop();
+    }
+    writer.finish();
+}
+
+// Write the path file of a query in the given format, an empty file when there is no path
+inline void write_path_result(bool reached, Stack<unsigned char>& moves, int mazeID, int x_entry, int y_entry, int x_exit, int y_exit,
+                              path_file_format format) {
+    if (!reached) {
+        std::string filename = path_file_name(mazeID, x_entry, y_entry, x_exit, y_exit, format);
+        std::ofstream emptyPath(filename);
+        if (!emptyPath) {
+            throw std::runtime_error("cannot write " + filename);
+        }
+    }
+    else if (format == PATH_FORMAT_COMPACT) {
+        writing_compact_path_file(moves, mazeID, x_entry, y_entry, x_exit, y_exit);
+    }
+    else {
+        writing_path_file(moves, mazeID, x_entry, y_entry, x_exit, y_exit);
+    }
+}
+
+// Convert a path file between the text and the compact format: a compact input becomes text,
+// a text input ("x y" lines of neighbouring cells) becomes compact
+inline void convert_path_file(const std::string & input, const std::string & output) {
+    if (is_compact_path_file(input)) {
+        CompactPathReader reader(input);
+        std::ofstream outFile(output);
+        outFile << reader.x() << " " << reader.y() << '\n';
+        while (reader.next()) {
+            outFile << reader.x() << " " << reader.y() << '\n';
+        }
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + output);
+        }
+        return;
+    }
+    std::ifstream inFile(input);
+    if (!inFile) {
+        throw std::runtime_error("cannot open " + input);
+    }
+    int x, y;
+    if (!(inFile >> x >> y)) {
+        std::ofstream emptyPath(output);
+        return;
+    }
+    CompactPathWriter writer(output, x, y);
+    int nextX, nextY;
+    while (inFile >> nextX >> nextY) {
+        int direction = 0;
+        for (int d = DIR_LEFT; d <= DIR_DOWN; d++) {
+            if (x + DIR_DX[d] == nextX && y + DIR_DY[d] == nextY) {
+                direction = d;
+            }
+        }
+        if (direction == 0) {
+            throw std::runtime_error(input + ": " + std::to_string(nextX) + " " + std::to_string(nextY) + " does not follow the previous cell");
+        }
+        writer.step(direction);
+        x = nextX;
+        y = nextY;
+    }
+    if (!inFile.eof()) {
+        throw std::runtime_error(input + ": a line is not an \"x y\" cell");
+    }
+    writer.finish();
+}
+
+// ---------------------------------------------------------------------------
+// Binary format: a 64-byte header followed by the wall words of MazeGrid exactly as they are
+// laid out in memory (little endian), so a mapped file can be used as a grid without parsing.
+// ---------------------------------------------------------------------------
+
+const char MAZE_BINARY_MAGIC[8] = {'M', 'A', 'Z', 'E', 'B', 'I', 'N', 0};
+const uint32_t MAZE_BINARY_VERSION = 1;
+
+struct maze_file_header {
+    char magic[8];           // MAZE_BINARY_MAGIC
+    uint32_t version;        // MAZE_BINARY_VERSION
+    uint32_t algorithm;      // MAZE_ALGORITHM_* used to generate the maze
+    uint32_t rows;
+    uint32_t columns;
+    uint64_t seed;           // Seed the maze was generated from, 0 if unknown
+    uint64_t words_per_row;  // Words in one wall plane of a row
+    uint64_t wall_words;     // Number of 64-bit wall words after the header
+    uint8_t reserved[16];    // Zero
+};
+
+static_assert(sizeof(maze_file_header) == 64, "the binary maze header must stay 64 bytes");
+
+// Header describing the given maze
+inline maze_file_header make_maze_header(const MazeGrid & maze, uint64_t seed, uint32_t algorithm) {
+    maze_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAZE_BINARY_MAGIC, sizeof(header.magic));
+    header.version = MAZE_BINARY_VERSION;
+    header.algorithm = algorithm;
+    header.rows = (uint32_t)maze.rows();
+    header.columns = (uint32_t)maze.columns();
+    header.seed = seed;
+    header.words_per_row = maze.wordsPerRow();
+    header.wall_words = maze.wordCount();
+    return header;
+}
+
+// Check a header read from filename, fileSize is the size of the whole file
+inline void check_maze_header(const maze_file_header & header, uint64_t fileSize, const std::string & filename) {
+    if (memcmp(header.magic, MAZE_BINARY_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error(filename + " is not a binary maze file");
+    }
+    if (header.version != MAZE_BINARY_VERSION) {
+        throw std::runtime_error(filename + " has unsupported binary maze version " + std::to_string(header.version));
+    }
+    if (header.rows > 0x7fffffff || header.columns > 0x7fffffff ||
+        header.words_per_row != MazeGrid::wordsPerRowFor((int)header.columns) ||
+        header.wall_words != (uint64_t)header.rows * 2 * header.words_per_row ||
+        fileSize < sizeof(maze_file_header) + header.wall_words * sizeof(uint64_t)) {
+        throw std::runtime_error(filename + " is truncated or has an inconsistent header");
+    }
+}
+
+// Check if a file starts with the binary maze magic
+inline bool is_binary_maze_file(const std::string & filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[8] = {0};
+    file.read(magic, sizeof(magic));
+    return file && memcmp(magic, MAZE_BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+// Write a maze to a binary file
+inline void write_binary_maze(const MazeGrid & maze, const std::string & filename, uint64_t seed = 0, uint32_t algorithm = MAZE_ALGORITHM_BACKTRACKER) {
+    std::ofstream outFile(filename, std::ios::binary);
+    maze_file_header header = make_maze_header(maze, seed, algorithm);
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(maze.data()), (std::streamsize)(maze.wordCount() * sizeof(uint64_t)));
+    if (!outFile) {
+        throw std::runtime_error("cannot write " + filename);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Compressed format: the binary header (with its own magic) followed by the walls as one
+// dense bit stream, row by row the right walls then the up walls of every column, without the
+// padding of the in-memory rows. The stream is run-length coded in PackBits style: a control
+// byte c < 128 is followed by c + 1 literal bytes, a control byte c >= 128 by one byte that
+// repeats c - 125 times (3 to 130). Both directions work a row at a time.
+// ---------------------------------------------------------------------------
+
+const char MAZE_COMPRESSED_MAGIC[8] = {'M', 'A', 'Z', 'E', 'R', 'L', 'E', 0};
+
+// Run-length encoder for a byte stream
+class PackBitsWriter
+{
+public:
+    explicit PackBitsWriter(std::ostream & output) : out(output), literalCount(0), runByte(0), runLength(0) {}
+
+    void put(unsigned char byte)
+    {
+        if (runLength > 0) {
+            if (byte == runByte && runLength < 130) {
+                runLength++;
+                return;
+            }
+            flushRun();
+        }
+        literals[literalCount++] = byte;
+        // Three equal bytes at the end of the literals start a run
+        if (literalCount >= 3 && literals[literalCount - 2] == byte && literals[literalCount - 3] == byte) {
+            literalCount -= 3;
+            flushLiterals();
+            runByte = byte;
+            runLength = 3;
+        }
+        else if (literalCount == 128) {
+            flushLiterals();
+        }
+    }
+
+    void finish()
+    {
+        flushRun();
+        flushLiterals();
+    }
+
+private:
+    void flushLiterals()
+    {
+        if (literalCount > 0) {
+            out.put((char)(literalCount - 1));
+            out.write(reinterpret_cast<const char *>(literals), literalCount);
+            literalCount = 0;
+        }
+    }
+
+    void flushRun()
+    {
+        if (runLength > 0) {
+            out.put((char)(runLength + 125));
+            out.put((char)runByte);
+            runLength = 0;
+        }
+    }
+
+    std::ostream & out;
+    unsigned char literals[128];
+    int literalCount;
+    unsigned char runByte;
+    int runLength;
+};
+
+// Decoder for the stream of PackBitsWriter
+class PackBitsReader
+{
+public:
+    PackBitsReader(std::istream & input, const std::string & name) : in(input), filename(name), literalLeft(0), runLeft(0), runByte(0) {}
+
+    unsigned char get()
+    {
+        if (literalLeft == 0 && runLeft == 0) {
+            int control = in.get();
+            if (control == EOF) {
+                throw std::runtime_error(filename + " is truncated");
+            }
+            if (control < 128) {
+                literalLeft = control + 1;
+            }
+            else {
+                int byte = in.get();
+                if (byte == EOF) {
+                    throw std::runtime_error(filename + " is truncated");
+                }
+                runByte = (unsigned char)byte;
+                runLeft = control - 125;
+            }
+        }
+        if (runLeft > 0) {
+            runLeft--;
+            return runByte;
+        }
+        int byte = in.get();
+        if (byte == EOF) {
+            throw std::runtime_error(filename + " is truncated");
+        }
+        literalLeft--;
+        return (unsigned char)byte;
+    }
+
+private:
+    std::istream & in;
+    std::string filename;
+    int literalLeft;
+    int runLeft;
+    unsigned char runByte;
+};
+
+// Writes a compressed maze file one row at a time
+class CompressedMazeWriter
+{
+public:
+    CompressedMazeWriter(const std::string & filename, int rows, int columns, uint64_t seed, uint32_t algorithm)
+        : outFile(filename, std::ios::binary), name(filename), packer(outFile), columnCount(columns), pending(0), pendingBits(0)
+    {
+        // The header only needs the dimensions, a grid with no rows allocated gives the same values
+        maze_file_header header = make_maze_header(MazeGrid(0, columns), seed, algorithm);
+        memcpy(header.magic, MAZE_COMPRESSED_MAGIC, sizeof(header.magic));
+        header.rows = (uint32_t)rows;
+        header.wall_words = (uint64_t)rows * 2 * header.words_per_row;
+        outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + filename);
+        }
+    }
+
+    // Append the right and up wall words of the next row
+    void writeRow(const uint64_t * rightWords, const uint64_t * upWords)
+    {
+        appendBits(rightWords);
+        appendBits(upWords);
+    }
+
+    void finish()
+    {
+        if (pendingBits > 0) {
+            packer.put((unsigned char)pending);
+            pending = 0;
+            pendingBits = 0;
+        }
+        packer.finish();
+        outFile.flush();
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + name);
+        }
+    }
+
+private:
+    // Append the first columnCount bits of words to the stream, whole bytes go to the encoder
+    void appendBits(const uint64_t * words)
+    {
+        for (int x = 0; x < columnCount; x += 64) {
+            int count = std::min(64, columnCount - x);
+            uint64_t word = words[x >> 6];
+            if (count < 64) {
+                word &= ((uint64_t)1 << count) - 1;
+            }
+            // pending holds fewer than 8 bits, so up to 7 + 64 bits are in flight
+            int used = 0;
+            while (used < count) {
+                int take = std::min(8 - pendingBits, count - used);
+                pending |= (unsigned)((word >> used) & ((1u << take) - 1)) << pendingBits;
+                pendingBits += take;
+                used += take;
+                if (pendingBits == 8) {
+                    packer.put((unsigned char)pending);
+                    pending = 0;
+                    pendingBits = 0;
+                }
+            }
+        }
+    }
+
+    std::ofstream outFile;
+    std::string name;
+    PackBitsWriter packer;
+    int columnCount;
+    unsigned pending;
+    int pendingBits;
+};
+
+// Reads a compressed maze file one row at a time
+class CompressedMazeReader
+{
+public:
+    explicit CompressedMazeReader(const std::string & filename)
+        : inFile(filename, std::ios::binary), unpacker(inFile, filename), pending(0), pendingBits(0)
+    {
+        if (!inFile) {
+            throw std::runtime_error("cannot open " + filename);
+        }
+        inFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!inFile || memcmp(header.magic, MAZE_COMPRESSED_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error(filename + " is not a compressed maze file");
+        }
+        if (header.version != MAZE_BINARY_VERSION) {
+            throw std::runtime_error(filename + " has unsupported compressed maze version " + std::to_string(header.version));
+        }
+        if (header.rows > 0x7fffffff || header.columns > 0x7fffffff ||
+            header.words_per_row != MazeGrid::wordsPerRowFor((int)header.columns)) {
+            throw std::runtime_error(filename + " has an inconsistent header");
+        }
+    }
+
+    int rows() const { return (int)header.rows; }
+    int columns() const { return (int)header.columns; }
+    uint64_t seed() const { return header.seed; }
+    uint32_t algorithm() const { return header.algorithm; }
+
+    // Read the next row into its right and up wall words (padding bits come back set)
+    void readRow(uint64_t * rightWords, uint64_t * upWords)
+    {
+        readBits(rightWords);
+        readBits(upWords);
+    }
+
+private:
+    void readBits(uint64_t * words)
+    {
+        int columnCount = columns();
+        for (int x = 0; x < columnCount; x += 64) {
+            int count = std::min(64, columnCount - x);
+            uint64_t word = count < 64 ? ~(uint64_t)0 << count : 0;
+            int filled = 0;
+            while (filled < count) {
+                if (pendingBits == 0) {
+                    pending = unpacker.get();
+                    pendingBits = 8;
+                }
+                int take = std::min(pendingBits, count - filled);
+                word |= (uint64_t)(pending & ((1u << take) - 1)) << filled;
+                pending >>= take;
+                pendingBits -= take;
+                filled += take;
+            }
+            words[x >> 6] = word;
+        }
+    }
+
+    std::ifstream inFile;
+    maze_file_header header;
+    PackBitsReader unpacker;
+    unsigned pending;
+    int pendingBits;
+};
+
+// Check if a file starts with the compressed maze magic
+inline bool is_compressed_maze_file(const std::string & filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[8] = {0};
+    file.read(magic, sizeof(magic));
+    return file && memcmp(magic, MAZE_COMPRESSED_MAGIC, sizeof(magic)) == 0;
+}
+
+// Write a maze to a compressed file
+inline void write_compressed_maze(const MazeGrid & maze, const std::string & filename, uint64_t seed = 0, uint32_t algorithm = MAZE_ALGORITHM_BACKTRACKER) {
+    CompressedMazeWriter writer(filename, maze.rows(), maze.columns(), seed, algorithm);
+    for (int y = 0; y < maze.rows(); y++) {
+        writer.writeRow(maze.rightWalls(y), maze.upWalls(y));
+    }
+    writer.finish();
+}
+
+// Read a compressed maze file into a grid
+inline MazeGrid read_compressed_maze(const std::string & filename, uint64_t & seed, uint32_t & algorithm) {
+    CompressedMazeReader reader(filename);
+    MazeGrid maze(reader.rows(), reader.columns());
+    for (int y = 0; y < maze.rows(); y++) {
+        reader.readRow(maze.rightWalls(y), maze.upWalls(y));
+    }
+    seed = reader.seed();
+    algorithm = reader.algorithm();
+    return maze;
+}
+
+// A maze loaded from a file of any format.
+// Binary files are memory mapped privately, so the grid works directly on the file's pages and
+// changes made to it never reach the file. Text and compressed files are decoded into a grid of its own.
+class MazeFile
+{
+public:
+    explicit MazeFile(const std::string & filename)
+        : mapping(NULL), mappingLength(0), seedOfMaze(0), algorithmOfMaze(MAZE_ALGORITHM_BACKTRACKER), binary(false)
+    {
+        MAZE_STAT_TIMER(parse_seconds);
+        if (is_compressed_maze_file(filename)) {
+            maze = read_compressed_maze(filename, seedOfMaze, algorithmOfMaze);
+            return;
+        }
+        if (!is_binary_maze_file(filename)) {
+            maze = read_maze_file(filename, seedOfMaze, algorithmOfMaze);
+            return;
+        }
+        binary = true;
+#if !defined(_WIN32)
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            if (fd >= 0) close(fd);
+            throw std::runtime_error("cannot open " + filename);
+        }
+        mappingLength = (size_t)info.st_size;
+        mapping = mmap(NULL, mappingLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            mapping = NULL;
+            throw std::runtime_error("cannot map " + filename);
+        }
+        maze_file_header header;
+        memcpy(&header, mapping, sizeof(header));
+        try {
+            check_maze_header(header, mappingLength, filename);
+        }
+        catch (...) {
+            munmap(mapping, mappingLength);
+            throw;
+        }
+        uint64_t * words = reinterpret_cast<uint64_t *>(static_cast<char *>(mapping) + sizeof(maze_file_header));
+        maze = MazeGrid((int)header.rows, (int)header.columns, words);
+#else
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        uint64_t fileSize = (uint64_t)file.tellg();
+        file.seekg(0);
+        maze_file_header header;
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        check_maze_header(header, fileSize, filename);
+        maze = MazeGrid((int)header.rows, (int)header.columns);
+        file.read(reinterpret_cast<char *>(maze.data()), (std::streamsize)(maze.wordCount() * sizeof(uint64_t)));
+#endif
+        seedOfMaze = header.seed;
+        algorithmOfMaze = header.algorithm;
+    }
+
+    //Destructor
+    ~MazeFile() {
+#if !defined(_WIN32)
+        if (mapping != NULL) {
+            munmap(mapping, mappingLength);
+        }
+#endif
+    }
+
+    MazeGrid & grid() { return maze; }
+    const MazeGrid & grid() const { return maze; }
+    bool isBinary() const { return binary; }
+    uint64_t seed() const { return seedOfMaze; }
+    uint32_t algorithm() const { return algorithmOfMaze; }
+
+private:
+    void *mapping;
+    size_t mappingLength;
+    MazeGrid maze;
+    uint64_t seedOfMaze;
+    uint32_t algorithmOfMaze;
+    bool binary;
+
+    MazeFile(const MazeFile &);
+    MazeFile & operator=(const MazeFile &);
+};
+
+// Write a maze to maze_<mazeID>.txt or maze_<mazeID>.bin
+inline void writing_output_file(const MazeGrid & output_maze, int mazeID, maze_file_format format = MAZE_FORMAT_TEXT, uint64_t seed = 0,
+                                uint32_t algorithm = MAZE_ALGORITHM_BACKTRACKER) {
+    if (format == MAZE_FORMAT_BINARY) {
+        write_binary_maze(output_maze, maze_file_name(mazeID, format), seed, algorithm);
+    }
+    else if (format == MAZE_FORMAT_COMPRESSED) {
+        write_compressed_maze(output_maze, maze_file_name(mazeID, format), seed, algorithm);
+    }
+    else {
+        write_text_maze(output_maze, maze_file_name(mazeID, format), seed, algorithm);
+    }
+}
+
+// Convert a maze file to another format. The input format is detected from its contents, the
+// output format comes from the extension of output (.txt, .bin or .rle); without one of those,
+// text becomes binary and the other formats become text.
+inline void convert_maze_file(const std::string & input, const std::string & output) {
+    MazeFile source(input);
+    std::string extension = output.size() >= 4 ? output.substr(output.size() - 4) : "";
+    if (extension == ".rle") {
+        write_compressed_maze(source.grid(), output, source.seed(), source.algorithm());
+    }
+    else if (extension == ".bin" || (extension != ".txt" && !source.isBinary() && !is_compressed_maze_file(input))) {
+        write_binary_maze(source.grid(), output, source.seed(), source.algorithm());
+    }
+    else {
+        write_text_maze(source.grid(), output, source.seed(), source.algorithm());
+    }
+}
+
+#endif /* MazeFile_h */
@@ -0,0 +1,435 @@
+//
+//  MazeFloodSolver.h
+//
+//  Bit-parallel flood fill over the packed wall rows of MazeGrid. The set of reached cells is a
+//  bitset laid out like the wall planes, and it grows a block of 256 cells of one row at a time:
+//  a few word operations find the cells next to reached ones and carry the fill along every
+//  open stretch of the row at once, instead of visiting the cells one by one.
+//
+
+#ifndef MazeFloodSolver_h
+#define MazeFloodSolver_h
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include "Stack.h"
+#include "MazeGrid.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MAZE_FLOOD_AVX2 1
+#include <immintrin.h>
+#else
+#define MAZE_FLOOD_AVX2 0
+#endif
+
+// Words of one block: 256 cells of a row, one AVX2 register
+const int FLOOD_BLOCK_WORDS = 4;
+
+// What the fill of one block needs to know, bit x of word i being column 64 * i + x of the block
+struct flood_block {
+    uint64_t reach[FLOOD_BLOCK_WORDS];      // Reached cells of the row
+    uint64_t below[FLOOD_BLOCK_WORDS];      // Reached cells of the row underneath (0 for row 0)
+    uint64_t above[FLOOD_BLOCK_WORDS];      // Reached cells of the row above (0 for the top row)
+    uint64_t openRight[FLOOD_BLOCK_WORDS];  // No wall between the cell and the next one
+    uint64_t openUp[FLOOD_BLOCK_WORDS];     // No wall between the cell and the one above
+    uint64_t openDown[FLOOD_BLOCK_WORDS];   // No wall between the cell and the one underneath
+    uint64_t fromPrevious;                  // Bit 0 set: the last cell of the block on the left is reached and open to this one
+    uint64_t fromNext;                      // Bit 63 set: the first cell of the block on the right is reached and open to this one
+};
+
+// Cells a block fill reached for the first time, with the step that reached each one as two
+// bit planes (direction - 1: low bit for right and down, high bit for up and down)
+struct flood_result {
+    uint64_t reached[FLOOD_BLOCK_WORDS];
+    uint64_t low[FLOOD_BLOCK_WORDS];
+    uint64_t high[FLOOD_BLOCK_WORDS];
+};
+
+// Fill one block with 64-bit words. New cells are the unreached ones next to a reached cell
+// (seeds), then everything an open stretch of the row connects to a seed: rightwards with one
+// addition per word (the carry runs along a stretch of open walls), leftwards with a
+// Kogge-Stone prefix of six shift steps per word. Returns false when nothing was reached.
+inline bool flood_block_scalar(const flood_block & block, flood_result & result)
+{
+    uint64_t seeds[FLOOD_BLOCK_WORDS], up[FLOOD_BLOCK_WORDS], down[FLOOD_BLOCK_WORDS], right[FLOOD_BLOCK_WORDS];
+    uint64_t any = 0;
+    for (int i = 0; i < FLOOD_BLOCK_WORDS; i++) {
+        uint64_t fresh = ~block.reach[i];
+        uint64_t carryIn = i == 0 ? block.fromPrevious : (block.reach[i - 1] & block.openRight[i - 1]) >> 63;
+        uint64_t carryDown = i == FLOOD_BLOCK_WORDS - 1 ? block.fromNext : block.reach[i + 1] << 63;
+        // The first way in decides the step: from below, from above, from the left, from the right
+        up[i] = fresh & block.below[i] & block.openDown[i];
+        down[i] = fresh & block.above[i] & block.openUp[i] & ~up[i];
+        right[i] = fresh & (((block.reach[i] & block.openRight[i]) << 1) | carryIn) & ~up[i] & ~down[i];
+        uint64_t left = fresh & block.openRight[i] & ((block.reach[i] >> 1) | carryDown) & ~up[i] & ~down[i] & ~right[i];
+        seeds[i] = up[i] | down[i] | right[i] | left;
+        any |= seeds[i];
+    }
+    if (any == 0) {
+        return false;
+    }
+
+    // Rightwards: adding the seeds of a stretch to its open walls carries through the stretch
+    uint64_t filled[FLOOD_BLOCK_WORDS];
+    uint64_t carry = 0;
+    for (int i = 0; i < FLOOD_BLOCK_WORDS; i++) {
+        uint64_t open = block.openRight[i];
+        uint64_t start = seeds[i] | carry;
+        uint64_t sum = (start & open) + open;
+        filled[i] = ((sum ^ open) | start);
+        carry = sum < open ? 1 : 0;
+    }
+    // Leftwards from everything reached so far, Kogge-Stone within each word
+    uint64_t spread[FLOOD_BLOCK_WORDS];
+    carry = 0;
+    for (int i = FLOOD_BLOCK_WORDS - 1; i >= 0; i--) {
+        uint64_t toLeft = (block.openRight[i] << 1) | (i > 0 ? block.openRight[i - 1] >> 63 : 0);
+        uint64_t g = filled[i] | carry;
+        uint64_t m = toLeft;
+        g |= (g & m) >> 1;  m &= m << 1;
+        g |= (g & m) >> 2;  m &= m << 2;
+        g |= (g & m) >> 4;  m &= m << 4;
+        g |= (g & m) >> 8;  m &= m << 8;
+        g |= (g & m) >> 16; m &= m << 16;
+        g |= (g & m) >> 32;
+        spread[i] = g;
+        carry = (g & toLeft & 1) << 63;
+    }
+
+    for (int i = 0; i < FLOOD_BLOCK_WORDS; i++) {
+        uint64_t reached = spread[i] & ~block.reach[i];
+        uint64_t stepRight = right[i] | (filled[i] & ~seeds[i]);
+        result.reached[i] = reached;
+        result.low[i] = (stepRight | down[i]) & reached;
+        result.high[i] = (up[i] | down[i]) & reached;
+    }
+    return true;
+}
+
+#if MAZE_FLOOD_AVX2
+// 256-bit shifts of a whole block: within the 64-bit lanes, then across them
+template <int K>
+__attribute__((target("avx2"))) inline __m256i flood_shift_up(__m256i v)
+{
+    if (K == 128) return _mm256_permute2x128_si256(v, v, 0x08);
+    __m256i lanes = _mm256_blend_epi32(_mm256_permute4x64_epi64(K == 64 ? v : _mm256_srli_epi64(v, (64 - K) & 63), 0x90),
+                                       _mm256_setzero_si256(), 0x03);
+    return K == 64 ? lanes : _mm256_or_si256(_mm256_slli_epi64(v, K & 63), lanes);
+}
+
+template <int K>
+__attribute__((target("avx2"))) inline __m256i flood_shift_down(__m256i v)
+{
+    if (K == 128) return _mm256_permute2x128_si256(v, v, 0x81);
+    __m256i lanes = _mm256_blend_epi32(_mm256_permute4x64_epi64(K == 64 ? v : _mm256_slli_epi64(v, (64 - K) & 63), 0xF9),
+                                       _mm256_setzero_si256(), 0xC0);
+    return K == 64 ? lanes : _mm256_or_si256(_mm256_srli_epi64(v, K & 63), lanes);
+}
+
+// The same fill as flood_block_scalar on one AVX2 register per plane, with a Kogge-Stone prefix
+// of eight steps over all 256 cells in each direction. It reaches the same cells with the same
+// steps, so both give the same paths.
+__attribute__((target("avx2"))) inline bool flood_block_avx2(const flood_block & block, flood_result & result)
+{
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    __m256i reach = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block.reach));
+    __m256i below = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block.below));
+    __m256i above = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block.above));
+    __m256i openRight = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block.openRight));
+    __m256i openUp = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block.openUp));
+    __m256i openDown = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block.openDown));
+    __m256i fromPrevious = _mm256_set_epi64x(0, 0, 0, (long long)block.fromPrevious);
+    __m256i fromNext = _mm256_set_epi64x((long long)block.fromNext, 0, 0, 0);
+
+    __m256i fresh = _mm256_xor_si256(reach, ones);
+    __m256i up = _mm256_and_si256(fresh, _mm256_and_si256(below, openDown));
+    __m256i down = _mm256_andnot_si256(up, _mm256_and_si256(fresh, _mm256_and_si256(above, openUp)));
+    __m256i taken = _mm256_or_si256(up, down);
+    __m256i right = _mm256_andnot_si256(taken, _mm256_and_si256(fresh,
+                        _mm256_or_si256(flood_shift_up<1>(_mm256_and_si256(reach, openRight)), fromPrevious)));
+    taken = _mm256_or_si256(taken, right);
+    __m256i left = _mm256_andnot_si256(taken, _mm256_and_si256(_mm256_and_si256(fresh, openRight),
+                       _mm256_or_si256(flood_shift_down<1>(reach), fromNext)));
+    __m256i seeds = _mm256_or_si256(taken, left);
+    if (_mm256_testz_si256(seeds, seeds)) {
+        return false;
+    }
+
+    // Rightwards
+    __m256i g = seeds, p = openRight;
+    g = _mm256_or_si256(g, flood_shift_up<1>(_mm256_and_si256(g, p)));   p = _mm256_and_si256(p, flood_shift_down<1>(p));
+    g = _mm256_or_si256(g, flood_shift_up<2>(_mm256_and_si256(g, p)));   p = _mm256_and_si256(p, flood_shift_down<2>(p));
+    g = _mm256_or_si256(g, flood_shift_up<4>(_mm256_and_si256(g, p)));   p = _mm256_and_si256(p, flood_shift_down<4>(p));
+    g = _mm256_or_si256(g, flood_shift_up<8>(_mm256_and_si256(g, p)));   p = _mm256_and_si256(p, flood_shift_down<8>(p));
+    g = _mm256_or_si256(g, flood_shift_up<16>(_mm256_and_si256(g, p)));  p = _mm256_and_si256(p, flood_shift_down<16>(p));
+    g = _mm256_or_si256(g, flood_shift_up<32>(_mm256_and_si256(g, p)));  p = _mm256_and_si256(p, flood_shift_down<32>(p));
+    g = _mm256_or_si256(g, flood_shift_up<64>(_mm256_and_si256(g, p)));  p = _mm256_and_si256(p, flood_shift_down<64>(p));
+    g = _mm256_or_si256(g, flood_shift_up<128>(_mm256_and_si256(g, p)));
+    __m256i filled = g;
+
+    // Leftwards
+    __m256i m = flood_shift_up<1>(openRight);
+    g = _mm256_or_si256(g, flood_shift_down<1>(_mm256_and_si256(g, m)));   m = _mm256_and_si256(m, flood_shift_up<1>(m));
+    g = _mm256_or_si256(g, flood_shift_down<2>(_mm256_and_si256(g, m)));   m = _mm256_and_si256(m, flood_shift_up<2>(m));
+    g = _mm256_or_si256(g, flood_shift_down<4>(_mm256_and_si256(g, m)));   m = _mm256_and_si256(m, flood_shift_up<4>(m));
+    g = _mm256_or_si256(g, flood_shift_down<8>(_mm256_and_si256(g, m)));   m = _mm256_and_si256(m, flood_shift_up<8>(m));
+    g = _mm256_or_si256(g, flood_shift_down<16>(_mm256_and_si256(g, m)));  m = _mm256_and_si256(m, flood_shift_up<16>(m));
+    g = _mm256_or_si256(g, flood_shift_down<32>(_mm256_and_si256(g, m)));  m = _mm256_and_si256(m, flood_shift_up<32>(m));
+    g = _mm256_or_si256(g, flood_shift_down<64>(_mm256_and_si256(g, m)));  m = _mm256_and_si256(m, flood_shift_up<64>(m));
+    g = _mm256_or_si256(g, flood_shift_down<128>(_mm256_and_si256(g, m)));
+
+    __m256i reached = _mm256_andnot_si256(reach, g);
+    __m256i stepRight = _mm256_or_si256(right, _mm256_andnot_si256(seeds, filled));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(result.reached), reached);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(result.low), _mm256_and_si256(_mm256_or_si256(stepRight, down), reached));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(result.high), _mm256_and_si256(_mm256_or_si256(up, down), reached));
+    return true;
+}
+
+// True when the processor running the program has AVX2
+inline bool flood_cpu_has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#else
+inline bool flood_cpu_has_avx2() {
+    return false;
+}
+#endif
+
+// Fill a block with the AVX2 kernel when avx2 is set, with the 64-bit one otherwise
+inline bool flood_fill_block(const flood_block & block, flood_result & result, bool avx2)
+{
+#if MAZE_FLOOD_AVX2
+    if (avx2) {
+        return flood_block_avx2(block, result);
+    }
+#else
+    (void)avx2;
+#endif
+    return flood_block_scalar(block, result);
+}
+
+// Gather block b of a row: its reached words and those of the rows underneath and above (NULL
+// when there is none), and the wall words of the row (rightWalls, upWalls, NULL for the top
+// row) and of the row underneath (downWalls, NULL for row 0). The reached rows hold at least one
+// word past the block; the wall rows have mazeWords words for columns cells. Whatever the wall
+// words hold, the outer border and the padding past the last column count as walls.
+inline void flood_load_block(const uint64_t * reach, const uint64_t * below, const uint64_t * above,
+                             const uint64_t * rightWalls, const uint64_t * upWalls, const uint64_t * downWalls,
+                             size_t mazeWords, int columns, size_t b, flood_block & block)
+{
+    size_t firstWord = b * FLOOD_BLOCK_WORDS;
+    size_t lastWord = (size_t)(columns - 1) >> 6;
+    for (int i = 0; i < FLOOD_BLOCK_WORDS; i++) {
+        size_t w = firstWord + i;
+        // Cells of the word that are inside the maze, and those with a right neighbour
+        uint64_t cells = 0, hasRight = 0;
+        if (w < lastWord) {
+            cells = hasRight = ~(uint64_t)0;
+        }
+        else if (w == lastWord && w < mazeWords) {
+            int last = (columns - 1) & 63;
+            cells = last == 63 ? ~(uint64_t)0 : ((uint64_t)1 << (last + 1)) - 1;
+            hasRight = ((uint64_t)1 << last) - 1;
+        }
+        block.reach[i] = reach[w];
+        block.below[i] = below != NULL ? below[w] : 0;
+        block.above[i] = above != NULL ? above[w] : 0;
+        block.openRight[i] = hasRight != 0 ? ~rightWalls[w] & hasRight : 0;
+        block.openUp[i] = cells != 0 && upWalls != NULL ? ~upWalls[w] & cells : 0;
+        block.openDown[i] = cells != 0 && downWalls != NULL ? ~downWalls[w] & cells : 0;
+    }
+    block.fromPrevious = b > 0 ? (reach[firstWord - 1] & ~rightWalls[firstWord - 1]) >> 63 : 0;
+    block.fromNext = firstWord + FLOOD_BLOCK_WORDS < mazeWords ? (reach[firstWord + FLOOD_BLOCK_WORDS] & 1) << 63 : 0;
+}
+
+// Path finder that floods the maze from the entry with flood_block_scalar or flood_block_avx2,
+// chosen when the solver is made from what the processor supports.
+//
+// Blocks wait on a stack, each at most once; a block that reaches new cells pushes the blocks
+// those cells open onto. Taking the newest block first follows a corridor while its rows are
+// still in the cache and reaches the exit after fewer fills than a queue would. When the exit
+// is reached the path is read back from the steps kept for every cell (2 bits each). Every
+// cell is reached from a cell reached before it, so the steps form a tree: in a perfect maze
+// the path is the only one, in a maze with loops it is a valid path but not necessarily the
+// shortest.
+//
+// Memory is 3 bits per cell (reached, two step planes) and a byte per block. After a query only
+// the blocks that were pushed are cleared.
+class FloodSolver
+{
+public:
+    // vectorized false keeps the 64-bit kernel even where AVX2 is available
+    explicit FloodSolver(const MazeGrid & theMaze, bool vectorized = true)
+        : maze(theMaze), rows(theMaze.rows()), columns(theMaze.columns()), mazeWords(theMaze.wordsPerRow()),
+          blocksPerRow((theMaze.wordsPerRow() + FLOOD_BLOCK_WORDS - 1) / FLOOD_BLOCK_WORDS),
+          stride(blocksPerRow * FLOOD_BLOCK_WORDS),
+          reach((size_t)theMaze.rows() * stride, 0), low(reach.size(), 0), high(reach.size(), 0),
+          state((size_t)theMaze.rows() * blocksPerRow, 0),
+          useAvx2(vectorized && flood_cpu_has_avx2()), explored(0), expansions(0)
+    {
+        pending.reserve(1024);
+        touched.reserve(1024);
+    }
+
+    // Find a path from the entry to the exit. On success moves holds the direction of every step
+    // from the entry, last step on top.
+    bool solve(int x_entry, int y_entry, int x_exit, int y_exit, Stack<unsigned char> & moves)
+    {
+        if (!maze.contains(x_entry, y_entry) || !maze.contains(x_exit, y_exit)) {
+            return false;
+        }
+        explored = 1;
+        expansions = 0;
+        if (x_entry == x_exit && y_entry == y_exit) {
+            return true;
+        }
+        reach[wordIndex(x_entry, y_entry)] |= (uint64_t)1 << (x_entry & 63);
+        size_t entryBlock = (size_t)(x_entry >> 6) / FLOOD_BLOCK_WORDS;
+        push(y_entry, entryBlock);
+        if (y_entry + 1 < rows) push(y_entry + 1, entryBlock);
+        if (y_entry > 0) push(y_entry - 1, entryBlock);
+        if (entryBlock + 1 < blocksPerRow) push(y_entry, entryBlock + 1);
+        if (entryBlock > 0) push(y_entry, entryBlock - 1);
+
+        size_t exitWord = wordIndex(x_exit, y_exit);
+        uint64_t exitBit = (uint64_t)1 << (x_exit & 63);
+        while (!pending.empty() && !(reach[exitWord] & exitBit)) {
+            uint32_t blockIndex = pending.back();
+            pending.pop_back();
+            state[blockIndex] = DONE;
+            expand((int)(blockIndex / blocksPerRow), blockIndex % blocksPerRow);
+        }
+        pending.clear();
+
+        bool found = (reach[exitWord] & exitBit) != 0;
+        if (found) {
+            tracePath(x_entry, y_entry, x_exit, y_exit, moves);
+        }
+        clearTouched();
+        return found;
+    }
+
+    // Number of cells the last query reached, and how many block fills it took
+    long long cellsExplored() const { return explored; }
+    long long blockExpansions() const { return expansions; }
+
+    // True when the AVX2 kernel is in use
+    bool vectorized() const { return useAvx2; }
+
+private:
+    static const unsigned char QUEUED = 1;
+    static const unsigned char DONE = 2;
+
+    size_t wordIndex(int x, int y) const { return (size_t)y * stride + (size_t)(x >> 6); }
+
+    // Push block b of row y unless it is waiting already
+    void push(int y, size_t b)
+    {
+        uint32_t blockIndex = (uint32_t)((size_t)y * blocksPerRow + b);
+        if (state[blockIndex] == QUEUED) {
+            return;
+        }
+        if (state[blockIndex] == 0) {
+            touched.push_back(blockIndex);
+        }
+        state[blockIndex] = QUEUED;
+        pending.push_back(blockIndex);
+    }
+
+    // Fill block b of row y and push the blocks its new cells open onto
+    void expand(int y, size_t b)
+    {
+        size_t firstWord = b * FLOOD_BLOCK_WORDS;
+        uint64_t * reachRow = &reach[(size_t)y * stride];
+        uint64_t * row = reachRow + firstWord;
+        flood_block block;
+        flood_load_block(reachRow, y > 0 ? reachRow - stride : NULL, y + 1 < rows ? reachRow + stride : NULL,
+                         maze.rightWalls(y), y + 1 < rows ? maze.upWalls(y) : NULL, y > 0 ? maze.upWalls(y - 1) : NULL,
+                         mazeWords, columns, b, block);
+        bool hasNext = firstWord + FLOOD_BLOCK_WORDS < mazeWords;
+
+        flood_result result;
+        bool reachedAny = flood_fill_block(block, result, useAvx2);
+        expansions++;
+        if (!reachedAny) {
+            return;
+        }
+
+        uint64_t upward = 0, downward = 0;
+        size_t stepWord = (size_t)y * stride + firstWord;
+        for (int i = 0; i < FLOOD_BLOCK_WORDS; i++) {
+            uint64_t reached = result.reached[i];
+            if (reached == 0) continue;
+            row[i] |= reached;
+            low[stepWord + i] |= result.low[i];
+            high[stepWord + i] |= result.high[i];
+            explored += count_bits(reached);
+            upward |= reached & block.openUp[i] & ~block.above[i];
+            downward |= reached & block.openDown[i] & ~block.below[i];
+        }
+        if (upward && y + 1 < rows) push(y + 1, b);
+        if (downward && y > 0) push(y - 1, b);
+        if (hasNext && ((result.reached[FLOOD_BLOCK_WORDS - 1] & block.openRight[FLOOD_BLOCK_WORDS - 1]) >> 63) &&
+            !(row[FLOOD_BLOCK_WORDS] & 1)) {
+            push(y, b + 1);
+        }
+        if (b > 0 && (result.reached[0] & 1) && !(maze.rightWalls(y)[firstWord - 1] >> 63) && !(row[-1] >> 63)) {
+            push(y, b - 1);
+        }
+    }
+
+    // Follow the steps back from the exit and push them onto moves in walking order
+    void tracePath(int x_entry, int y_entry, int x, int y, Stack<unsigned char> & moves)
+    {
+        Stack<unsigned char> backwards;
+        while (x != x_entry || y != y_entry) {
+            size_t word = wordIndex(x, y);
+            int shift = x & 63;
+            int direction = 1 + (int)((low[word] >> shift) & 1) + 2 * (int)((high[word] >> shift) & 1);
+            backwards.push((unsigned char)direction);
+            x -= DIR_DX[direction];
+            y -= DIR_DY[direction];
+        }
+        moves.reserve(moves.size() + backwards.size());
+        while (!backwards.isEmpty()) {
+            moves.push(backwards.top());
+            backwards.pop();
+        }
+    }
+
+    // Forget every block the last query pushed
+    void clearTouched()
+    {
+        for (size_t i = 0; i < touched.size(); i++) {
+            uint32_t blockIndex = touched[i];
+            size_t firstWord = (size_t)(blockIndex / blocksPerRow) * stride + (blockIndex % blocksPerRow) * FLOOD_BLOCK_WORDS;
+            for (int w = 0; w < FLOOD_BLOCK_WORDS; w++) {
+                reach[firstWord + w] = 0;
+                low[firstWord + w] = 0;
+                high[firstWord + w] = 0;
+            }
+            state[blockIndex] = 0;
+        }
+        touched.clear();
+    }
+
+    const MazeGrid & maze;
+    int rows, columns;
+    size_t mazeWords;
+    size_t blocksPerRow;
+    size_t stride;
+    std::vector<uint64_t> reach;
+    std::vector<uint64_t> low;
+    std::vector<uint64_t> high;
+    std::vector<unsigned char> state;
+    std::vector<uint32_t> pending;
+    std::vector<uint32_t> touched;
+    bool useAvx2;
+    long long explored;
+    long long expansions;
+};
+
+#endif /* MazeFloodSolver_h */
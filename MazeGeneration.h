@@ -0,0 +1,197 @@
+//
+//  MazeGeneration.h
+//
+//  Maze generation with the recursive backtracker or one of the algorithms of MazeAlgorithms.h,
+//  for one maze or for a batch of mazes in parallel.
+//
+
+#ifndef MazeGeneration_h
+#define MazeGeneration_h
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdint>
+#include "Stack.h"
+#include "MazeGrid.h"
+#include "MazeFile.h"
+#include "MazeRandom.h"
+#include "MazeAlgorithms.h"
+#include "FixedMaze.h"
+#include "WorkStealing.h"
+#include "MazeStats.h"
+
+// Generate a maze in place with the recursive backtracker, inside the rectangle of width x height
+// cells whose lower left cell is (x0, y0). Only walls between two cells of the rectangle are
+// knocked down, so the cells of the rectangle end up as one spanning tree of their own.
+// Every cell is entered and left exactly once and each step only looks at the four neighbours,
+// so the whole run is linear in the number of cells. The stack holds one byte per step (the
+// direction that was taken), which is enough to walk back when backtracking.
+inline void generate_maze_region(MazeGrid & maze, int x0, int y0, int width, int height, MazeRandom & rnd) {
+
+    CellBitset visited(height, width);
+    Stack<unsigned char> stack1;
+    long long visited_count = 1;
+    long long cell_count = (long long)width * height;
+    if (cell_count == 0) {
+        return;
+    }
+
+    // Start at the lower left cell of the rectangle and mark it as visited (x, y relative to it)
+    int x = 0, y = 0;
+    visited.set(0, 0);
+
+    // Stop tracing back as soon as every cell has been visited
+    while(visited_count < cell_count) {
+
+        // Collect the directions that lead to an unvisited cell inside the rectangle (1 left, 2 right, 3 up, 4 down)
+        int candidates[4];
+        int count = 0;
+        if(x > 0 && !visited.test(x - 1, y)) {candidates[count++] = DIR_LEFT;}
+        if(x + 1 < width && !visited.test(x + 1, y)) {candidates[count++] = DIR_RIGHT;}
+        if(y + 1 < height && !visited.test(x, y + 1)) {candidates[count++] = DIR_UP;}
+        if(y > 0 && !visited.test(x, y - 1)) {candidates[count++] = DIR_DOWN;}
+
+        if(count == 0) {
+            // The current cell is a dead end, backtrack to the cell we came from
+            int way_back = opposite_direction(stack1.top());
+            stack1.pop();
+            MAZE_STAT_ADD(backtrack_pops, 1);
+            x += DIR_DX[way_back];
+            y += DIR_DY[way_back];
+            continue;
+        }
+
+        // Choose uniformly among the open directions
+        int way_of_the_cell = candidates[rnd.choice(count)];
+        MAZE_STAT_ADD(rng_draws, count > 1);
+        maze.removeWall(x0 + x, y0 + y, way_of_the_cell);
+        x += DIR_DX[way_of_the_cell];
+        y += DIR_DY[way_of_the_cell];
+
+        visited.set(x, y);
+        visited_count++;
+        stack1.push((unsigned char)way_of_the_cell);
+        MAZE_STAT_MAX(peak_stack_depth, stack1.size());
+    }
+}
+
+// Generate a maze in place with the recursive backtracker, starting at cell (0,0).
+// Sizes with a fixed-size kernel (FixedMaze.h) take it; the maze is the same either way.
+inline void generate_maze(MazeGrid & maze, MazeRandom & rnd) {
+    if (fixed_generate_maze(maze, rnd)) {
+        return;
+    }
+    generate_maze_region(maze, 0, 0, maze.columns(), maze.rows(), rnd);
+}
+
+// Generation algorithm from its command line name
+inline uint32_t maze_algorithm_from_name(const std::string & name) {
+    if (name == "backtracker") return MAZE_ALGORITHM_BACKTRACKER;
+    if (name == "kruskal") return MAZE_ALGORITHM_KRUSKAL;
+    if (name == "wilson") return MAZE_ALGORITHM_WILSON;
+    if (name == "prim") return MAZE_ALGORITHM_PRIM;
+    if (name == "sidewinder") return MAZE_ALGORITHM_SIDEWINDER;
+    if (name == "binary-tree") return MAZE_ALGORITHM_BINARY_TREE;
+    throw std::invalid_argument("unknown algorithm " + name + " (backtracker, kruskal, wilson, prim, sidewinder or binary-tree)");
+}
+
+// Name of a generation algorithm, as recorded in maze files
+inline std::string maze_algorithm_name(uint32_t algorithm) {
+    switch (algorithm) {
+        case MAZE_ALGORITHM_BACKTRACKER: return "backtracker";
+        case MAZE_ALGORITHM_ELLER: return "eller";
+        case MAZE_ALGORITHM_TILED_BACKTRACKER: return "tiled";
+        case MAZE_ALGORITHM_KRUSKAL: return "kruskal";
+        case MAZE_ALGORITHM_WILSON: return "wilson";
+        case MAZE_ALGORITHM_PRIM: return "prim";
+        case MAZE_ALGORITHM_SIDEWINDER: return "sidewinder";
+        case MAZE_ALGORITHM_BINARY_TREE: return "binary-tree";
+        case MAZE_ALGORITHM_EDITED: return "edited";
+        default: return "algorithm " + std::to_string(algorithm);
+    }
+}
+
+// Generate a maze in place with the given algorithm. Eller's algorithm writes its rows straight
+// to a file (StreamingGenerator.h) and the tiled backtracker needs its tile size, so neither is here.
+inline void generate_maze_with(MazeGrid & maze, uint32_t algorithm, MazeRandom & rnd) {
+    switch (algorithm) {
+        case MAZE_ALGORITHM_BACKTRACKER: generate_maze(maze, rnd); break;
+        case MAZE_ALGORITHM_KRUSKAL: generate_kruskal(maze, rnd); break;
+        case MAZE_ALGORITHM_WILSON: generate_wilson(maze, rnd); break;
+        case MAZE_ALGORITHM_PRIM: generate_prim(maze, rnd); break;
+        case MAZE_ALGORITHM_SIDEWINDER: generate_sidewinder(maze, rnd); break;
+        case MAZE_ALGORITHM_BINARY_TREE: generate_binary_tree(maze, rnd); break;
+        default: throw std::invalid_argument("cannot generate a maze in memory with " + maze_algorithm_name(algorithm));
+    }
+}
+
+//Function to generate a maze and write it to maze_<mazeID>.txt (or maze_<mazeID>.bin).
+// The maze is drawn from its own random stream, maze_seed(globalSeed, mazeID).
+inline void maze_generator(int row, int column, int mazeID, maze_file_format format, uint64_t globalSeed,
+                           uint32_t algorithm = MAZE_ALGORITHM_BACKTRACKER) {
+
+    // Every cell starts with all four walls
+    check_maze_size(row, column);
+    reset_maze_stats();
+    uint64_t seed = maze_seed(globalSeed, mazeID);
+    MazeRandom rnd(seed);
+    MazeGrid maze(row, column);
+    {
+        MAZE_STAT_TIMER(generate_seconds);
+        generate_maze_with(maze, algorithm, rnd);
+    }
+
+    // Call the function to write the maze to a file
+    {
+        MAZE_STAT_TIMER(write_seconds);
+        writing_output_file(maze, mazeID, format, seed, algorithm);
+    }
+    MazeStatsLog::report(mazeID, "generate", row, column);
+}
+
+// One maze of a batch
+struct maze_job {
+    int mazeID;
+    int rows;
+    int columns;
+    uint32_t algorithm;
+
+    maze_job(): mazeID(), rows(), columns(), algorithm(MAZE_ALGORITHM_BACKTRACKER) {}
+    maze_job(int idValue, int rowsValue, int columnsValue, uint32_t algorithmValue = MAZE_ALGORITHM_BACKTRACKER)
+        : mazeID(idValue), rows(rowsValue), columns(columnsValue), algorithm(algorithmValue) {}
+};
+
+// Generate a batch of mazes on several threads (0 = all hardware threads).
+// Idle threads steal jobs from busy ones, so mazes of different sizes still spread evenly.
+// Every maze uses its own seed, so the files are the same for any number of threads.
+inline void batch_maze_generator(const std::vector<maze_job> & jobs, maze_file_format format, uint64_t globalSeed, int threads) {
+    parallel_for_stealing(jobs.size(), threads, [&](size_t i) {
+        maze_generator(jobs[i].rows, jobs[i].columns, jobs[i].mazeID, format, globalSeed, jobs[i].algorithm);
+    });
+}
+
+// Read a batch description: one "mazeID rows columns [algorithm]" line per maze; lines without
+// an algorithm name use defaultAlgorithm
+inline std::vector<maze_job> read_job_file(const std::string & filename, uint32_t defaultAlgorithm = MAZE_ALGORITHM_BACKTRACKER) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("cannot open " + filename);
+    }
+    std::vector<maze_job> jobs;
+    std::string line;
+    while (getline(file, line)) {
+        std::istringstream fields(line);
+        maze_job job;
+        if (!(fields >> job.mazeID >> job.rows >> job.columns)) {
+            continue;
+        }
+        std::string name;
+        job.algorithm = (fields >> name) ? maze_algorithm_from_name(name) : defaultAlgorithm;
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+#endif /* MazeGeneration_h */
@@ -5,16 +5,18 @@
 // This C++ program demonstrates the generation of mazes using a  backtracking algorithm
 // and subsequently discovering a path from the entry to the exit points within the generated mazes.
 //
-// The program is using a stacks to manage maze cells and their attributes. Each cell
-// in the maze is represented by a struct named 'cell_of_maze', containing information such as the
-// presence of walls in four directions (up, down, right, left), coordinates (x, y), and whether the
-// cell has been visited or not.
+// The program is using stacks to manage the walk through the maze. The maze itself is kept in a
+// bit-packed 'MazeGrid' (MazeGrid.h) that stores two wall bits per cell, shared between
+// neighbouring cells, and the visited state lives in a separate 'CellBitset'. A line of the maze
+// file is represented by a struct named 'cell_of_maze', containing the presence of walls in four
+// directions (up, down, right, left) and the coordinates (x, y) of the cell.
 
 // The maze generation process is controlled by the 'maze_generator' function, which uses backtracking to create  paths.
 // The generated mazes are then stored in files, labeled with unique maze IDs.
 // To find a path within a specific maze, the 'path_discovery' function is used It uses the same maze
-// generation logic, backtracking, and a stack and a mattrix to discover a path from the entry to the exit points,
-// marking the visited cells in a separate matrix.
+// generation logic, backtracking, and a stack to discover a path from the entry to the exit points,
+// marking the visited cells in a separate bitset. Shortest paths can be found instead with the
+// breadth-first, bidirectional breadth-first and A* solvers of 'MazeSolver' (MazeSolver.h).
 
 // The program allows the user to specify the number of mazes to generate, the dimensions of each maze,
 // and the entry and exit points for path discovery
@@ -29,403 +31,316 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <map>
+#include <stdexcept>
+#include <random>
+#include <chrono>
+#include <algorithm>
 #include "Stack.h"
-#include "randgen.h"
+#include "MazeGrid.h"
+#include "MazeFile.h"
+#include "MazeRandom.h"
+#include "MazeGeneration.h"
+#include "StreamingGenerator.h"
+#include "TiledGenerator.h"
+#include "MazeSolver.h"
+#include "MazeFloodSolver.h"
+#include "MazeExternalSolver.h"
+#include "MazeTreeIndex.h"
+#include "MazePipeline.h"
+#include "MazeStats.h"
+#include "MazeService.h"
+#include "MazeValidator.h"
+#include "MazeAnalytics.h"
+#include "MazeEditor.h"
 
 using namespace std;
 
-struct cell_of_maze {
+// Discover a path through a binary maze file with the out-of-core solver, keeping at most
+// memoryLimit bytes in memory and its scratch files in scratchDirectory
+void external_path_discovery(int x_entry, int y_entry, int x_exit, int y_exit, int mazeID, maze_file_format format,
+                             path_file_format pathFormat, size_t memoryLimit, const string & scratchDirectory) {
 
-    // Indicates whether there is an opening to the up/down/left/right from this cell
-    bool up;
-    bool down;
-    bool right;
-    bool left;
-    int x,y;  // The coordinates of the cell in the maze
-    bool is_visited; // Indicates whether this cell has been visited
-
-    // Constructor with parameters
-    cell_of_maze(): up(true), down(true), right(true), left(true), x(), y(), is_visited(false) {}
-
-    // Constructor with custom values
-    cell_of_maze(bool upValue, bool downValue, bool rightValue, bool leftValue, int xValue, int yValue, bool isVisitedValue)
-
-            : up(upValue), down(downValue), right(rightValue), left(leftValue), x(xValue), y(yValue), is_visited(isVisitedValue) {}
-    
-    //Copy constructor
-    cell_of_maze(const cell_of_maze &other)
-            : up(other.up), down(other.down), right(other.right), left(other.left), x(other.x), y(other.y), is_visited(other.is_visited) {}
-};
-
-// Read a maze file and populate a stack with cell information
-void read_maze_file(Stack<cell_of_maze> & maze_stack, int mazeID) {
-    
-    int row, column;
-    string filename = "maze_" + to_string(mazeID) + ".txt";
-    ifstream file(filename);
-    string x, y, left, right, up, down;
-    
-    // Read the row and column information from the first line of the file
-    string line;
-    getline(file, line);
-    istringstream ss(line);
-    ss >> row >> column;
-    
-    // Read each line of cell information from the file and push it onto the maze_stack
-    while(getline(file, line)) {
-        istringstream ss(line);
-        // Extract and store cell attributes
-        cell_of_maze cell;
-        ss>>x >> y>>left>>right>>up>>down;
-        cell.x = stoi(x.substr(2));
-        cell.y= stoi(y.substr(2));
-        cell.left = stoi(left.substr(2));
-        cell.right = stoi(right.substr(2));
-        cell.up = stoi(up.substr(2));
-        cell.down = stoi(down.substr(2));
-        // Push the cell onto the maze_stack
-        maze_stack.push(cell);
+    if (format != MAZE_FORMAT_BINARY) {
+        throw invalid_argument("the external solver reads binary maze files (--format binary)");
     }
-    
-}
-
-// Function to write maze data to an output file
-void writing_output_file(Stack<cell_of_maze> &stack1, int rows, int columns, int mazeID,  Stack<cell_of_maze> & stack2) {
-    
-    string filename = "maze_" + to_string(mazeID) + ".txt";
-    // Open the output file
-    ofstream outFile(filename);
-    
-    // Write maze size (rows anf columns) to the file
-    outFile << rows << " " << columns << endl;
-    
-    // Create a 2D vector to represent the maze
-    vector<vector<cell_of_maze>> output_maze(columns, vector<cell_of_maze>(rows));
-
-    // Pop cells from stack1 and populate the output_maze
-    while(!stack1.isEmpty()) {
-        cell_of_maze cell2 = stack1.top();
-        stack1.pop();
-        output_maze[cell2.x][cell2.y]=cell2;
+    OutOfCoreSolver solver(maze_file_name(mazeID, format), memoryLimit, scratchDirectory);
+    {
+        MAZE_STAT_TIMER(search_seconds);
+        solver.solve(x_entry, y_entry, x_exit, y_exit);
     }
-    // Write the cells in the desired order and push them to stack2
-    for (int x = 0; x < columns; x++) {
-        for (int y = 0; y < rows; y++) {
-            cell_of_maze cell = output_maze[x][y];
-            outFile << "x=" << cell.x << " y=" << cell.y << " l=" << cell.left << " r=" << cell.right<< " u=" << cell.up << " d=" << cell.down << endl;
-            stack2.push(cell);
-        }
+    {
+        MAZE_STAT_TIMER(write_seconds);
+        solver.writePath(mazeID, x_exit, y_exit, pathFormat);
     }
-    
-    // Close the file
-    outFile.close();
-
+    cout << "maze " << mazeID << " path length " << solver.pathLength() << ": " << solver.passes() << " I/O passes over "
+         << solver.bands() << " bands of " << solver.bandRows() << " rows, " << solver.bandLoads() << " band loads, read "
+         << solver.bytesRead() / 1000000 << " MB, wrote " << solver.bytesWritten() / 1000000 << " MB" << endl;
+    MazeStatsLog::report(mazeID, "solve", solver.mazeRows(), solver.mazeColumns());
 }
 
-// Write the path information from a stack to a file for a specific maze
-void writing_path_file(Stack<cell_of_maze>& stack1, int rows, int columns, int mazeID, int x_entry, int y_entry,int x_exit,int y_exit) {
-    
-    
-    // Generate the path file's filename based on mazeID and entry/exit coordinates
-    string filename = "maze_" + to_string(mazeID) +"_path_"+to_string(x_entry)+ "_"+to_string(y_entry)+ "_"+ to_string(x_exit) + "_"+to_string(y_exit)+".txt";
-    Stack<cell_of_maze> stack2;
-
-    // Open the output file for writing
-    ofstream outFile(filename);
-
-    // Copy the cell information from stack1 to stack2
-    while(!stack1.isEmpty()) {
-        cell_of_maze cell2 = stack1.top();
-        stack2.push(cell2);
-        stack1.pop();
+// Discover a path through the maze, with the randomized backtracking search (SOLVER_DFS)
+// or one of the shortest-path solvers. The random walk uses the maze's stream, maze_seed(globalSeed, mazeID),
+// jumped once past the part the generator used, so the same --seed gives the same path.
+// SOLVER_EXTERNAL goes to external_path_discovery with the given memory limit.
+void path_discovery(int x_entry, int y_entry,int x_exit,int y_exit, int mazeID, maze_file_format format, solver_mode mode, uint64_t globalSeed,
+                    path_file_format pathFormat, size_t memoryLimit = DEFAULT_SOLVER_MEMORY, const string & scratchDirectory = ".") {
+
+    reset_maze_stats();
+    if(mode == SOLVER_EXTERNAL) {
+        external_path_discovery(x_entry, y_entry, x_exit, y_exit, mazeID, format, pathFormat, memoryLimit, scratchDirectory);
+        return;
+    }
+
+    // Load the maze file associated with the mazeID; a binary file is mapped, not parsed
+    MazeFile maze_file(maze_file_name(mazeID, format));
+    const MazeGrid & maze = maze_file.grid();
+    Stack<unsigned char> stack_for_solving;
+    bool reached;
+
+    {
+        MAZE_STAT_TIMER(search_seconds);
+        if(mode == SOLVER_DFS) {
+            if(!maze.contains(x_entry, y_entry) || !maze.contains(x_exit, y_exit)) {
+                throw invalid_argument("entry or exit outside the maze");
+            }
+            MazeRandom rnd(maze_seed(globalSeed, mazeID));
+            rnd.jump();
+            reached = random_path_search(maze, x_entry, y_entry, x_exit, y_exit, stack_for_solving, rnd);
+        }
+        else if(mode == SOLVER_FLOOD) {
+            FloodSolver solver(maze);
+            reached = solver.solve(x_entry, y_entry, x_exit, y_exit, stack_for_solving);
+        }
+        else {
+            reached = shortest_path_search(maze, mode, x_entry, y_entry, x_exit, y_exit, stack_for_solving);
+        }
     }
     
-    // Write the coordinates of the path cells to the output file
-    while (!stack2.isEmpty()) {
-        cell_of_maze cell = stack2.top();
-        outFile << cell.x << " "<<cell.y << endl;
-        stack2.pop();
-        
+    // Call the function to write the path to a file
+    {
+        MAZE_STAT_TIMER(write_seconds);
+        write_path_result(reached, stack_for_solving, mazeID,  x_entry,  y_entry, x_exit, y_exit, pathFormat);
     }
-    // Close the file
-    outFile.close();
-}
+    MazeStatsLog::report(mazeID, "solve", maze.rows(), maze.columns());
 
-// Check if a cell is within the maze boundaries
-bool is_in_boundaries(int x, int y, int rows, int columns) {
-    bool check;
-    check= (x >= 0 && x < columns && y >= 0 && y < rows);
-    return check;
 }
 
+// Answer every entry/exit pair of a query file against one maze in a single pass.
+// The maze is loaded and indexed once; each result line is "x_entry y_entry x_exit y_exit length"
+// (length -1 when there is no path). With writePaths every path also gets its usual path file.
+void path_queries(int mazeID, maze_file_format format, const string & queryFile, const string & resultFile, bool writePaths,
+                  path_file_format pathFormat) {
 
+    MazeFile maze_file(maze_file_name(mazeID, format));
+    MazeTreeIndex index(maze_file.grid());
+    vector<path_query> queries = read_query_file(queryFile);
 
-// Check if a cell is unvisited
-bool unvisited_check(vector<vector<cell_of_maze>> & isvisitedvector, int j, int k) {
-    bool check =true;
-    // Check if j and k are within valid bounds
-    if ( (j >= 0 && j < isvisitedvector.size()) && (k >= 0 && k < isvisitedvector[0].size()) ) {
-        check = isvisitedvector[j][k].is_visited;
-        return check;
+    ofstream outFile(resultFile);
+    if (!outFile) {
+        throw runtime_error("cannot write " + resultFile);
     }
-    return check;
-
-}
-
-// Check if all cells in the maze have been visited
-bool isAllVisited(vector<vector<cell_of_maze>>& isvisitedvector) {
-
-    for (int i=0; i<isvisitedvector.size(); i++) {
-        for(int j=0; j<isvisitedvector[i].size(); j++)
-            if(isvisitedvector[i][j].is_visited == false) {
-                return false;
-            }
+    Stack<unsigned char> moves;
+    for (size_t i = 0; i < queries.size(); i++) {
+        const path_query & q = queries[i];
+        long long length = index.pathLength(q.x_entry, q.y_entry, q.x_exit, q.y_exit);
+        outFile << q.x_entry << " " << q.y_entry << " " << q.x_exit << " " << q.y_exit << " " << length << '\n';
+        if (writePaths) {
+            moves.clear();
+            bool reached = index.path(q.x_entry, q.y_entry, q.x_exit, q.y_exit, moves);
+            write_path_result(reached, moves, mazeID, q.x_entry, q.y_entry, q.x_exit, q.y_exit, pathFormat);
+        }
+    }
+    if (!index.isPerfect()) {
+        cerr << "maze " << mazeID << " is not a perfect maze, lengths are along a spanning tree and may not be the shortest" << endl;
     }
-    return true;
-
 }
 
-// Check if the current cell is a dead end, considering if there are walls in each direction
-bool isdeadEnd(cell_of_maze Currentcell, vector<vector<cell_of_maze>>& isvisitedvector,int rows,int columns, bool path ) {
-
-    // Check all four directions (up, down, right, left) if they are visited or not and if they are in boundaries
-    bool isRightWall = false, isLeftWall = false, isUpWall = false, isDownWall = false, check;
-
-    bool isUpVisited= ((is_in_boundaries(Currentcell.x, (Currentcell.y+1),  rows, columns) && isvisitedvector[Currentcell.x][(Currentcell.y)+1].is_visited) || !is_in_boundaries(Currentcell.x, Currentcell.y+1, rows, columns));
-
-    bool isDownVisited= ((is_in_boundaries(Currentcell.x, (Currentcell.y-1),  rows, columns) && isvisitedvector[Currentcell.x][(Currentcell.y)-1].is_visited) || !is_in_boundaries(Currentcell.x, Currentcell.y-1, rows, columns));
-
-    bool isRightVisited = ((is_in_boundaries((Currentcell.x + 1), Currentcell.y, rows, columns) && isvisitedvector[Currentcell.x + 1][Currentcell.y].is_visited) || !is_in_boundaries(Currentcell.x + 1, Currentcell.y, rows, columns));
-
-    bool isLeftVisited = ((is_in_boundaries((Currentcell.x - 1), Currentcell.y, rows, columns) && isvisitedvector[Currentcell.x - 1][Currentcell.y].is_visited) || !is_in_boundaries(Currentcell.x - 1, Currentcell.y, rows, columns));
-
-    
-    //Checks whether there is a wall in each direction for if we are looking for path
-    if(path){
-        if(Currentcell.left) {
-            isLeftWall = true;
-        }  if (Currentcell.right) {
-            isRightWall = true;
-        }  if(Currentcell.up) {
-            isUpWall = true;
-        } if (Currentcell.down) {
-            isDownWall = true;
-        }
-
+// Apply the wall edits of an edit file to maze_<mazeID>, batch edits at a time, keeping the path
+// between the entry and the exit up to date, and report the time per batch next to one full
+// breadth-first solve of the edited maze. The maze is written back (recorded as edited) with its path.
+void edit_maze(int mazeID, int x_entry, int y_entry, int x_exit, int y_exit, const string & editFile, size_t batch,
+               maze_file_format format, path_file_format pathFormat) {
+    vector<wall_edit> edits = read_edit_file(editFile);
+    MazeGrid maze;
+    uint64_t seed;
+    {
+        MazeFile source(maze_file_name(mazeID, format));
+        maze = source.grid();
+        seed = source.seed();
     }
-    check = isUpVisited && isDownVisited && isRightVisited && isLeftVisited;
-    
-    // If 'path' is true, consider walls
-    if(path) {
-        check = (isLeftVisited || isLeftWall) && (isRightWall || isRightVisited) && (isUpWall || isUpVisited) && (isDownWall || isDownVisited);
+    MazeEditor editor(maze, x_entry, y_entry, x_exit, y_exit);
+
+    batch = max(batch, (size_t)1);
+    vector<double> latencies;
+    double total = 0;
+    for (size_t i = 0; i < edits.size(); i += batch) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        editor.apply(&edits[i], min(batch, edits.size() - i));
+        latencies.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        total += latencies.back();
     }
-    return check;
-
+    sort(latencies.begin(), latencies.end());
+
+    Stack<unsigned char> moves;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    MazeSolver solver(maze);
+    bool solved = solver.solve(SOLVER_BFS, x_entry, y_entry, x_exit, y_exit, moves);
+    double resolve = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long long shortest = solved ? (long long)moves.size() : -1;
+
+    moves.clear();
+    bool reached = editor.path(moves);
+    writing_output_file(maze, mazeID, format, seed, MAZE_ALGORITHM_EDITED);
+    write_path_result(reached, moves, mazeID, x_entry, y_entry, x_exit, y_exit, pathFormat);
+
+    cout << "maze " << mazeID << ": " << edits.size() << " edits in " << latencies.size() << " batches";
+    if (!latencies.empty()) {
+        cout << ", " << latencies[latencies.size() / 2] * 1e6 << " us per batch (median), " << total / latencies.size() * 1e6
+             << " us mean, " << latencies.back() * 1e6 << " us at most";
+    }
+    cout << endl << "path length " << editor.pathLength() << " (shortest " << shortest << "), " << editor.componentCount()
+         << " connected parts; a full breadth-first solve takes " << resolve * 1e6 << " us" << endl;
 }
 
-//Function to generate a maze
-void maze_generator(Stack<cell_of_maze> stack1,  vector<vector<cell_of_maze>> isvisitedvector, int row, int column, Stack<cell_of_maze> stack2, int mazeID) {
-
-    cell_of_maze cell1;
-    RandGen(rnd);
-    bool deadEnd;
-    
-    // Initialize the starting cell(0,0) and push it
-    cell1.x=0;
-    cell1.y=0;
-    cell1.is_visited=true;
-    stack1.push(cell1);
-    
-    // Create a copy of the starting cell
-    cell_of_maze cell2 =cell1;
-    // Mark the starting cell as visited in the isvisitedvector
-    isvisitedvector[0][0].is_visited=true;
-
-    while(!stack1.isEmpty()){
-        if (isAllVisited(isvisitedvector)) {
-            break; // Stop tracing back if all cells have been visited
-        }
-        bool found = false; // A flag to track if a valid cell has been found in any direction
-        cell_of_maze currentCell = stack1.top();
-        // Check if the current cell is a dead end
-        deadEnd = isdeadEnd(currentCell, isvisitedvector, row, column, false);
-        if(!deadEnd) {
-            while(!found) {
-                // Generate a random number to choose a direction (1 up, 2 down, 3 right, 4 left)
-                int way_of_the_cell = rnd.RandInt(1, 4);
-                
-                //Check if the cell is visited or not and in if in boundries while looking for direction
-                //Moving right
-                if(way_of_the_cell==2 && unvisited_check(isvisitedvector, (currentCell.x)+1, ((currentCell.y)))== false && is_in_boundaries((currentCell.x)+1, ((currentCell.y)), row, column) == true) {
-                    
-                    stack1.setTop(2);
-                    cell_of_maze cell2;
-                    cell2.x=(currentCell.x)+1;
-                    cell2.y=((currentCell.y));
-                    cell2.is_visited=true;
-                    cell2.left=false;
-                    isvisitedvector[cell2.x][cell2.y].is_visited=true;
-                    stack1.push(cell2);
-                    found=true;
-                }
-                //Moving left
-                else if(way_of_the_cell==1 && unvisited_check(isvisitedvector, (currentCell.x)-1, ((currentCell.y)))==false && is_in_boundaries((currentCell.x)-1, ((currentCell.y)), row, column)==true) {
-
-                    stack1.setTop(1);
-                    cell_of_maze cell2;
-                    cell2.x=(currentCell.x)-1;
-                    cell2.y=((currentCell.y));
-                    cell2.is_visited=true;
-                    cell2.right=false;
-                    isvisitedvector[cell2.x][cell2.y].is_visited=true;
-                    stack1.push(cell2);
-                    found=true;
-                }
-                
-                //Moving up
-                else if(way_of_the_cell==3 && unvisited_check(isvisitedvector, ((currentCell.x)), ((currentCell.y)+1))== false && is_in_boundaries(((currentCell.x)), ((currentCell.y)+1), row, column)==true) {
-                    
-                    stack1.setTop(3);
-                    cell_of_maze cell2;
-                    cell2.x=((currentCell.x));
-                    cell2.y=((currentCell.y)+1);
-                    cell2.is_visited=true;
-                    cell2.down=false;
-                    isvisitedvector[cell2.x][cell2.y].is_visited=true;
-                    stack1.push(cell2);
-                    found=true;
-
-                }
-                //Moving down
-                else if(way_of_the_cell==4 && unvisited_check(isvisitedvector, ((currentCell.x)), ((currentCell.y)-1))== false &&is_in_boundaries(((currentCell.x)), ((currentCell.y)-1), row, column)==true ) {
-
-                    stack1.setTop(4);
-                    cell_of_maze cell2;
-                    cell2.x=((currentCell.x));
-                    cell2.y=((currentCell.y)-1);
-                    cell2.is_visited=true;
-                    cell2.up=false;
-                    isvisitedvector[cell2.x][cell2.y].is_visited=true;
-                    stack1.push(cell2);
-                    found=true;
-                }
-                break;
+// Generate maze_<mazeID> again from the seed, size and algorithm recorded in an existing maze file.
+// A tiled maze also needs the tile size it was made with.
+void regenerate_maze(const string & filename, int mazeID, maze_file_format format, int tileSize, int threads) {
+    uint64_t seed;
+    uint32_t algorithm;
+    int rows, columns;
+    {
+        MazeFile source(filename);
+        seed = source.seed();
+        algorithm = source.algorithm();
+        rows = source.grid().rows();
+        columns = source.grid().columns();
+    }
+    if (algorithm == MAZE_ALGORITHM_EDITED) {
+        throw runtime_error(filename + " was edited after it was generated and cannot be generated again");
+    }
+    reset_maze_stats();
+    if (algorithm == MAZE_ALGORITHM_ELLER) {
+        MazeRandom rnd(seed);
+        MAZE_STAT_TIMER(generate_seconds);
+        streaming_maze_generator(rows, columns, maze_file_name(mazeID, format), format, rnd, seed);
+    }
+    else {
+        MazeGrid maze(rows, columns);
+        {
+            MAZE_STAT_TIMER(generate_seconds);
+            if (algorithm == MAZE_ALGORITHM_TILED_BACKTRACKER) {
+                generate_tiled_maze(maze, seed, tileSize, threads);
+            }
+            else {
+                MazeRandom rnd(seed);
+                generate_maze_with(maze, algorithm, rnd);
             }
         }
-        else {
-            // The current cell is a dead end, backtrack by popping it from stack1 and pushing it to stack2
-            cell_of_maze x = stack1.top();
-            stack1.pop();
-            stack2.push(x);
-        }
+        MAZE_STAT_TIMER(write_seconds);
+        writing_output_file(maze, mazeID, format, seed, algorithm);
     }
-    // After generating the maze, push the remaining cells in stack1 to stack2 for writing to a file
-    while(!stack1.isEmpty()) {
-        cell_of_maze x = stack1.top();
-        stack1.pop(); // stack2 ye push et
-        stack2.push(x);
-    }
-    // Call the function to write the maze to a file
-    writing_output_file(stack2, row, column, mazeID, stack1);
+    MazeStatsLog::report(mazeID, "generate", rows, columns);
 }
 
-// Discover a path through the maze
-void path_discovery(Stack<cell_of_maze> & stack2, int x_entry, int y_entry,int x_exit,int y_exit, Stack<cell_of_maze> & stack_for_solving, vector<vector<cell_of_maze>> & path_matrix, int row, int column, int mazeID) {
-
-    // Read the maze data from the maze file associated with the mazeID
-    read_maze_file(stack2, mazeID);
-    RandGen(rnd);
-    bool deadEnd;
+// Command line: options of the form "--name value" and the remaining positional arguments
+struct command_line {
+    vector<string> arguments;
+    map<string, string> options;
 
-    // Copy cell information from stack2 to the path_matrix
-    while(!stack2.isEmpty()) {
-        cell_of_maze cell = stack2.top();
-        path_matrix[cell.x][cell.y]= cell;
-        path_matrix[cell.x][cell.y].is_visited=false;
-        stack2.pop();
+    string option(const string & name, const string & fallback) const {
+        map<string, string>::const_iterator it = options.find(name);
+        return it == options.end() ? fallback : it->second;
     }
-    
-    // Mark the entry cell as visited and push it to stack_for_solving
-    path_matrix[x_entry][y_entry].is_visited = true;
-    stack_for_solving.push(path_matrix[x_entry][y_entry]);
-
-    while(!stack_for_solving.isEmpty()){
-        bool found = false;// A flag to track if a valid cell has been found in any direction
-        cell_of_maze currentCell = stack_for_solving.top();
-        // Exit condition: The exit cell has been reached
-        
-        if(currentCell.x==x_exit && currentCell.y==y_exit) {
-            break;
-        }
-        // Check if the current cell is a dead end
-        deadEnd = isdeadEnd(currentCell, path_matrix, row, column, true);
-        if(!deadEnd) {
-            while(!found) {
-                // Generate a random number to choose a direction (1 up, 2 down, 3 right, 4 left)
-                int way_of_the_cell = rnd.RandInt(1, 4);
-                
-                //Check if the cell is visited or not and in if in boundries while looking for direction
-                if(way_of_the_cell==1 && !unvisited_check(path_matrix, (currentCell.x+1) , ((currentCell.y))) &&
-                   is_in_boundaries((currentCell.x+1) , ((currentCell.y)), row, column) && !path_matrix[(currentCell.x+1) ][currentCell.y].left) { // moving right
-                    cell_of_maze cell2;
-                    cell2.x=(currentCell.x)+1;
-                    cell2.y=((currentCell.y));
-                    path_matrix[cell2.x][cell2.y].is_visited=true;
-                    stack_for_solving.push(path_matrix[cell2.x][cell2.y]);
-                    found=true;
-                }
-                
-                else if(way_of_the_cell==2 && unvisited_check(path_matrix, (currentCell.x)-1, ((currentCell.y)))==false && is_in_boundaries((currentCell.x)-1, ((currentCell.y)), row, column)==true && path_matrix[(currentCell.x)-1][currentCell.y].right == false) { // moving left
-                    cell_of_maze cell2;
-                    cell2.x=(currentCell.x)-1;
-                    cell2.y=((currentCell.y));
-                    path_matrix[cell2.x][cell2.y].is_visited=true;
-                    stack_for_solving.push(path_matrix[cell2.x][cell2.y]);
-                    found=true;
-                }
-                else if(way_of_the_cell==3 && unvisited_check(path_matrix, ((currentCell.x)), ((currentCell.y)+1))== false && is_in_boundaries(((currentCell.x)), ((currentCell.y)+1), row, column)==true && path_matrix[(currentCell.x)][(currentCell.y)+1].down == false) { // moving up
-                    cell_of_maze cell2;
-                    cell2.x=((currentCell.x));
-                    cell2.y=((currentCell.y)+1);
-                    path_matrix[cell2.x][cell2.y].is_visited=true;
-                    stack_for_solving.push(path_matrix[cell2.x][cell2.y]);
-                    found=true;
-                }
 
-                else if(way_of_the_cell==4 && unvisited_check(path_matrix, ((currentCell.x)), ((currentCell.y)-1))== false &&is_in_boundaries(((currentCell.x)), ((currentCell.y)-1), row, column)==true && path_matrix[(currentCell.x)][(currentCell.y)-1].up == false) { // moving down
-                    cell_of_maze cell2;
-                    cell2.x=((currentCell.x));
-                    cell2.y=((currentCell.y)-1);
+    long long number(const string & name, long long fallback) const {
+        map<string, string>::const_iterator it = options.find(name);
+        return it == options.end() ? fallback : stoll(it->second);
+    }
 
-                    path_matrix[cell2.x][cell2.y].is_visited=true;
-                    stack_for_solving.push(path_matrix[cell2.x][cell2.y]);
+    // Positional argument i as a number
+    long long argument(size_t i) const {
+        return stoll(arguments.at(i));
+    }
+};
 
-                    found=true;
-                }
-                break;
+command_line parse_command_line(int argc, char * argv[]) {
+    command_line line;
+    for (int i = 1; i < argc; i++) {
+        string word = argv[i];
+        if (word.size() > 2 && word.compare(0, 2, "--") == 0) {
+            if (i + 1 >= argc) {
+                throw invalid_argument("missing value for " + word);
             }
+            line.options[word.substr(2)] = argv[++i];
         }
         else {
-            // The current cell is a dead end, backtrack by popping it from stack_for_solving
-            stack_for_solving.pop();
+            line.arguments.push_back(word);
         }
     }
-    
-    // Call the function to write the path to a file
-    writing_path_file(stack_for_solving, row, column, mazeID,  x_entry,  y_entry, x_exit, y_exit);
+    return line;
+}
 
+// Print the command line options
+void print_usage(const char * program) {
+    cout << "Usage:" << endl;
+    cout << "  " << program << " [--format text|binary|compressed] [--solver S]  generate mazes and find a path interactively" << endl;
+    cout << "  " << program << " solve <mazeID> <x_entry> <y_entry> <x_exit> <y_exit> [--solver S] [--format text|binary|compressed]" << endl;
+    cout << "      find a path in an existing maze file; S is dfs (random walk with backtracking, the default)," << endl;
+    cout << "      bfs, bidirectional or astar (shortest path), or flood (bit-parallel flood fill, which finds the only" << endl;
+    cout << "      path of a perfect maze and some path of a maze with loops)" << endl;
+    cout << "  " << program << " solve <mazeID> <x_entry> <y_entry> <x_exit> <y_exit> --solver external --format binary" << endl;
+    cout << "      [--memory-limit M] [--scratch dir]  flood fill of a binary maze file larger than memory, in bands of" << endl;
+    cout << "      rows that fit in M bytes (K, M or G suffix; 256M by default), with scratch files in dir" << endl;
+    cout << "  " << program << " query <mazeID> <queries> [--output file] [--paths 1] [--format text|binary|compressed]" << endl;
+    cout << "      path lengths for every \"x_entry y_entry x_exit y_exit\" line of the queries file, from a tree" << endl;
+    cout << "      index built once (default output maze_N_results.txt); --paths 1 also writes the path files" << endl;
+    cout << "  " << program << " validate <maze file>... [--threads T]  check maze files before using them: cells in range" << endl;
+    cout << "      and listed once, neighbours agreeing on their shared walls, a closed border, and a perfect maze" << endl;
+    cout << "      (connected, without loops); the first problem of a file is reported with its line or cell" << endl;
+    cout << "  " << program << " analyze <mazeID>... [--output file.csv] [--distances 1] [--threads T] [--format text|binary|compressed]" << endl;
+    cout << "      difficulty metrics of each maze as a CSV line: the longest path and its ends, mean distance," << endl;
+    cout << "      dead ends, junctions, turns and corridor lengths; --distances 1 also writes the distance map" << endl;
+    cout << "      from the entry of the longest path to maze_N_distances.bin" << endl;
+    cout << "  " << program << " edit <mazeID> <x_entry> <y_entry> <x_exit> <y_exit> <edit file> [--batch N] [--format ...]" << endl;
+    cout << "      apply the \"open|close x y left|right|up|down\" lines of an edit file to a maze, N at a time, keeping" << endl;
+    cout << "      its path and connectivity up to date; the maze and its path file are written back" << endl;
+    cout << "  " << program << " convert <input> <output>  convert a maze file between the text, binary and compressed" << endl;
+    cout << "      formats (chosen by the output's .txt, .bin or .rle extension), or a path file between the text" << endl;
+    cout << "      and compact formats (an output ending in .path is compact)" << endl;
+    cout << "  " << program << " pipeline <number> <rows> <columns> <x_entry> <y_entry> <x_exit> <y_exit> [--solver S]" << endl;
+    cout << "      [--persist none|sync|async] [--threads T] [--format text|binary|compressed]" << endl;
+    cout << "      generate mazes 1..number and solve each in memory; the maze and path files are written in" << endl;
+    cout << "      the background (async, the default), before the next maze (sync) or not at all (none)" << endl;
+    cout << "  " << program << " stream <rows> <columns> <mazeID> [--format text|binary|compressed]" << endl;
+    cout << "      generate one maze row by row with Eller's algorithm, using memory for one row only" << endl;
+    cout << "  " << program << " batch <number> <rows> <columns> [--threads T] [--format text|binary|compressed]" << endl;
+    cout << "  " << program << " batch --jobs <file> [--threads T] [--format text|binary|compressed]" << endl;
+    cout << "      generate mazes 1..number (or the \"mazeID rows columns\" lines of a job file) in parallel" << endl;
+    cout << "  " << program << " tiled <rows> <columns> <mazeID> [--threads T] [--tile N] [--format text|binary|compressed]" << endl;
+    cout << "      generate one large maze on several threads, N x N tiles (N rounded up to 64 columns) joined into one maze" << endl;
+    cout << "  " << program << " regenerate <maze file> <mazeID> [--tile N] [--format text|binary|compressed]" << endl;
+    cout << "      generate a maze again from the seed and algorithm recorded in its file (a text file written" << endl;
+    cout << "      before the algorithm was recorded is taken as a backtracker maze; a tiled maze needs its --tile)" << endl;
+    cout << "  " << program << " serve <socket> [--threads T] [--cache-memory M] [--persist none|sync] [--format text|binary|compressed]" << endl;
+    cout << "      answer generate and solve requests on a Unix domain socket until a shutdown request, keeping" << endl;
+    cout << "      mazes and their tree indexes in a least recently used cache of M bytes (512M by default)" << endl;
+    cout << "  " << program << " load <socket> <connections> <requests> <mazes> <rows> <columns>" << endl;
+    cout << "      load test of a service: generate mazes 1..mazes, send random solve requests over several" << endl;
+    cout << "      connections at once and report the throughput and latencies" << endl;
+    cout << "Generation and path discovery report per-maze counters and phase times with --stats <file.csv> or" << endl;
+    cout << "--stats stderr (one CSV line per maze)." << endl;
+    cout << "Generating modes (interactive, pipeline, batch) take --algorithm A: backtracker (the default), kruskal," << endl;
+    cout << "wilson, prim, sidewinder or binary-tree; a job file line can name its own algorithm after the columns." << endl;
+    cout << "Path files are written as text, or with --path-format compact as 2 bits per step (.path files)." << endl;
+    cout << "Every mode takes --seed S; maze N is generated from a stream derived from (S, N), so the same" << endl;
+    cout << "seed gives the same mazes whatever the number of threads. Without --seed a random seed is used." << endl;
 }
-int main() {
+
+// Generate mazes and find a path, asking for everything on the console
+void interactive_session(maze_file_format format, uint64_t seed, solver_mode mode, path_file_format pathFormat, uint32_t algorithm) {
     int number_of_mazes, rows, columns, mazeID, x_entry, y_entry, x_exit, y_exit;
-    
-    // Initialize stacks and vectors to store maze data and path information
-    Stack<cell_of_maze> stack1;
-    Stack<cell_of_maze> stack2;
-    Stack<cell_of_maze> stack_for_solving;
-    Stack<cell_of_maze>  stack_for_output;
-    Stack<cell_of_maze>  maze_stack;
-
-    vector<vector<cell_of_maze>>  path_stack;
+
     // Prompt the user for the number of mazes, rows, columns to generate
     cout << "Enter the number of mazes: " << endl;
     cin>> number_of_mazes;
@@ -433,13 +348,9 @@ int main() {
     cout << "Enter the number of rows and columns (M and N): " << endl;
     cin>> rows >> columns;
     
-    // Initialize vectors to represent visited cells and paths
-    vector<vector<cell_of_maze>>isvisitedvector(columns, vector<cell_of_maze>(rows));
-    vector<vector<cell_of_maze>>  path_matrix(columns, vector<cell_of_maze>(rows));
-    
     // Generate the specified number of mazes and display a message when done
     for(int i=1; i<=number_of_mazes; i++) {
-        maze_generator(stack1, isvisitedvector, rows, columns, stack2, i);
+        maze_generator(rows, columns, i, format, seed, algorithm);
     }
     cout << "All mazes are generated."<<endl;
     
@@ -454,7 +365,164 @@ int main() {
     cin>> x_exit >> y_exit;
     
     // Discover and write the path for the specified maze
-    path_discovery(maze_stack, x_entry,  y_entry, x_exit, y_exit,  stack_for_solving,  path_matrix,  rows,  columns, mazeID);
+    path_discovery(x_entry,  y_entry, x_exit, y_exit, mazeID, format, mode, seed, pathFormat);
+}
+
+int main(int argc, char * argv[]) {
+    try {
+        command_line line = parse_command_line(argc, argv);
+        string format_name = line.option("format", "text");
+        string path_format_name = line.option("path-format", "text");
+        if ((format_name != "text" && format_name != "binary" && format_name != "compressed") ||
+            (path_format_name != "text" && path_format_name != "compact")) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        maze_file_format format = (format_name == "binary") ? MAZE_FORMAT_BINARY :
+                                  (format_name == "compressed") ? MAZE_FORMAT_COMPRESSED : MAZE_FORMAT_TEXT;
+        path_file_format pathFormat = (path_format_name == "compact") ? PATH_FORMAT_COMPACT : PATH_FORMAT_TEXT;
+        string command = line.arguments.empty() ? "" : line.arguments[0];
+        uint64_t seed = line.options.count("seed") ? stoull(line.options["seed"]) : ((uint64_t)random_device()() << 32 | random_device()());
+        int threads = (int)line.number("threads", 0);
+        solver_mode mode = solver_mode_from_name(line.option("solver", "dfs"));
+        uint32_t algorithm = maze_algorithm_from_name(line.option("algorithm", "backtracker"));
+        if (line.options.count("stats")) {
+            MazeStatsLog::open(line.options["stats"]);
+        }
+
+        if (command.empty()) {
+            interactive_session(format, seed, mode, pathFormat, algorithm);
+        }
+        else if (command == "convert" && line.arguments.size() == 3) {
+            const string & output = line.arguments[2];
+            bool path = is_compact_path_file(line.arguments[1]) || (output.size() >= 5 && output.compare(output.size() - 5, 5, ".path") == 0);
+            if (path) {
+                convert_path_file(line.arguments[1], output);
+            }
+            else {
+                convert_maze_file(line.arguments[1], output);
+            }
+        }
+        else if (command == "solve" && line.arguments.size() == 6) {
+            path_discovery((int)line.argument(2), (int)line.argument(3), (int)line.argument(4), (int)line.argument(5),
+                           (int)line.argument(1), format, mode, seed, pathFormat,
+                           line.options.count("memory-limit") ? memory_size_from_name(line.options["memory-limit"]) : DEFAULT_SOLVER_MEMORY,
+                           line.option("scratch", "."));
+        }
+        else if (command == "query" && line.arguments.size() == 3) {
+            int mazeID = (int)line.argument(1);
+            path_queries(mazeID, format, line.arguments[2], line.option("output", "maze_" + to_string(mazeID) + "_results.txt"),
+                         line.number("paths", 0) != 0, pathFormat);
+        }
+        else if (command == "pipeline" && line.arguments.size() == 8) {
+            // Mazes 1..number, each generated and solved in memory; the files are written on the side
+            int number = (int)line.argument(1), rows = (int)line.argument(2), columns = (int)line.argument(3);
+            int x_entry = (int)line.argument(4), y_entry = (int)line.argument(5), x_exit = (int)line.argument(6), y_exit = (int)line.argument(7);
+            persistence_mode persistence = persistence_mode_from_name(line.option("persist", "async"));
+            AsyncMazeWriter writer(format);
+            vector<long long> lengths(number);
+            parallel_for_stealing(number, threads, [&](size_t i) {
+                lengths[i] = generate_and_solve(rows, columns, (int)i + 1, x_entry, y_entry, x_exit, y_exit, mode, seed,
+                                                persistence, format, &writer, pathFormat, algorithm);
+            });
+            writer.finish();
+            for (int i = 0; i < number; i++) {
+                cout << "maze " << i + 1 << " path length " << lengths[i] << endl;
+            }
+        }
+        else if (command == "regenerate" && line.arguments.size() == 3) {
+            regenerate_maze(line.arguments[1], (int)line.argument(2), format, (int)line.number("tile", 512), threads);
+        }
+        else if (command == "stream" && line.arguments.size() == 4) {
+            // The rows are written as they are made, so the generate time includes the writes
+            int rows = (int)line.argument(1), columns = (int)line.argument(2), mazeID = (int)line.argument(3);
+            MazeRandom rnd(maze_seed(seed, mazeID));
+            reset_maze_stats();
+            {
+                MAZE_STAT_TIMER(generate_seconds);
+                streaming_maze_generator(rows, columns, maze_file_name(mazeID, format), format, rnd, maze_seed(seed, mazeID));
+            }
+            MazeStatsLog::report(mazeID, "generate", rows, columns);
+        }
+        else if (command == "batch" && (line.arguments.size() == 4 || (line.arguments.size() == 1 && line.options.count("jobs")))) {
+            vector<maze_job> jobs;
+            if (line.options.count("jobs")) {
+                jobs = read_job_file(line.options["jobs"], algorithm);
+            }
+            else {
+                for (int i = 1; i <= (int)line.argument(1); i++) {
+                    jobs.push_back(maze_job(i, (int)line.argument(2), (int)line.argument(3), algorithm));
+                }
+            }
+            batch_maze_generator(jobs, format, seed, threads);
+            cout << jobs.size() << " mazes generated with seed " << seed << endl;
+        }
+        else if (command == "tiled" && line.arguments.size() == 4) {
+            tiled_maze_generator((int)line.argument(1), (int)line.argument(2), (int)line.argument(3), format, seed,
+                                 (int)line.number("tile", 512), threads);
+        }
+        else if (command == "validate" && line.arguments.size() >= 2) {
+            int invalid = 0;
+            for (size_t i = 1; i < line.arguments.size(); i++) {
+                try {
+                    maze_validation result = validate_maze_file(line.arguments[i], threads);
+                    cout << line.arguments[i] << ": perfect " << result.rows << " x " << result.columns << " maze, checked in "
+                         << result.seconds << " s (" << (long long)(result.cells / max(result.seconds, 1e-9)) << " cells/s)" << endl;
+                }
+                catch (const exception & error) {
+                    cerr << error.what() << endl;
+                    invalid++;
+                }
+            }
+            return invalid == 0 ? 0 : 1;
+        }
+        else if (command == "analyze" && line.arguments.size() >= 2) {
+            ofstream file;
+            if (line.options.count("output")) {
+                file.open(line.options["output"]);
+                if (!file) {
+                    throw runtime_error("cannot write " + line.options["output"]);
+                }
+            }
+            ostream & out = line.options.count("output") ? file : cout;
+            out << maze_metrics_header() << '\n';
+            for (size_t i = 1; i < line.arguments.size(); i++) {
+                int mazeID = (int)line.argument(i);
+                maze_metrics metrics = analyze_maze_file(maze_file_name(mazeID, format), threads,
+                                                         line.number("distances", 0) != 0 ? distance_file_name(mazeID) : "");
+                out << maze_metrics_line(mazeID, metrics) << endl;
+            }
+        }
+        else if (command == "edit" && line.arguments.size() == 7) {
+            edit_maze((int)line.argument(1), (int)line.argument(2), (int)line.argument(3), (int)line.argument(4), (int)line.argument(5),
+                      line.arguments[6], (size_t)line.number("batch", 1), format, pathFormat);
+        }
+        else if (command == "serve" && line.arguments.size() == 2) {
+            maze_service_options options;
+            options.socketPath = line.arguments[1];
+            options.threads = threads;
+            options.cacheBytes = line.options.count("cache-memory") ? memory_size_from_name(line.options["cache-memory"]) : options.cacheBytes;
+            options.format = format;
+            options.persistence = persistence_mode_from_name(line.option("persist", "sync"));
+            options.seed = seed;
+            if (options.persistence == PERSIST_ASYNC) {
+                throw invalid_argument("the service persists mazes with none or sync");
+            }
+            maze_serve(options);
+        }
+        else if (command == "load" && line.arguments.size() == 7) {
+            maze_load_test(line.arguments[1], (int)line.argument(2), line.argument(3), (int)line.argument(4), (int)line.argument(5),
+                           (int)line.argument(6), seed);
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    catch (const exception & error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
 
     return 0;
 }
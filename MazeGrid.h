@@ -0,0 +1,249 @@
+//
+//  MazeGrid.h
+//
+//  Compact storage for a maze: two wall bits per cell and a separate visited bitset.
+//
+
+#ifndef MazeGrid_h
+#define MazeGrid_h
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <stdexcept>
+
+// Directions used throughout the program (same numbering as Stack::setTop)
+const int DIR_LEFT = 1;
+const int DIR_RIGHT = 2;
+const int DIR_UP = 3;
+const int DIR_DOWN = 4;
+
+// Direction that leads back to the cell we came from
+inline int opposite_direction(int direction) {
+    static const int opposite[5] = {0, DIR_RIGHT, DIR_LEFT, DIR_DOWN, DIR_UP};
+    return opposite[direction];
+}
+
+// Column and row offsets of a step in each direction (x is the column, y the row, up is y+1)
+const int DIR_DX[5] = {0, -1, 1, 0, 0};
+const int DIR_DY[5] = {0, 0, 0, 1, -1};
+
+// Number of set bits of a word: the popcnt instruction where the build targets it, a few
+// shifts and masks otherwise (still faster than the library call the builtin becomes)
+inline int count_bits(uint64_t x) {
+#if defined(__GNUC__) && defined(__POPCNT__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Index of the lowest set bit of a non-zero word
+inline int lowest_bit(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int index = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// Refuse the size of a maze to generate unless it has at least one row and one column
+inline void check_maze_size(int rows, int columns) {
+    if (rows < 1 || columns < 1) {
+        throw std::invalid_argument("a maze needs at least one row and one column, not " + std::to_string(rows) + " x " +
+                                    std::to_string(columns));
+    }
+}
+
+// Walls of a rows x columns maze, bit packed.
+// Neighbouring cells share their walls, so each cell only stores two of them: the wall on its
+// right and the wall above it. The left wall of a cell is the right wall of its left neighbour
+// and the wall below it is the up wall of the cell underneath; the outer border is always closed.
+// A set bit means the wall is there.
+//
+// Every row starts on a 64-bit word boundary and is stored as its right-wall words followed by
+// its up-wall words, so a whole row of walls can be handled with word operations and threads
+// working on different rows or 64-column blocks never share a word.
+class MazeGrid
+{
+public:
+    //Constructor for an empty 0 x 0 maze
+    MazeGrid() : rowCount(0), columnCount(0), stride(0), words(NULL) {}
+
+    // Constructor for a maze where every wall is still standing
+    MazeGrid(int rows, int columns)
+        : rowCount(rows), columnCount(columns), stride(wordsPerRowFor(columns)),
+          storage((size_t)rows * 2 * stride, ~(uint64_t)0), words(storage.data()) {}
+
+    // Constructor for a grid that works on wall words owned by someone else (for example a
+    // memory-mapped maze file); the memory must hold rows * 2 * wordsPerRowFor(columns) words
+    // and outlive the grid
+    MazeGrid(int rows, int columns, uint64_t * externalWords)
+        : rowCount(rows), columnCount(columns), stride(wordsPerRowFor(columns)), words(externalWords) {}
+
+    //Copy constructor, the copy always owns its walls
+    MazeGrid(const MazeGrid & other)
+        : rowCount(other.rowCount), columnCount(other.columnCount), stride(other.stride),
+          storage(other.words, other.words + other.wordCount()), words(storage.data()) {}
+
+    //Move constructor
+    MazeGrid(MazeGrid && other)
+        : rowCount(other.rowCount), columnCount(other.columnCount), stride(other.stride),
+          storage(std::move(other.storage)), words(other.words) {
+        other.rowCount = other.columnCount = 0;
+        other.stride = 0;
+        other.words = NULL;
+    }
+
+    MazeGrid & operator=(MazeGrid other) {
+        swap(other);
+        return *this;
+    }
+
+    // Number of 64-bit words in one wall plane of a row with the given number of columns
+    static size_t wordsPerRowFor(int columns) { return ((size_t)columns + 63) / 64; }
+
+    int rows() const { return rowCount; }
+    int columns() const { return columnCount; }
+    long long cellCount() const { return (long long)rowCount * columnCount; }
+
+    // Number of 64-bit words in one wall plane of a row
+    size_t wordsPerRow() const { return stride; }
+
+    // Whole wall storage, rows * 2 * wordsPerRow() words
+    uint64_t * data() { return words; }
+    const uint64_t * data() const { return words; }
+    size_t wordCount() const { return (size_t)rowCount * 2 * stride; }
+
+    // Right-wall and up-wall planes of row y, bit x % 64 of word x / 64 belongs to column x
+    uint64_t * rightWalls(int y) { return words + (size_t)y * 2 * stride; }
+    const uint64_t * rightWalls(int y) const { return words + (size_t)y * 2 * stride; }
+    uint64_t * upWalls(int y) { return words + ((size_t)y * 2 + 1) * stride; }
+    const uint64_t * upWalls(int y) const { return words + ((size_t)y * 2 + 1) * stride; }
+
+    // Check if cell (x, y) is inside the maze
+    bool contains(int x, int y) const {
+        return x >= 0 && x < columnCount && y >= 0 && y < rowCount;
+    }
+
+    // Check if there is a wall on the given side of cell (x, y)
+    bool hasWall(int x, int y, int direction) const
+    {
+        if (direction == DIR_LEFT) {
+            return x == 0 || bit(rightWalls(y), x - 1);
+        }
+        else if (direction == DIR_RIGHT) {
+            return x == columnCount - 1 || bit(rightWalls(y), x);
+        }
+        else if (direction == DIR_UP) {
+            return y == rowCount - 1 || bit(upWalls(y), x);
+        }
+        return y == 0 || bit(upWalls(y - 1), x);
+    }
+
+    // Knock down the wall on the given side of cell (x, y); it is gone for the neighbour as well.
+    // Border walls stay closed.
+    void removeWall(int x, int y, int direction) {
+        setWall(x, y, direction, false);
+    }
+
+    // Put the wall on the given side of cell (x, y) back
+    void addWall(int x, int y, int direction) {
+        setWall(x, y, direction, true);
+    }
+
+    void setWall(int x, int y, int direction, bool present)
+    {
+        if (direction == DIR_LEFT) {
+            if (x > 0) assign(rightWalls(y), x - 1, present);
+        }
+        else if (direction == DIR_RIGHT) {
+            if (x < columnCount - 1) assign(rightWalls(y), x, present);
+        }
+        else if (direction == DIR_UP) {
+            if (y < rowCount - 1) assign(upWalls(y), x, present);
+        }
+        else if (y > 0) {
+            assign(upWalls(y - 1), x, present);
+        }
+    }
+
+    // Put every wall back
+    void reset() {
+        std::fill(words, words + wordCount(), ~(uint64_t)0);
+    }
+
+    void swap(MazeGrid & other) {
+        std::swap(rowCount, other.rowCount);
+        std::swap(columnCount, other.columnCount);
+        std::swap(stride, other.stride);
+        storage.swap(other.storage);
+        std::swap(words, other.words);
+    }
+
+private:
+    static bool bit(const uint64_t * words, int x) {
+        return (words[x >> 6] >> (x & 63)) & 1;
+    }
+
+    static void assign(uint64_t * words, int x, bool value) {
+        uint64_t mask = (uint64_t)1 << (x & 63);
+        if (value) words[x >> 6] |= mask;
+        else words[x >> 6] &= ~mask;
+    }
+
+    int rowCount, columnCount;
+    size_t stride;
+    // Owned wall words (empty for a grid over external memory) and the words actually used
+    std::vector<uint64_t> storage;
+    uint64_t *words;
+};
+
+// One bit per cell of a rows x columns maze, laid out row by row like the wall planes of MazeGrid.
+// Used for the visited state of generation and search so it does not live inside the maze itself.
+class CellBitset
+{
+public:
+    CellBitset() : stride(0) {}
+
+    CellBitset(int rows, int columns)
+        : stride(((size_t)columns + 63) / 64), bits((size_t)rows * stride, 0) {}
+
+    bool test(int x, int y) const {
+        return (bits[(size_t)y * stride + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    void set(int x, int y) {
+        bits[(size_t)y * stride + (x >> 6)] |= (uint64_t)1 << (x & 63);
+    }
+
+    void reset(int x, int y) {
+        bits[(size_t)y * stride + (x >> 6)] &= ~((uint64_t)1 << (x & 63));
+    }
+
+    // Clear every bit
+    void clear() {
+        std::fill(bits.begin(), bits.end(), 0);
+    }
+
+    // Words of row y
+    uint64_t * row(int y) { return bits.data() + (size_t)y * stride; }
+    const uint64_t * row(int y) const { return bits.data() + (size_t)y * stride; }
+    size_t wordsPerRow() const { return stride; }
+
+private:
+    size_t stride;
+    std::vector<uint64_t> bits;
+};
+
+#endif /* MazeGrid_h */
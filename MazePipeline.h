@@ -0,0 +1,234 @@
+//
+//  MazePipeline.h
+//
+//  Generate a maze and find a path in it straight away, without writing the maze out and
+//  reading it back in between. Writing the files is optional and can run on a background thread.
+//
+
+#ifndef MazePipeline_h
+#define MazePipeline_h
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <fstream>
+#include <cstdint>
+#include <utility>
+#include "Stack.h"
+#include "MazeGrid.h"
+#include "MazeFile.h"
+#include "MazeRandom.h"
+#include "MazeGeneration.h"
+#include "MazeSolver.h"
+#include "MazeFloodSolver.h"
+#include "MazeStats.h"
+
+// What happens to the maze and path files of the pipeline
+enum persistence_mode { PERSIST_NONE, PERSIST_SYNC, PERSIST_ASYNC };
+
+// Persistence mode from its command line name (none, sync, async)
+inline persistence_mode persistence_mode_from_name(const std::string & name) {
+    if (name == "none") return PERSIST_NONE;
+    if (name == "sync") return PERSIST_SYNC;
+    if (name == "async") return PERSIST_ASYNC;
+    throw std::invalid_argument("unknown persistence " + name + " (none, sync or async)");
+}
+
+// One maze and its path, ready to be written out
+struct maze_output {
+    MazeGrid maze;
+    int mazeID;
+    uint64_t seed;
+    uint32_t algorithm;
+    bool reached;
+    Stack<unsigned char> moves;
+    int x_entry, y_entry, x_exit, y_exit;
+    path_file_format pathFormat;
+
+    maze_output(): mazeID(), seed(), algorithm(MAZE_ALGORITHM_BACKTRACKER), reached(), x_entry(), y_entry(), x_exit(), y_exit(), pathFormat(PATH_FORMAT_TEXT) {}
+};
+
+// Write maze_<mazeID> and its path file (empty when there is no path)
+inline void write_maze_output(maze_output & output, maze_file_format format) {
+    writing_output_file(output.maze, output.mazeID, format, output.seed, output.algorithm);
+    write_path_result(output.reached, output.moves, output.mazeID, output.x_entry, output.y_entry, output.x_exit, output.y_exit,
+                      output.pathFormat);
+}
+
+// Writes maze outputs on a background thread, in the order they were submitted.
+// At most maxPending outputs wait at a time; submit blocks beyond that, so a slow disk holds
+// the generator back instead of letting finished mazes pile up in memory. The first write
+// error stops the writer for good: every later submit and finish rethrows it, so no output is
+// queued once nothing is left to write it.
+class AsyncMazeWriter
+{
+public:
+    AsyncMazeWriter(maze_file_format fileFormat, size_t maxPendingOutputs = 8)
+        : format(fileFormat), maxPending(maxPendingOutputs == 0 ? 1 : maxPendingOutputs), stopping(false), failed(false),
+          writer(&AsyncMazeWriter::run, this)
+    {
+    }
+
+    ~AsyncMazeWriter() {
+        try {
+            finish();
+        }
+        catch (...) {
+            // Errors are reported by finish; a destructor cannot throw
+        }
+    }
+
+    AsyncMazeWriter(const AsyncMazeWriter &) = delete;
+    AsyncMazeWriter & operator=(const AsyncMazeWriter &) = delete;
+
+    // Queue an output for writing (it is moved from)
+    void submit(maze_output & output)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        spaceAvailable.wait(guard, [this] { return pending.size() < maxPending || failed; });
+        if (failed) {
+            rethrow(guard);
+        }
+        pending.push_back(std::move(output));
+        workAvailable.notify_one();
+    }
+
+    // Wait until everything submitted is written and stop the thread
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        workAvailable.notify_one();
+        if (writer.joinable()) {
+            writer.join();
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        if (failed) {
+            rethrow(guard);
+        }
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            workAvailable.wait(guard, [this] { return !pending.empty() || stopping; });
+            if (pending.empty()) {
+                return;
+            }
+            maze_output output = std::move(pending.front());
+            pending.pop_front();
+            spaceAvailable.notify_all();
+
+            guard.unlock();
+            try {
+                write_maze_output(output, format);
+            }
+            catch (...) {
+                guard.lock();
+                error = std::current_exception();
+                failed = true;
+                pending.clear();
+                spaceAvailable.notify_all();
+                return;
+            }
+            guard.lock();
+        }
+    }
+
+    // Hand the stored error to the caller; it stays stored for the next one
+    void rethrow(std::unique_lock<std::mutex> & guard)
+    {
+        std::exception_ptr stored = error;
+        guard.unlock();
+        std::rethrow_exception(stored);
+    }
+
+    maze_file_format format;
+    size_t maxPending;
+    bool stopping;
+    // Set once a write has failed, never cleared
+    bool failed;
+    std::exception_ptr error;
+    std::deque<maze_output> pending;
+    std::mutex lock;
+    std::condition_variable workAvailable;
+    std::condition_variable spaceAvailable;
+    std::thread writer;
+};
+
+// Generate maze mazeID with the given algorithm and find a path from the entry to the exit with
+// the given solver, all in memory. The maze comes from the same stream as maze_generator, maze_seed(globalSeed, mazeID),
+// so the files written here are the ones the generate-then-solve flow would write.
+// With PERSIST_ASYNC the files go to writer, with PERSIST_SYNC they are written before returning.
+// A "generate" and a "solve" record go to the statistics log, the time of synchronous writes of
+// both files in the solve record. Returns the number of steps of the path, or -1 when there is none.
+inline long long generate_and_solve(int rows, int columns, int mazeID, int x_entry, int y_entry, int x_exit, int y_exit,
+                                    solver_mode mode, uint64_t globalSeed, persistence_mode persistence,
+                                    maze_file_format format, AsyncMazeWriter * writer,
+                                    path_file_format pathFormat = PATH_FORMAT_TEXT,
+                                    uint32_t algorithm = MAZE_ALGORITHM_BACKTRACKER)
+{
+    maze_output output;
+    output.pathFormat = pathFormat;
+    output.algorithm = algorithm;
+    output.mazeID = mazeID;
+    output.seed = maze_seed(globalSeed, mazeID);
+    output.x_entry = x_entry;
+    output.y_entry = y_entry;
+    output.x_exit = x_exit;
+    output.y_exit = y_exit;
+
+    if (mode == SOLVER_EXTERNAL) {
+        throw std::invalid_argument("the external solver works on maze files, not in the pipeline");
+    }
+    check_maze_size(rows, columns);
+    reset_maze_stats();
+    MazeRandom rnd(output.seed);
+    output.maze = MazeGrid(rows, columns);
+    {
+        MAZE_STAT_TIMER(generate_seconds);
+        generate_maze_with(output.maze, algorithm, rnd);
+    }
+    MazeStatsLog::report(mazeID, "generate", rows, columns);
+
+    reset_maze_stats();
+    {
+        MAZE_STAT_TIMER(search_seconds);
+        if (mode == SOLVER_DFS) {
+            // The random walk continues on the maze's own stream, so it is repeatable too
+            output.reached = output.maze.contains(x_entry, y_entry) && output.maze.contains(x_exit, y_exit) &&
+                             random_path_search(output.maze, x_entry, y_entry, x_exit, y_exit, output.moves, rnd);
+        }
+        else if (mode == SOLVER_FLOOD) {
+            FloodSolver solver(output.maze);
+            output.reached = solver.solve(x_entry, y_entry, x_exit, y_exit, output.moves);
+        }
+        else {
+            output.reached = shortest_path_search(output.maze, mode, x_entry, y_entry, x_exit, y_exit, output.moves);
+        }
+    }
+    long long length = output.reached ? (long long)output.moves.size() : -1;
+
+    if (persistence == PERSIST_SYNC) {
+        MAZE_STAT_TIMER(write_seconds);
+        write_maze_output(output, format);
+    }
+    else if (persistence == PERSIST_ASYNC) {
+        if (writer == nullptr) {
+            throw std::invalid_argument("asynchronous persistence needs a writer");
+        }
+        writer->submit(output);
+    }
+    MazeStatsLog::report(mazeID, "solve", rows, columns);
+    return length;
+}
+
+#endif /* MazePipeline_h */
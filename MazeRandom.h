@@ -0,0 +1,147 @@
+//
+//  MazeRandom.h
+//
+//  Seedable random number generator with one independent stream per maze.
+//
+
+#ifndef MazeRandom_h
+#define MazeRandom_h
+#include <cstdint>
+#include <cstddef>
+
+// One step of SplitMix64: adds the golden-ratio increment to state and returns a well mixed value
+constexpr uint64_t splitmix64(uint64_t & state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Seed of maze mazeID in a run started with globalSeed.
+// Each maze gets its own stream, so a maze does not depend on which thread made it or on
+// how many other mazes were generated before it.
+constexpr uint64_t maze_seed(uint64_t globalSeed, long long mazeID) {
+    uint64_t state = globalSeed;
+    uint64_t mixed = splitmix64(state);
+    state = mixed ^ (uint64_t)mazeID;
+    return splitmix64(state);
+}
+
+// xoshiro256** (Blackman and Vigna): 256 bits of state, a period of 2^256 - 1, and a jump
+// function that moves the stream 2^128 steps ahead, so workers can take non-overlapping
+// parts of one stream. The state is filled from the 64-bit seed with SplitMix64, so every
+// seed (0 included) gives a valid, well mixed state.
+//
+// Directions (1 left, 2 right, 3 up, 4 down) only need two random bits each, so they are
+// cut from a buffered 64-bit word, 32 directions per generator step.
+// Everything but jump() is constexpr, so the fixed-size kernels of FixedMaze.h can draw from it
+// in constant expressions.
+class MazeRandom
+{
+public:
+    constexpr explicit MazeRandom(uint64_t seed = 0) : state(), bits(0), bitsLeft(0) {
+        uint64_t mixer = seed;
+        for (int i = 0; i < 4; i++) {
+            state[i] = splitmix64(mixer);
+        }
+    }
+
+    // Next 64 random bits
+    constexpr uint64_t next() {
+        uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+        uint64_t shifted = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotateLeft(state[3], 45);
+        return result;
+    }
+
+    // Random integer in [low, high]
+    constexpr int RandInt(int low, int high) {
+        uint64_t range = (uint64_t)((int64_t)high - low) + 1;
+        // Multiply the top 32 bits by the range and keep the high half (Lemire's method)
+        return low + (int)(((next() >> 32) * range) >> 32);
+    }
+
+    // Random integer in [0, bound) for bound of 1 to 2^32 - 1 (a cell or wall index of a large maze)
+    constexpr uint32_t below(uint32_t bound) {
+        return (uint32_t)(((next() >> 32) * bound) >> 32);
+    }
+
+    // Two random bits, 0 to 3
+    constexpr int twoBits() {
+        if (bitsLeft == 0) {
+            bits = next();
+            bitsLeft = 32;
+        }
+        int value = (int)(bits & 3);
+        bits >>= 2;
+        bitsLeft--;
+        return value;
+    }
+
+    // Random direction, 1 to 4
+    constexpr int direction() {
+        return twoBits() + 1;
+    }
+
+    // Random index in [0, count) for count of 1 to 4 (the choices a cell of the maze can have).
+    // Two bits cover 2 and 4 choices exactly; 3 choices take a multiply of 32 fresh bits.
+    constexpr int choice(int count) {
+        if (count == 4) return twoBits();
+        if (count == 2) return twoBits() & 1;
+        if (count == 1) return 0;
+        return RandInt(0, count - 1);
+    }
+
+    // Fill out[0..count) with random directions (1 to 4), 32 per generator step
+    constexpr void fillDirections(unsigned char * out, size_t count) {
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            uint64_t word = next();
+            for (int k = 0; k < 32; k++) {
+                out[i + k] = (unsigned char)((word & 3) + 1);
+                word >>= 2;
+            }
+        }
+        for (; i < count; i++) {
+            out[i] = (unsigned char)direction();
+        }
+    }
+
+    // Move the stream 2^128 steps ahead. Calling jump() k times on copies of one generator
+    // gives k streams that cannot overlap for any realistic number of draws.
+    void jump() {
+        static const uint64_t JUMP[4] = {0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+                                         0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL};
+        uint64_t jumped[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 4; i++) {
+            for (int b = 0; b < 64; b++) {
+                if (JUMP[i] & ((uint64_t)1 << b)) {
+                    for (int k = 0; k < 4; k++) {
+                        jumped[k] ^= state[k];
+                    }
+                }
+                next();
+            }
+        }
+        for (int k = 0; k < 4; k++) {
+            state[k] = jumped[k];
+        }
+        bitsLeft = 0;
+    }
+
+private:
+    static constexpr uint64_t rotateLeft(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t state[4];
+    uint64_t bits;
+    int bitsLeft;
+};
+
+#endif /* MazeRandom_h */
@@ -0,0 +1,664 @@
+//
+//  MazeService.h
+//
+//  Long-running maze service on a Unix domain socket. Mazes are generated or loaded once and
+//  kept, with their tree index, in a memory-bounded LRU cache; requests from many connections
+//  are answered by a pool of worker threads, and the latency of every request is recorded in
+//  histograms. A load generator for testing the service is at the end of the file.
+//
+//  The protocol is one text line per request and one line per answer ("ok ..." or "error ..."):
+//
+//      generate <mazeID> <rows> <columns> [seed [algorithm]]
+//      solve <mazeID> <x_entry> <y_entry> <x_exit> <y_exit> [path]
+//      evict <mazeID>
+//      stats
+//      ping
+//      shutdown
+//
+//  generate makes maze mazeID from maze_seed(seed, mazeID) as the command line does (the
+//  service's --seed when none is given), so its maze file is the one `maze batch` would write;
+//  a maze (with its index) larger than the whole cache is refused before it is made.
+//  solve answers "ok <length>" (-1 without a path), followed with path by the steps as letters
+//  L, R, U and D; a maze that is not cached is read from its file. Perfect mazes are answered
+//  from the tree index, mazes with loops (edited ones) by breadth-first search. stats answers
+//  several lines, the last one "end".
+//
+
+#ifndef MazeService_h
+#define MazeService_h
+#include <vector>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "Stack.h"
+#include "MazeGrid.h"
+#include "MazeFile.h"
+#include "MazeRandom.h"
+#include "MazeGeneration.h"
+#include "MazeTreeIndex.h"
+#include "MazeSolver.h"
+#include "MazePipeline.h"
+#include "WorkStealing.h"
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Latencies in power-of-two buckets of microseconds: bucket b counts the requests that took
+// less than 2^b microseconds (and at least 2^(b-1)). Recording is lock free.
+class LatencyHistogram
+{
+public:
+    static const int BUCKETS = 40;
+
+    LatencyHistogram() : total(0), slowest(0) {
+        for (int b = 0; b < BUCKETS; b++) {
+            counts[b] = 0;
+        }
+    }
+
+    void record(double seconds)
+    {
+        long long micros = (long long)(seconds * 1e6);
+        int bucket = 0;
+        while (bucket < BUCKETS - 1 && ((long long)1 << bucket) <= micros) {
+            bucket++;
+        }
+        counts[bucket]++;
+        total++;
+        long long previous = slowest.load();
+        while (micros > previous && !slowest.compare_exchange_weak(previous, micros)) {
+        }
+    }
+
+    long long count() const { return total.load(); }
+    long long maxMicros() const { return slowest.load(); }
+
+    // Upper bound in microseconds of the fraction q (0 to 1) of the requests
+    long long percentileMicros(double q) const
+    {
+        long long all = total.load(), seen = 0;
+        if (all == 0) {
+            return 0;
+        }
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b].load();
+            if (seen >= (long long)(q * all + 0.5) && seen > 0) {
+                return std::min((long long)1 << b, slowest.load());
+            }
+        }
+        return slowest.load();
+    }
+
+    // "count N p50 .. p90 .. p99 .. max .." in microseconds
+    std::string summary() const
+    {
+        std::ostringstream out;
+        out << "count " << count() << " p50 " << percentileMicros(0.5) << " p90 " << percentileMicros(0.9) << " p99 "
+            << percentileMicros(0.99) << " max " << maxMicros();
+        return out.str();
+    }
+
+private:
+    std::atomic<long long> counts[BUCKETS];
+    std::atomic<long long> total;
+    std::atomic<long long> slowest;
+};
+
+// A maze held by the service, with its tree index built on the first solve
+struct cached_maze {
+    MazeGrid maze;
+    uint64_t seed;
+    uint32_t algorithm;
+    std::once_flag indexBuilt;
+    std::unique_ptr<MazeTreeIndex> index;
+
+    cached_maze(): seed(), algorithm(MAZE_ALGORITHM_BACKTRACKER) {}
+
+    // Bytes charged to the cache: the walls and the index, built or not
+    size_t memoryBytes() const { return memoryFor(maze.rows(), maze.columns()); }
+
+    // The same for a maze of the given size, before it is made
+    static size_t memoryFor(int rows, int columns) {
+        return (size_t)rows * 2 * MazeGrid::wordsPerRowFor(columns) * sizeof(uint64_t) +
+               MazeTreeIndex::memoryFor((long long)rows * columns);
+    }
+
+    const MazeTreeIndex & treeIndex() {
+        std::call_once(indexBuilt, [this] { index.reset(new MazeTreeIndex(maze)); });
+        return *index;
+    }
+};
+
+// Mazes by ID, least recently used first out once their bytes go over the limit. Entries are
+// shared, so a maze evicted while a request still works on it lives until that request ends.
+class MazeCache
+{
+public:
+    explicit MazeCache(size_t memoryLimit) : limit(memoryLimit), used(0), hits(0), misses(0), evictions(0) {}
+
+    // The maze, marked as the most recently used, or null when it is not cached
+    std::shared_ptr<cached_maze> find(int mazeID)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::unordered_map<int, entry_list::iterator>::iterator it = entries.find(mazeID);
+        if (it == entries.end()) {
+            misses++;
+            return std::shared_ptr<cached_maze>();
+        }
+        hits++;
+        order.splice(order.begin(), order, it->second);
+        return it->second->second;
+    }
+
+    // Cache a maze (replacing one with the same ID) and evict down to the limit. A maze larger
+    // than the whole limit is not kept.
+    void insert(int mazeID, const std::shared_ptr<cached_maze> & maze)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        removeLocked(mazeID);
+        size_t bytes = maze->memoryBytes();
+        if (bytes > limit) {
+            return;
+        }
+        order.push_front(std::make_pair(mazeID, maze));
+        entries[mazeID] = order.begin();
+        used += bytes;
+        while (used > limit) {
+            removeLocked(order.back().first);
+            evictions++;
+        }
+    }
+
+    size_t memoryLimit() const { return limit; }
+
+    bool erase(int mazeID)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return removeLocked(mazeID);
+    }
+
+    // "mazes N bytes N limit N hits N misses N evictions N"
+    std::string summary()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::ostringstream out;
+        out << "mazes " << entries.size() << " bytes " << used << " limit " << limit << " hits " << hits << " misses "
+            << misses << " evictions " << evictions;
+        return out.str();
+    }
+
+private:
+    typedef std::list<std::pair<int, std::shared_ptr<cached_maze> > > entry_list;
+
+    bool removeLocked(int mazeID)
+    {
+        std::unordered_map<int, entry_list::iterator>::iterator it = entries.find(mazeID);
+        if (it == entries.end()) {
+            return false;
+        }
+        used -= it->second->second->memoryBytes();
+        order.erase(it->second);
+        entries.erase(it);
+        return true;
+    }
+
+    std::mutex lock;
+    entry_list order;
+    std::unordered_map<int, entry_list::iterator> entries;
+    size_t limit;
+    size_t used;
+    long long hits, misses, evictions;
+};
+
+// Settings of a service
+struct maze_service_options {
+    std::string socketPath;
+    int threads;                    // Workers, each serving one connection at a time; 0 for twice the hardware threads (at least 4)
+    size_t cacheBytes;              // Memory for cached mazes and their indexes
+    maze_file_format format;        // Format of the maze files read and written
+    persistence_mode persistence;   // PERSIST_SYNC writes the file of every generated maze, PERSIST_NONE does not
+    uint64_t seed;                  // Global seed of generate requests without one
+
+    maze_service_options(): threads(0), cacheBytes((size_t)512 << 20), format(MAZE_FORMAT_TEXT), persistence(PERSIST_SYNC), seed(0) {}
+};
+
+#if !defined(_WIN32)
+
+// Letter of each step direction in a solve answer
+const char MAZE_STEP_LETTERS[5] = {'?', 'L', 'R', 'U', 'D'};
+
+// Line-based reading and writing on a connected socket
+class SocketLines
+{
+public:
+    explicit SocketLines(int socketFd) : fd(socketFd), start(0) {}
+
+    // Next line without its newline; false at the end of the stream
+    bool readLine(std::string & line)
+    {
+        while (true) {
+            size_t end = buffer.find('\n', start);
+            if (end != std::string::npos) {
+                line.assign(buffer, start, end - start);
+                start = end + 1;
+                return true;
+            }
+            buffer.erase(0, start);
+            start = 0;
+            char chunk[4096];
+            ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) return false;
+            buffer.append(chunk, (size_t)count);
+        }
+    }
+
+    // Send text in full; false when the other end has gone
+    bool write(const std::string & text)
+    {
+        size_t done = 0;
+        while (done < text.size()) {
+            ssize_t count = send(fd, text.data() + done, text.size() - done, MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) return false;
+            done += (size_t)count;
+        }
+        return true;
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    size_t start;
+};
+
+// Address of a socket path, checked against the length sockaddr_un allows
+inline sockaddr_un maze_socket_address(const std::string & path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("socket path must be 1 to " + std::to_string(sizeof(address.sun_path) - 1) + " characters");
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+// The service. run() listens until a shutdown request; each accepted connection goes to a
+// worker, which answers its requests in order until the client closes it. Connections beyond
+// the number of workers wait in a queue.
+class MazeService
+{
+public:
+    explicit MazeService(const maze_service_options & serviceOptions)
+        : options(serviceOptions), cache(serviceOptions.cacheBytes), listenFd(-1), stopping(false)
+    {
+    }
+
+    ~MazeService() {
+        if (listenFd >= 0) {
+            close(listenFd);
+            unlink(options.socketPath.c_str());
+        }
+    }
+
+    MazeService(const MazeService &) = delete;
+    MazeService & operator=(const MazeService &) = delete;
+
+    void run()
+    {
+        sockaddr_un address = maze_socket_address(options.socketPath);
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            throw std::runtime_error("cannot create a socket");
+        }
+        // A socket file left by a service that did not shut down cleanly would block bind
+        unlink(options.socketPath.c_str());
+        if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listenFd, 128) != 0) {
+            throw std::runtime_error("cannot listen on " + options.socketPath);
+        }
+
+        std::vector<std::thread> workers;
+        // A worker holds its connection between requests, so there are more workers than cores
+        int threads = options.threads > 0 ? options.threads : std::max(4, 2 * default_thread_count(0));
+        for (int t = 0; t < threads; t++) {
+            workers.push_back(std::thread(&MazeService::work, this));
+        }
+        while (!stopping.load()) {
+            pollfd waiting = {listenFd, POLLIN, 0};
+            if (poll(&waiting, 1, 100) <= 0) {
+                continue;
+            }
+            int connection = accept(listenFd, NULL, NULL);
+            if (connection < 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            connections.push_back(connection);
+            connectionReady.notify_one();
+        }
+        {
+            // Wake the workers, including those waiting for a request on an idle connection
+            std::lock_guard<std::mutex> guard(lock);
+            for (size_t c = 0; c < active.size(); c++) {
+                ::shutdown(active[c], SHUT_RDWR);
+            }
+            for (size_t c = 0; c < connections.size(); c++) {
+                close(connections[c]);
+            }
+            connections.clear();
+            connectionReady.notify_all();
+        }
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+    }
+
+    // Answer one request line; a stats answer has several lines, the last one "end"
+    std::string handle(const std::string & line)
+    {
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::string answer;
+        LatencyHistogram * histogram = &otherLatency;
+        try {
+            if (command == "generate") {
+                histogram = &generateLatency;
+                answer = generate(in);
+            }
+            else if (command == "solve") {
+                histogram = &solveLatency;
+                answer = solve(in);
+            }
+            else if (command == "evict") {
+                int mazeID = 0;
+                if (!(in >> mazeID)) throw std::invalid_argument("usage: evict <mazeID>");
+                answer = cache.erase(mazeID) ? "ok" : "ok not cached";
+            }
+            else if (command == "stats") {
+                answer = "ok\ngenerate " + generateLatency.summary() + "\nsolve " + solveLatency.summary() + "\nother " +
+                         otherLatency.summary() + "\ncache " + cache.summary() + "\nend";
+            }
+            else if (command == "ping") {
+                answer = "ok";
+            }
+            else if (command == "shutdown") {
+                stopping = true;
+                answer = "ok";
+            }
+            else {
+                throw std::invalid_argument("unknown request " + command);
+            }
+        }
+        catch (const std::exception & error) {
+            answer = std::string("error ") + error.what();
+        }
+        histogram->record(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        return answer;
+    }
+
+private:
+    std::string generate(std::istringstream & in)
+    {
+        int mazeID = 0, rows = 0, columns = 0;
+        if (!(in >> mazeID >> rows >> columns)) {
+            throw std::invalid_argument("usage: generate <mazeID> <rows> <columns> [seed [algorithm]]");
+        }
+        check_maze_size(rows, columns);
+        // A maze the cache could not keep is refused before its memory is taken
+        size_t bytes = cached_maze::memoryFor(rows, columns);
+        if (bytes > cache.memoryLimit()) {
+            throw std::invalid_argument("a " + std::to_string(rows) + " x " + std::to_string(columns) + " maze needs " +
+                                        std::to_string(bytes) + " bytes, more than the cache limit of " +
+                                        std::to_string(cache.memoryLimit()));
+        }
+        uint64_t globalSeed = options.seed;
+        std::string algorithmName = "backtracker";
+        std::string seedText, extra;
+        if (in >> seedText) {
+            size_t parsed = 0;
+            try {
+                globalSeed = std::stoull(seedText, &parsed);
+            }
+            catch (const std::exception &) {
+                parsed = 0;
+            }
+            if (parsed != seedText.size() || seedText[0] == '-') {
+                throw std::invalid_argument("the seed must be a number, not " + seedText);
+            }
+            in >> algorithmName;
+            if (in >> extra) {
+                throw std::invalid_argument("unexpected " + extra + " after the algorithm");
+            }
+        }
+        std::shared_ptr<cached_maze> entry(new cached_maze());
+        entry->algorithm = maze_algorithm_from_name(algorithmName);
+        entry->seed = maze_seed(globalSeed, mazeID);
+        entry->maze = MazeGrid(rows, columns);
+        MazeRandom rnd(entry->seed);
+        generate_maze_with(entry->maze, entry->algorithm, rnd);
+        if (options.persistence == PERSIST_SYNC) {
+            writing_output_file(entry->maze, mazeID, options.format, entry->seed, entry->algorithm);
+        }
+        cache.insert(mazeID, entry);
+        return "ok " + std::to_string(mazeID) + " " + std::to_string(rows) + " " + std::to_string(columns);
+    }
+
+    std::string solve(std::istringstream & in)
+    {
+        int mazeID = 0, x_entry = 0, y_entry = 0, x_exit = 0, y_exit = 0;
+        if (!(in >> mazeID >> x_entry >> y_entry >> x_exit >> y_exit)) {
+            throw std::invalid_argument("usage: solve <mazeID> <x_entry> <y_entry> <x_exit> <y_exit> [path]");
+        }
+        std::string withPath;
+        in >> withPath;
+
+        std::shared_ptr<cached_maze> entry = cache.find(mazeID);
+        if (!entry) {
+            entry.reset(new cached_maze());
+            MazeFile file(maze_file_name(mazeID, options.format));
+            entry->maze = file.grid();
+            entry->seed = file.seed();
+            entry->algorithm = file.algorithm();
+            cache.insert(mazeID, entry);
+        }
+        const MazeTreeIndex & index = entry->treeIndex();
+        Stack<unsigned char> moves;
+        if (!index.isPerfect()) {
+            // With loops the tree path may not be the shortest one, so search the maze itself
+            if (!shortest_path_search(entry->maze, SOLVER_BFS, x_entry, y_entry, x_exit, y_exit, moves)) {
+                return "ok -1";
+            }
+            if (withPath != "path") {
+                return "ok " + std::to_string(moves.size());
+            }
+        }
+        else if (withPath != "path") {
+            return "ok " + std::to_string(index.pathLength(x_entry, y_entry, x_exit, y_exit));
+        }
+        else if (!index.path(x_entry, y_entry, x_exit, y_exit, moves)) {
+            return "ok -1";
+        }
+        std::string letters(moves.size(), ' ');
+        for (size_t i = letters.size(); i > 0; i--) {
+            letters[i - 1] = MAZE_STEP_LETTERS[moves.top()];
+            moves.pop();
+        }
+        return "ok " + std::to_string(letters.size()) + " " + letters;
+    }
+
+    // Worker: serve one connection at a time until the service stops
+    void work()
+    {
+        while (true) {
+            int connection;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                connectionReady.wait(guard, [this] { return !connections.empty() || stopping.load(); });
+                if (connections.empty()) {
+                    return;
+                }
+                connection = connections.front();
+                connections.pop_front();
+                active.push_back(connection);
+            }
+            SocketLines lines(connection);
+            std::string line;
+            while (lines.readLine(line)) {
+                if (!lines.write(handle(line) + "\n")) {
+                    break;
+                }
+                if (stopping.load()) {
+                    break;
+                }
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            active.erase(std::find(active.begin(), active.end(), connection));
+            close(connection);
+        }
+    }
+
+    maze_service_options options;
+    MazeCache cache;
+    LatencyHistogram generateLatency, solveLatency, otherLatency;
+    int listenFd;
+    std::atomic<bool> stopping;
+    std::mutex lock;
+    std::condition_variable connectionReady;
+    std::deque<int> connections;    // Accepted, waiting for a worker
+    std::vector<int> active;        // Being served
+};
+
+// Client side of the protocol: one connection, one request at a time
+class MazeClient
+{
+public:
+    explicit MazeClient(const std::string & socketPath) : fd(socket(AF_UNIX, SOCK_STREAM, 0)), lines(fd)
+    {
+        sockaddr_un address = maze_socket_address(socketPath);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            if (fd >= 0) close(fd);
+            throw std::runtime_error("cannot connect to " + socketPath);
+        }
+    }
+
+    ~MazeClient() { close(fd); }
+
+    MazeClient(const MazeClient &) = delete;
+    MazeClient & operator=(const MazeClient &) = delete;
+
+    // Send a request and return the first line of its answer
+    std::string request(const std::string & line)
+    {
+        std::string answer;
+        if (!lines.write(line + "\n") || !lines.readLine(answer)) {
+            throw std::runtime_error("the service closed the connection");
+        }
+        return answer;
+    }
+
+    // The remaining lines of a multi-line answer, up to "end"
+    std::string rest()
+    {
+        std::string text, line;
+        while (lines.readLine(line) && line != "end") {
+            text += line + "\n";
+        }
+        return text;
+    }
+
+private:
+    int fd;
+    SocketLines lines;
+};
+
+// Load generator: generate mazes 1..mazeCount of rows x columns, then send requestCount solve
+// requests between random cells of random mazes over the given number of connections at once,
+// and print the throughput, the latencies seen by the clients and the service's own stats.
+inline void maze_load_test(const std::string & socketPath, int connections, long long requestCount, int mazeCount,
+                           int rows, int columns, uint64_t seed)
+{
+    if (connections < 1 || mazeCount < 1 || rows < 1 || columns < 1) {
+        throw std::invalid_argument("the load test needs at least one connection and one maze");
+    }
+    {
+        MazeClient client(socketPath);
+        for (int mazeID = 1; mazeID <= mazeCount; mazeID++) {
+            std::string answer = client.request("generate " + std::to_string(mazeID) + " " + std::to_string(rows) + " " +
+                                                std::to_string(columns) + " " + std::to_string(seed));
+            if (answer.compare(0, 2, "ok") != 0) {
+                throw std::runtime_error("generate " + std::to_string(mazeID) + ": " + answer);
+            }
+        }
+    }
+
+    LatencyHistogram latency;
+    std::atomic<long long> failures(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    parallel_for_stealing((size_t)connections, connections, [&](size_t c) {
+        MazeClient client(socketPath);
+        MazeRandom rnd(maze_seed(seed, -1 - (long long)c));
+        long long share = requestCount * (long long)(c + 1) / connections - requestCount * (long long)c / connections;
+        for (long long i = 0; i < share; i++) {
+            std::string line = "solve " + std::to_string(rnd.RandInt(1, mazeCount)) + " " +
+                               std::to_string(rnd.RandInt(0, columns - 1)) + " " + std::to_string(rnd.RandInt(0, rows - 1)) + " " +
+                               std::to_string(rnd.RandInt(0, columns - 1)) + " " + std::to_string(rnd.RandInt(0, rows - 1));
+            std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+            std::string answer = client.request(line);
+            latency.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - sent).count());
+            if (answer.compare(0, 2, "ok") != 0) {
+                failures++;
+            }
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << requestCount << " solve requests over " << connections << " connections in " << std::fixed
+              << std::setprecision(3) << seconds << " s: " << std::setprecision(0) << requestCount / seconds
+              << " requests/s, " << failures.load() << " failed" << std::endl;
+    std::cout << "client latency (us): " << latency.summary() << std::endl;
+    MazeClient client(socketPath);
+    client.request("stats");
+    std::cout << "service stats (us):" << std::endl << client.rest();
+}
+
+// Run a service until it is asked to shut down
+inline void maze_serve(const maze_service_options & options) {
+    MazeService service(options);
+    service.run();
+}
+
+#else
+
+inline void maze_serve(const maze_service_options &) {
+    throw std::runtime_error("the maze service needs Unix domain sockets");
+}
+
+inline void maze_load_test(const std::string &, int, long long, int, int, int, uint64_t) {
+    throw std::runtime_error("the maze service needs Unix domain sockets");
+}
+
+#endif
+
+#endif /* MazeService_h */
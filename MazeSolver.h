@@ -0,0 +1,490 @@
+//
+//  MazeSolver.h
+//
+//  Finding a path from an entry to an exit: the randomized backtracking search of
+//  path_discovery and the shortest-path modes (BFS, bidirectional BFS and A*). The bit-parallel
+//  flood fill (SOLVER_FLOOD) is in MazeFloodSolver.h, and its out-of-core form for maze files
+//  larger than memory (SOLVER_EXTERNAL) in MazeExternalSolver.h.
+//
+
+#ifndef MazeSolver_h
+#define MazeSolver_h
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include "Stack.h"
+#include "MazeGrid.h"
+#include "MazeStats.h"
+#include "MazeRandom.h"
+#include "FixedMaze.h"
+
+// Ways of searching for the path
+enum solver_mode { SOLVER_DFS, SOLVER_BFS, SOLVER_BIDIRECTIONAL, SOLVER_ASTAR, SOLVER_FLOOD, SOLVER_EXTERNAL };
+
+// Solver mode from its command line name (dfs, bfs, bidirectional, astar, flood, external)
+inline solver_mode solver_mode_from_name(const std::string & name) {
+    if (name == "dfs") return SOLVER_DFS;
+    if (name == "bfs") return SOLVER_BFS;
+    if (name == "bidirectional") return SOLVER_BIDIRECTIONAL;
+    if (name == "astar") return SOLVER_ASTAR;
+    if (name == "flood") return SOLVER_FLOOD;
+    if (name == "external") return SOLVER_EXTERNAL;
+    throw std::invalid_argument("unknown solver " + name + " (dfs, bfs, bidirectional, astar, flood or external)");
+}
+
+// Check if a cell is within the maze boundaries
+inline bool is_in_boundaries(int x, int y, int rows, int columns) {
+    bool check;
+    check= (x >= 0 && x < columns && y >= 0 && y < rows);
+    return check;
+}
+
+
+
+// Check if a cell is unvisited (cells outside the maze count as visited)
+inline bool unvisited_check(const CellBitset & visited, int x, int y, int rows, int columns) {
+    bool check =true;
+    // Check if x and y are within valid bounds
+    if (is_in_boundaries(x, y, rows, columns)) {
+        check = visited.test(x, y);
+        return check;
+    }
+    return check;
+
+}
+
+// Check if the current cell is a dead end, considering if there are walls in each direction
+inline bool isdeadEnd(const MazeGrid & maze, const CellBitset & visited, int x, int y, bool path) {
+    MAZE_STAT_ADD(deadend_checks, 1);
+
+    // Check all four directions (up, down, right, left) if they are visited or not and if they are in boundaries
+    int rows = maze.rows(), columns = maze.columns();
+    bool isUpVisited = unvisited_check(visited, x, y + 1, rows, columns);
+    bool isDownVisited = unvisited_check(visited, x, y - 1, rows, columns);
+    bool isRightVisited = unvisited_check(visited, x + 1, y, rows, columns);
+    bool isLeftVisited = unvisited_check(visited, x - 1, y, rows, columns);
+
+    bool check = isUpVisited && isDownVisited && isRightVisited && isLeftVisited;
+
+    // If 'path' is true, consider walls
+    if(path) {
+        check = (isLeftVisited || maze.hasWall(x, y, DIR_LEFT)) && (isRightVisited || maze.hasWall(x, y, DIR_RIGHT)) &&
+                (isUpVisited || maze.hasWall(x, y, DIR_UP)) && (isDownVisited || maze.hasWall(x, y, DIR_DOWN));
+    }
+    return check;
+
+}
+
+// Randomized backtracking search used by path_discovery: from the current cell a random
+// direction is drawn until it leads to an open, unvisited neighbour, and dead ends are popped.
+// On success stack_for_solving holds the direction of every step from the entry (last step on top).
+// Directions are drawn 64 at a time into a small buffer.
+inline bool generic_random_path_search(const MazeGrid & maze, int x_entry, int y_entry, int x_exit, int y_exit,
+                               Stack<unsigned char> & stack_for_solving, MazeRandom & rnd) {
+
+    int row = maze.rows(), column = maze.columns();
+    CellBitset visited(row, column);
+    bool deadEnd;
+    unsigned char directions[64];
+    int next_direction = 64;
+
+    // Mark the entry cell as visited and start walking from it
+    int x = x_entry, y = y_entry;
+    visited.set(x, y);
+
+    while(true){
+        // Exit condition: The exit cell has been reached
+        if(x==x_exit && y==y_exit) {
+            return true;
+        }
+        // Check if the current cell is a dead end
+        deadEnd = isdeadEnd(maze, visited, x, y, true);
+        if(!deadEnd) {
+            // Take the next random direction (1 left, 2 right, 3 up, 4 down)
+            if(next_direction == 64) {
+                rnd.fillDirections(directions, 64);
+                next_direction = 0;
+            }
+            int way_of_the_cell = directions[next_direction++];
+            MAZE_STAT_ADD(rng_draws, 1);
+            int next_x = x + DIR_DX[way_of_the_cell];
+            int next_y = y + DIR_DY[way_of_the_cell];
+
+            //Check if the cell is visited or not, in boundaries and not behind a wall
+            if(!unvisited_check(visited, next_x, next_y, row, column) && !maze.hasWall(x, y, way_of_the_cell)) {
+                visited.set(next_x, next_y);
+                stack_for_solving.push((unsigned char)way_of_the_cell);
+                MAZE_STAT_MAX(peak_stack_depth, stack_for_solving.size());
+                x = next_x;
+                y = next_y;
+            }
+            else {
+                MAZE_STAT_ADD(rejected_draws, 1);
+            }
+        }
+        else if(stack_for_solving.isEmpty()) {
+            // Back at the entry with nowhere left to go: there is no path
+            return false;
+        }
+        else {
+            // The current cell is a dead end, backtrack by popping its step from stack_for_solving
+            int way_back = opposite_direction(stack_for_solving.top());
+            stack_for_solving.pop();
+            MAZE_STAT_ADD(backtrack_pops, 1);
+            x += DIR_DX[way_back];
+            y += DIR_DY[way_back];
+        }
+    }
+}
+
+// Randomized backtracking search of path_discovery. Mazes with a fixed-size kernel (FixedMaze.h)
+// take it, everything else the generic search; both give the same path for the same stream.
+inline bool random_path_search(const MazeGrid & maze, int x_entry, int y_entry, int x_exit, int y_exit,
+                               Stack<unsigned char> & stack_for_solving, MazeRandom & rnd) {
+    bool reached = false;
+    if (fixed_random_path_search(maze, x_entry, y_entry, x_exit, y_exit, stack_for_solving, rnd, reached)) {
+        return reached;
+    }
+    return generic_random_path_search(maze, x_entry, y_entry, x_exit, y_exit, stack_for_solving, rnd);
+}
+
+
+// Shortest-path searches over a MazeGrid.
+// All working memory is allocated once per maze and reused by every query: a parent byte per
+// cell (direction of the step that reached it), a queue of cell indices that doubles as the list
+// of touched cells, and for bidirectional BFS and A* a distance per cell. After a query only the
+// touched cells are cleared, so a short query does not pay for the size of the maze.
+// Cells are numbered y * columns + x, which limits a maze to 2^32 cells.
+class MazeSolver
+{
+public:
+    explicit MazeSolver(const MazeGrid & theMaze)
+        : maze(theMaze), rows(theMaze.rows()), columns(theMaze.columns()),
+          parent((size_t)theMaze.cellCount(), 0), queue((size_t)theMaze.cellCount()), explored(0)
+    {
+        if (theMaze.cellCount() > (long long)UINT32_MAX) {
+            throw std::length_error("MazeSolver supports at most 2^32 cells");
+        }
+    }
+
+    // Find a shortest path with the given mode (SOLVER_BFS, SOLVER_BIDIRECTIONAL or SOLVER_ASTAR;
+    // other modes are answered with BFS).
+    // On success moves holds the direction of every step from the entry, last step on top.
+    bool solve(solver_mode mode, int x_entry, int y_entry, int x_exit, int y_exit, Stack<unsigned char> & moves)
+    {
+        if (!maze.contains(x_entry, y_entry) || !maze.contains(x_exit, y_exit)) {
+            return false;
+        }
+        uint32_t entry = cellIndex(x_entry, y_entry), exit = cellIndex(x_exit, y_exit);
+        if (mode == SOLVER_BIDIRECTIONAL) {
+            return bidirectional(entry, exit, moves);
+        }
+        if (mode == SOLVER_ASTAR) {
+            return astar(entry, exit, moves);
+        }
+        return bfs(entry, exit, moves);
+    }
+
+    // Number of cells the last query reached
+    long long cellsExplored() const { return explored; }
+
+private:
+    // parent byte: 0 unseen, ROOT for the start cell(s), otherwise the direction of the step from
+    // the parent; FROM_EXIT marks cells reached by the backward half of the bidirectional search
+    // and CLOSED cells that A* has expanded
+    static const unsigned char ROOT = 7;
+    static const unsigned char STEP = 7;
+    static const unsigned char FROM_EXIT = 8;
+    static const unsigned char CLOSED = 16;
+
+    uint32_t cellIndex(int x, int y) const { return (uint32_t)y * (uint32_t)columns + (uint32_t)x; }
+
+    // Neighbour of cell in the given direction if there is no wall in between
+    bool step(uint32_t cell, int direction, uint32_t & next) const
+    {
+        int x = (int)(cell % (uint32_t)columns), y = (int)(cell / (uint32_t)columns);
+        if (maze.hasWall(x, y, direction)) {
+            return false;
+        }
+        next = cellIndex(x + DIR_DX[direction], y + DIR_DY[direction]);
+        return true;
+    }
+
+    // Cell the step in the given direction came from
+    uint32_t stepBack(uint32_t cell, int direction) const {
+        return cellIndex((int)(cell % (uint32_t)columns) - DIR_DX[direction], (int)(cell / (uint32_t)columns) - DIR_DY[direction]);
+    }
+
+    // Manhattan distance between two cells
+    uint32_t manhattan(uint32_t a, uint32_t b) const {
+        int ax = (int)(a % (uint32_t)columns), ay = (int)(a / (uint32_t)columns);
+        int bx = (int)(b % (uint32_t)columns), by = (int)(b / (uint32_t)columns);
+        return (uint32_t)(std::abs(ax - bx) + std::abs(ay - by));
+    }
+
+    // Push the steps from the start to cell onto moves in walking order
+    void tracePath(uint32_t cell, Stack<unsigned char> & moves)
+    {
+        Stack<unsigned char> backwards;
+        while ((parent[cell] & STEP) != ROOT) {
+            int direction = parent[cell] & STEP;
+            backwards.push((unsigned char)direction);
+            cell = stepBack(cell, direction);
+        }
+        moves.reserve(moves.size() + backwards.size());
+        while (!backwards.isEmpty()) {
+            moves.push(backwards.top());
+            backwards.pop();
+        }
+    }
+
+    // Forget the cells queue[begin, end) were marked with
+    void clearTouched(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            parent[queue[i]] = 0;
+        }
+    }
+
+    // Plain breadth-first search from the entry
+    bool bfs(uint32_t entry, uint32_t exit, Stack<unsigned char> & moves)
+    {
+        size_t head = 0, tail = 0;
+        parent[entry] = ROOT;
+        queue[tail++] = entry;
+        bool found = (entry == exit);
+        while (!found && head < tail) {
+            uint32_t cell = queue[head++];
+            for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                uint32_t next;
+                if (step(cell, direction, next) && parent[next] == 0) {
+                    parent[next] = (unsigned char)direction;
+                    queue[tail++] = next;
+                    if (next == exit) {
+                        found = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (found) {
+            tracePath(exit, moves);
+        }
+        explored = (long long)tail;
+        clearTouched(0, tail);
+        return found;
+    }
+
+    // Breadth-first search from both ends at once, one whole level at a time from the smaller
+    // frontier. The forward cells fill the queue from the front and the backward cells from the
+    // back. Once a level finds cells of the other side, the shortest of those meetings is used.
+    bool bidirectional(uint32_t entry, uint32_t exit, Stack<unsigned char> & moves)
+    {
+        if (entry == exit) {
+            return true;
+        }
+        if (depth.size() != parent.size()) {
+            depth.assign(parent.size(), 0);
+        }
+        size_t n = queue.size();
+        size_t forwardHead = 0, forwardTail = 0, backwardHead = n, backwardTail = n;
+        parent[entry] = ROOT;
+        depth[entry] = 0;
+        queue[forwardTail++] = entry;
+        parent[exit] = ROOT | FROM_EXIT;
+        depth[exit] = 0;
+        queue[--backwardHead] = exit;
+
+        uint64_t best = UINT64_MAX;
+        uint32_t meetForward = 0, meetBackward = 0;
+        int meetDirection = 0;
+
+        while (best == UINT64_MAX && forwardHead < forwardTail && backwardHead < backwardTail) {
+            bool forward = (forwardTail - forwardHead) <= (backwardTail - backwardHead);
+            if (forward) {
+                // Expand the whole forward level, new cells go after it
+                size_t levelEnd = forwardTail;
+                for (; forwardHead < levelEnd; forwardHead++) {
+                    uint32_t cell = queue[forwardHead];
+                    for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                        uint32_t next;
+                        if (!step(cell, direction, next)) continue;
+                        if (parent[next] == 0) {
+                            parent[next] = (unsigned char)direction;
+                            depth[next] = depth[cell] + 1;
+                            queue[forwardTail++] = next;
+                        }
+                        else if (parent[next] & FROM_EXIT) {
+                            uint64_t length = (uint64_t)depth[cell] + 1 + depth[next];
+                            if (length < best) {
+                                best = length;
+                                meetForward = cell;
+                                meetBackward = next;
+                                meetDirection = direction;
+                            }
+                        }
+                    }
+                }
+            }
+            else {
+                // Expand the whole backward level, new cells go in front of it
+                size_t levelStart = backwardHead;
+                for (size_t i = backwardTail; i > levelStart; i--) {
+                    uint32_t cell = queue[i - 1];
+                    for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                        uint32_t next;
+                        if (!step(cell, direction, next)) continue;
+                        if (parent[next] == 0) {
+                            parent[next] = (unsigned char)(direction | FROM_EXIT);
+                            depth[next] = depth[cell] + 1;
+                            queue[--backwardHead] = next;
+                        }
+                        else if (!(parent[next] & FROM_EXIT)) {
+                            uint64_t length = (uint64_t)depth[next] + 1 + depth[cell];
+                            if (length < best) {
+                                best = length;
+                                meetForward = next;
+                                meetBackward = cell;
+                                meetDirection = opposite_direction(direction);
+                            }
+                        }
+                    }
+                }
+                backwardTail = levelStart;
+            }
+        }
+
+        bool found = (best != UINT64_MAX);
+        if (found) {
+            // Forward half, the step across, then back along the exit side's parents
+            tracePath(meetForward, moves);
+            moves.push((unsigned char)meetDirection);
+            uint32_t cell = meetBackward;
+            while ((parent[cell] & STEP) != ROOT) {
+                int direction = parent[cell] & STEP;
+                moves.push((unsigned char)opposite_direction(direction));
+                cell = stepBack(cell, direction);
+            }
+        }
+        explored = (long long)(forwardTail + (n - backwardHead));
+        clearTouched(0, forwardTail);
+        clearTouched(backwardHead, n);
+        return found;
+    }
+
+    // A* with the Manhattan distance. Along any step g grows by 1 and the heuristic changes by
+    // exactly 1, so f = g + h either stays the same or grows by 2. The open list is therefore a
+    // deque holding only two f values: same-f cells go to the front, f + 2 cells to the back.
+    bool astar(uint32_t entry, uint32_t exit, Stack<unsigned char> & moves)
+    {
+        if (depth.size() != parent.size()) {
+            depth.assign(parent.size(), 0);
+        }
+        if (open.size() < 1024) {
+            open.assign(1024, 0);
+        }
+        size_t touched = 0;
+        openHead = 0;
+        openCount = 0;
+
+        parent[entry] = ROOT;
+        depth[entry] = 0;
+        queue[touched++] = entry;
+        pushOpen(entry, false);
+        bool found = false;
+
+        while (openCount > 0) {
+            uint32_t cell = popOpen();
+            if (parent[cell] & CLOSED) continue;
+            parent[cell] |= CLOSED;
+            if (cell == exit) {
+                found = true;
+                break;
+            }
+            uint32_t f = depth[cell] + manhattan(cell, exit);
+            for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                uint32_t next;
+                if (!step(cell, direction, next)) continue;
+                uint32_t g = depth[cell] + 1;
+                if (parent[next] == 0) {
+                    queue[touched++] = next;
+                }
+                else if ((parent[next] & CLOSED) || g >= depth[next]) {
+                    continue;
+                }
+                parent[next] = (unsigned char)direction;
+                depth[next] = g;
+                pushOpen(next, g + manhattan(next, exit) == f);
+            }
+        }
+
+        if (found) {
+            for (uint32_t cell = exit; ; ) {
+                parent[cell] &= (unsigned char)~CLOSED;
+                if ((parent[cell] & STEP) == ROOT) break;
+                cell = stepBack(cell, parent[cell] & STEP);
+            }
+            tracePath(exit, moves);
+        }
+        explored = (long long)touched;
+        clearTouched(0, touched);
+        return found;
+    }
+
+    // Ring buffer deque of A*'s open list, doubled when full
+    void pushOpen(uint32_t cell, bool front)
+    {
+        if (openCount == open.size()) {
+            std::vector<uint32_t> bigger(open.size() * 2);
+            for (size_t i = 0; i < openCount; i++) {
+                bigger[i] = open[(openHead + i) % open.size()];
+            }
+            open.swap(bigger);
+            openHead = 0;
+        }
+        if (front) {
+            openHead = (openHead + open.size() - 1) % open.size();
+            open[openHead] = cell;
+        }
+        else {
+            open[(openHead + openCount) % open.size()] = cell;
+        }
+        openCount++;
+    }
+
+    uint32_t popOpen()
+    {
+        uint32_t cell = open[openHead];
+        openHead = (openHead + 1) % open.size();
+        openCount--;
+        return cell;
+    }
+
+    const MazeGrid & maze;
+    int rows, columns;
+    std::vector<unsigned char> parent;
+    std::vector<uint32_t> queue;
+    std::vector<uint32_t> depth;
+    std::vector<uint32_t> open;
+    size_t openHead, openCount;
+    long long explored;
+};
+
+// Find a shortest path with the given mode, like MazeSolver::solve. Plain BFS on a maze with a
+// fixed-size kernel (FixedMaze.h) runs that kernel, with no solver memory to allocate.
+inline bool shortest_path_search(const MazeGrid & maze, solver_mode mode, int x_entry, int y_entry, int x_exit, int y_exit,
+                                 Stack<unsigned char> & moves)
+{
+    if (!maze.contains(x_entry, y_entry) || !maze.contains(x_exit, y_exit)) {
+        return false;
+    }
+    bool reached = false;
+    if (mode == SOLVER_BFS && fixed_shortest_path(maze, x_entry, y_entry, x_exit, y_exit, moves, reached)) {
+        return reached;
+    }
+    MazeSolver solver(maze);
+    return solver.solve(mode, x_entry, y_entry, x_exit, y_exit, moves);
+}
+
+#endif /* MazeSolver_h */
@@ -0,0 +1,160 @@
+//
+//  MazeStats.h
+//
+//  Counters and phase timers for maze generation and path discovery, reported per maze.
+//  Build with -DMAZE_STATS=0 to compile every counter out of the hot loops.
+//
+
+#ifndef MazeStats_h
+#define MazeStats_h
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <cstddef>
+#include <algorithm>
+
+#ifndef MAZE_STATS
+#define MAZE_STATS 1
+#endif
+
+// What happened while one maze was generated or solved
+struct maze_stats {
+    long long rng_draws;        // Random numbers drawn
+    long long rejected_draws;   // Directions drawn that were visited, outside the maze or behind a wall
+    long long backtrack_pops;   // Steps taken back from a dead end
+    long long deadend_checks;   // isdeadEnd evaluations
+    long long peak_stack_depth; // Most steps on the stack at once
+    double generate_seconds;
+    double write_seconds;
+    double parse_seconds;
+    double search_seconds;
+};
+
+// Counters of the calling thread. Every thread generates or solves one maze at a time,
+// so the counters need no locking; the driver clears them before a maze and reports after.
+inline maze_stats & current_maze_stats() {
+    static thread_local maze_stats stats = maze_stats();
+    return stats;
+}
+
+// Adds the time from construction to destruction to a phase
+class MazeStatsTimer
+{
+public:
+    explicit MazeStatsTimer(double & phaseSeconds)
+        : seconds(phaseSeconds), start(std::chrono::steady_clock::now()) {}
+
+    ~MazeStatsTimer() {
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    MazeStatsTimer(const MazeStatsTimer &) = delete;
+    MazeStatsTimer & operator=(const MazeStatsTimer &) = delete;
+
+private:
+    double & seconds;
+    std::chrono::steady_clock::time_point start;
+};
+
+#if MAZE_STATS
+#define MAZE_STAT_ADD(field, amount) (current_maze_stats().field += (amount))
+#define MAZE_STAT_MAX(field, value) do { maze_stats & maze_stats_now = current_maze_stats(); \
+    if ((long long)(value) > maze_stats_now.field) maze_stats_now.field = (long long)(value); } while (0)
+#define MAZE_STAT_TIMER(field) MazeStatsTimer maze_stats_timer_##field(current_maze_stats().field)
+#else
+#define MAZE_STAT_ADD(field, amount) ((void)0)
+#define MAZE_STAT_MAX(field, value) ((void)0)
+#define MAZE_STAT_TIMER(field) ((void)0)
+#endif
+
+// Where the per-maze records go: nowhere (the default), a CSV file or standard error.
+// Records from several threads are written whole, one line each.
+class MazeStatsLog
+{
+public:
+    // Open the log: "stderr" or the name of a CSV file (created with a header line)
+    static void open(const std::string & target)
+    {
+        MazeStatsLog & log = instance();
+        std::lock_guard<std::mutex> guard(log.lock);
+        if (!MAZE_STATS) {
+            std::cerr << "this program was built with MAZE_STATS=0, the statistics stay empty" << std::endl;
+        }
+        log.toStderr = (target == "stderr");
+        if (!log.toStderr) {
+            log.file.open(target);
+            if (!log.file) {
+                throw std::runtime_error("cannot write " + target);
+            }
+        }
+        log.enabled = true;
+        log.writeLine("mazeID,operation,rows,columns,rng_draws,rejected_draws,backtrack_pops,deadend_checks,"
+                      "peak_stack_depth,generate_seconds,write_seconds,parse_seconds,search_seconds");
+    }
+
+    static bool isOpen() { return instance().enabled; }
+
+    // Write the calling thread's counters as one record
+    static void report(int mazeID, const std::string & operation, int rows, int columns)
+    {
+        MazeStatsLog & log = instance();
+        if (!log.enabled) {
+            return;
+        }
+        const maze_stats & stats = current_maze_stats();
+        std::ostringstream line;
+        line << mazeID << ',' << operation << ',' << rows << ',' << columns << ',' << stats.rng_draws << ','
+             << stats.rejected_draws << ',' << stats.backtrack_pops << ',' << stats.deadend_checks << ','
+             << stats.peak_stack_depth << ',' << stats.generate_seconds << ',' << stats.write_seconds << ','
+             << stats.parse_seconds << ',' << stats.search_seconds;
+        std::lock_guard<std::mutex> guard(log.lock);
+        log.writeLine(line.str());
+    }
+
+private:
+    MazeStatsLog(): enabled(false), toStderr(false) {}
+
+    static MazeStatsLog & instance() {
+        static MazeStatsLog log;
+        return log;
+    }
+
+    void writeLine(const std::string & line) {
+        if (toStderr) {
+            std::cerr << line << '\n';
+        }
+        else {
+            file << line << '\n';
+        }
+    }
+
+    std::atomic<bool> enabled;
+    bool toStderr;
+    std::ofstream file;
+    std::mutex lock;
+};
+
+// Clear the calling thread's counters before a new maze
+inline void reset_maze_stats() {
+    current_maze_stats() = maze_stats();
+}
+
+// Add the counters and phase times of part to total; the peak stack depth is the larger of the two
+inline void add_maze_stats(maze_stats & total, const maze_stats & part) {
+    total.rng_draws += part.rng_draws;
+    total.rejected_draws += part.rejected_draws;
+    total.backtrack_pops += part.backtrack_pops;
+    total.deadend_checks += part.deadend_checks;
+    total.peak_stack_depth = std::max(total.peak_stack_depth, part.peak_stack_depth);
+    total.generate_seconds += part.generate_seconds;
+    total.write_seconds += part.write_seconds;
+    total.parse_seconds += part.parse_seconds;
+    total.search_seconds += part.search_seconds;
+}
+
+#endif /* MazeStats_h */
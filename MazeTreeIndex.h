@@ -0,0 +1,220 @@
+//
+//  MazeTreeIndex.h
+//
+//  Index for answering many entry/exit queries on one maze. A perfect maze is a spanning tree
+//  of its cells, so the path between two cells is the tree path through their lowest common
+//  ancestor (LCA). The index is built once, after which a path length costs O(log n) and a
+//  path costs O(path length).
+//
+
+#ifndef MazeTreeIndex_h
+#define MazeTreeIndex_h
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include "Stack.h"
+#include "MazeGrid.h"
+
+// One line of a query file: entry and exit cell
+struct path_query {
+    int x_entry, y_entry, x_exit, y_exit;
+};
+
+// Read a query file of "x_entry y_entry x_exit y_exit" lines
+inline std::vector<path_query> read_query_file(const std::string & filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("cannot open " + filename);
+    }
+    std::vector<path_query> queries;
+    path_query query;
+    while (file >> query.x_entry >> query.y_entry >> query.x_exit >> query.y_exit) {
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+// The maze as a rooted tree.
+// Every cell keeps the direction of the step from its parent, its depth and one jump pointer
+// to an ancestor. The jump pointers follow the skew-binary scheme: a cell jumps as far as its
+// parent's jump plus that jump's jump when those two jumps are equally long, and to its parent
+// otherwise. Climbing to any depth then takes O(log n) jumps, like binary lifting, but with
+// one pointer per cell instead of log n of them (9 bytes per cell in total).
+//
+// The tree is a breadth-first spanning tree rooted at (0, 0). For a perfect maze, which every
+// generator produces, tree paths are the paths of the maze. A maze with loops still gets valid
+// paths, but not necessarily the shortest ones, and cells of separate parts of a maze that is
+// not connected have no path between them.
+class MazeTreeIndex
+{
+public:
+    explicit MazeTreeIndex(const MazeGrid & maze)
+        : rows(maze.rows()), columns(maze.columns()), cellCount(maze.cellCount()),
+          parentStep((size_t)maze.cellCount(), 0), depth((size_t)maze.cellCount(), 0), jump((size_t)maze.cellCount(), 0),
+          componentCount(0), treeEdges(0), openPassages(0)
+    {
+        if (maze.cellCount() > (long long)UINT32_MAX) {
+            throw std::length_error("MazeTreeIndex supports at most 2^32 cells");
+        }
+        build(maze);
+    }
+
+    // Bytes the index keeps for a maze of the given number of cells
+    static size_t memoryFor(long long cells) {
+        return (size_t)cells * (sizeof(unsigned char) + 2 * sizeof(uint32_t));
+    }
+
+    // True when the maze is one tree: connected and without loops, so every path is the only one
+    bool isPerfect() const { return componentCount == 1 && openPassages == treeEdges; }
+
+    // Number of steps between two cells, or -1 when there is no path (or a cell is outside the maze)
+    long long pathLength(int x_entry, int y_entry, int x_exit, int y_exit) const
+    {
+        if (!contains(x_entry, y_entry) || !contains(x_exit, y_exit)) {
+            return -1;
+        }
+        uint32_t a = cellIndex(x_entry, y_entry), b = cellIndex(x_exit, y_exit);
+        uint32_t ancestor;
+        if (!lowestCommonAncestor(a, b, ancestor)) {
+            return -1;
+        }
+        return (long long)depth[a] + depth[b] - 2 * (long long)depth[ancestor];
+    }
+
+    // Path between two cells. On success moves holds the direction of every step from the
+    // entry, last step on top, as writing_path_file expects.
+    bool path(int x_entry, int y_entry, int x_exit, int y_exit, Stack<unsigned char> & moves) const
+    {
+        if (!contains(x_entry, y_entry) || !contains(x_exit, y_exit)) {
+            return false;
+        }
+        uint32_t a = cellIndex(x_entry, y_entry), b = cellIndex(x_exit, y_exit);
+        uint32_t ancestor;
+        if (!lowestCommonAncestor(a, b, ancestor)) {
+            return false;
+        }
+        moves.reserve(moves.size() + depth[a] + depth[b] - 2 * (size_t)depth[ancestor]);
+
+        // Up from the entry: every step goes against the step that reached the cell
+        for (uint32_t cell = a; cell != ancestor; cell = parentOf(cell)) {
+            moves.push((unsigned char)opposite_direction(parentStep[cell]));
+        }
+        // Down to the exit: the steps are found from the exit upwards, so reverse them
+        Stack<unsigned char> down;
+        down.reserve(depth[b] - depth[ancestor]);
+        for (uint32_t cell = b; cell != ancestor; cell = parentOf(cell)) {
+            down.push(parentStep[cell]);
+        }
+        while (!down.isEmpty()) {
+            moves.push(down.top());
+            down.pop();
+        }
+        return true;
+    }
+
+private:
+    static const unsigned char ROOT = 7;
+
+    bool contains(int x, int y) const {
+        return x >= 0 && x < columns && y >= 0 && y < rows;
+    }
+
+    uint32_t cellIndex(int x, int y) const { return (uint32_t)y * (uint32_t)columns + (uint32_t)x; }
+
+    // Cell the step into cell came from
+    uint32_t parentOf(uint32_t cell) const {
+        switch (parentStep[cell]) {
+            case DIR_LEFT: return cell + 1;
+            case DIR_RIGHT: return cell - 1;
+            case DIR_UP: return cell - (uint32_t)columns;
+            case DIR_DOWN: return cell + (uint32_t)columns;
+            default: return cell;
+        }
+    }
+
+    // Breadth-first search from (0, 0), and from every cell left unreached for a maze that is
+    // not connected. Cells leave the queue in order of depth, so a parent's jump is always set
+    // before its children's.
+    void build(const MazeGrid & maze)
+    {
+        std::vector<uint32_t> queue((size_t)cellCount);
+        for (int y = 0; y < maze.rows(); y++) {
+            for (int x = 0; x < columns; x++) {
+                if (!maze.hasWall(x, y, DIR_RIGHT)) openPassages++;
+                if (!maze.hasWall(x, y, DIR_UP)) openPassages++;
+            }
+        }
+
+        for (uint32_t start = 0; start < (uint32_t)cellCount; start++) {
+            if (parentStep[start] != 0) continue;
+            componentCount++;
+            size_t head = 0, tail = 0;
+            parentStep[start] = ROOT;
+            depth[start] = 0;
+            jump[start] = start;
+            queue[tail++] = start;
+            while (head < tail) {
+                uint32_t cell = queue[head++];
+                int x = (int)(cell % (uint32_t)columns), y = (int)(cell / (uint32_t)columns);
+                for (int direction = DIR_LEFT; direction <= DIR_DOWN; direction++) {
+                    if (maze.hasWall(x, y, direction)) continue;
+                    uint32_t next = cellIndex(x + DIR_DX[direction], y + DIR_DY[direction]);
+                    if (parentStep[next] != 0) continue;
+                    parentStep[next] = (unsigned char)direction;
+                    depth[next] = depth[cell] + 1;
+                    uint32_t up = jump[cell];
+                    if (depth[cell] - depth[up] == depth[up] - depth[jump[up]]) {
+                        jump[next] = jump[up];
+                    }
+                    else {
+                        jump[next] = cell;
+                    }
+                    queue[tail++] = next;
+                    treeEdges++;
+                }
+            }
+        }
+    }
+
+    // Lowest common ancestor of a and b; false when they are in different parts of the maze
+    bool lowestCommonAncestor(uint32_t a, uint32_t b, uint32_t & ancestor) const
+    {
+        if (depth[a] < depth[b]) {
+            std::swap(a, b);
+        }
+        while (depth[a] > depth[b]) {
+            a = depth[jump[a]] >= depth[b] ? jump[a] : parentOf(a);
+        }
+        // Same depth, so the jumps of a and b are the same length as well
+        while (a != b) {
+            if (depth[a] == 0) {
+                return false;
+            }
+            if (jump[a] != jump[b]) {
+                a = jump[a];
+                b = jump[b];
+            }
+            else {
+                a = parentOf(a);
+                b = parentOf(b);
+            }
+        }
+        ancestor = a;
+        return true;
+    }
+
+    int rows, columns;
+    long long cellCount;
+    std::vector<unsigned char> parentStep;
+    std::vector<uint32_t> depth;
+    std::vector<uint32_t> jump;
+    long long componentCount;
+    long long treeEdges;
+    long long openPassages;
+};
+
+#endif /* MazeTreeIndex_h */
@@ -0,0 +1,617 @@
+//
+//  MazeValidator.h
+//
+//  Checks for maze files from outside: every cell of a text file is in range and appears once,
+//  neighbouring cells agree on the walls they share, the outer border is closed, and the maze is
+//  perfect (connected and without loops). The work is split over threads, the text by byte ranges
+//  and the union-find over bands of rows, and the first problem is reported with its line or cell.
+//
+
+#ifndef MazeValidator_h
+#define MazeValidator_h
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <cstdint>
+#include <climits>
+#include "MazeGrid.h"
+#include "MazeFile.h"
+#include "MazeAlgorithms.h"
+#include "WorkStealing.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// What a successful validation found
+struct maze_validation {
+    int rows, columns;
+    long long cells;
+    long long openPassages;  // Walls knocked down, cells - 1 for a perfect maze
+    double seconds;
+
+    maze_validation(): rows(), columns(), cells(), openPassages(), seconds() {}
+};
+
+// The first problem found by the threads of a validation. Problems have a position (a byte
+// offset or a cell index) and the one with the smallest position wins, so the report does not
+// depend on the number of threads; work past a known problem is skipped.
+class FirstProblem
+{
+public:
+    FirstProblem() : position(LLONG_MAX) {}
+
+    // True when a problem was already found before the given position, so work there is wasted
+    bool foundBefore(long long at) const { return position.load(std::memory_order_relaxed) < at; }
+    bool found() const { return position.load() != LLONG_MAX; }
+
+    void report(long long at, const std::string & text)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (at < position.load()) {
+            position = at;
+            message = text;
+        }
+    }
+
+    long long where() const { return position.load(); }
+    const std::string & what() const { return message; }
+
+private:
+    std::atomic<long long> position;
+    std::mutex lock;
+    std::string message;
+};
+
+// Mask of the lowest count bits of a word (none for count <= 0, all for count >= 64)
+inline uint64_t bits_below(long long count) {
+    if (count <= 0) return 0;
+    return count >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+}
+
+inline std::string cell_name(int x, int y) {
+    return "(" + std::to_string(x) + ", " + std::to_string(y) + ")";
+}
+
+// Sets of the cells of a band's bottom and top rows, and the open walls inside the band
+struct band_labels {
+    std::vector<uint32_t> bottom, top;
+    long long passages;
+
+    band_labels(): passages() {}
+};
+
+// Connected components of a band of rows, found row by row so that only a few rows of labels
+// are ever touched. Sets are numbered [0, C) for the cells of the band's bottom row, [C, 2C) for
+// the components of the previous row that do not reach the bottom row, and [2C, 3C) for the
+// cells of the current row. A union keeps the smaller number as the root, so the sets of the
+// bottom row stay valid for the whole band while the others are renumbered after every row.
+class BandLabeller
+{
+public:
+    BandLabeller(const MazeGrid & grid, const std::vector<uint64_t> & columnMask)
+        : maze(grid), columnOpen(columnMask), columns((uint32_t)grid.columns()),
+          parent(3 * (size_t)columns), relabel(3 * (size_t)columns, UINT32_MAX), continued(columns), seenAt(columns)
+    {
+    }
+
+    // Label rows y0 to y1 - 1. Returns false after reporting a wall that closes a loop or a
+    // component that ends inside the band without reaching its bottom row.
+    bool label(int y0, int y1, band_labels & band, FirstProblem & problem, const std::string & name)
+    {
+        const uint32_t C = columns;
+        const size_t stride = maze.wordsPerRow();
+        std::vector<uint32_t> & labels = band.top;
+        labels.assign(C, 0);
+        band.passages = 0;
+        uint32_t previousCount = 0;
+        for (uint32_t i = 0; i < C; i++) {
+            parent[i] = i;
+        }
+
+        for (int y = y0; y < y1; y++) {
+            if (problem.foundBefore((long long)y0 * C)) {
+                return false;
+            }
+            const uint32_t base = y == y0 ? 0 : 2 * C;
+            // Cells joined by open right walls form runs, which cannot close a loop within a row:
+            // every cell of a run points at the first one
+            const uint64_t * rightWalls = maze.rightWalls(y);
+            runs.clear();
+            for (size_t w = 0; w < stride; w++) {
+                // Bit x starts a run when the wall right of x - 1 stands (or x is the first column)
+                uint64_t starts = (rightWalls[w] << 1) | (w == 0 ? 1 : rightWalls[w - 1] >> 63);
+                for (starts &= columnOpen[w]; starts; starts &= starts - 1) {
+                    runs.push_back((uint32_t)(w * 64) + (uint32_t)lowest_bit(starts));
+                }
+            }
+            band.passages += (long long)C - (long long)runs.size();
+            runs.push_back(C);
+            for (size_t r = 0; r + 1 < runs.size(); r++) {
+                std::fill(&parent[base + runs[r]], &parent[base + runs[r + 1]], base + runs[r]);
+            }
+            if (y > y0) {
+                const uint64_t * upWalls = maze.upWalls(y - 1);
+                for (size_t w = 0; w < stride; w++) {
+                    for (uint64_t open = ~upWalls[w] & columnOpen[w]; open; open &= open - 1) {
+                        uint32_t x = (uint32_t)(w * 64) + (uint32_t)lowest_bit(open);
+                        band.passages++;
+                        if (labels[x] >= C) {
+                            continued[labels[x] - C] = 1;
+                        }
+                        if (!unite(labels[x], base + x)) {
+                            problem.report((long long)y * C + x, name + ": the open wall between " + cell_name((int)x, y - 1) + " and " +
+                                           cell_name((int)x, y) + " closes a loop");
+                            return false;
+                        }
+                    }
+                }
+                // A component of the previous row with no way up and none to the bottom row is cut off
+                for (uint32_t l = 0; l < previousCount; l++) {
+                    if (!continued[l]) {
+                        problem.report((long long)(y - 1) * C + seenAt[l], name + ": cell " + cell_name((int)seenAt[l], y - 1) +
+                                       " cannot be reached from (0, 0)");
+                        return false;
+                    }
+                }
+            }
+
+            // Renumber the components of this row for the next one
+            uint32_t count = 0;
+            roots.clear();
+            for (size_t r = 0; r + 1 < runs.size(); r++) {
+                uint32_t root = find(base + runs[r]);
+                uint32_t label = root;
+                if (root >= C) {
+                    if (relabel[root] == NONE) {
+                        relabel[root] = C + count;
+                        seenAt[count] = runs[r];
+                        roots.push_back(root);
+                        count++;
+                    }
+                    label = relabel[root];
+                }
+                std::fill(&labels[runs[r]], &labels[runs[r + 1]], label);
+            }
+            for (size_t r = 0; r < roots.size(); r++) {
+                relabel[roots[r]] = NONE;
+            }
+            for (uint32_t l = 0; l < count; l++) {
+                parent[C + l] = C + l;
+                continued[l] = 0;
+            }
+            previousCount = count;
+        }
+
+        band.bottom.resize(C);
+        for (uint32_t x = 0; x < C; x++) {
+            band.bottom[x] = find(x);
+        }
+        return true;
+    }
+
+private:
+    static const uint32_t NONE = UINT32_MAX;  // Root not renumbered yet
+
+    uint32_t find(uint32_t element) {
+        while (parent[element] != element) {
+            parent[element] = parent[parent[element]];
+            element = parent[element];
+        }
+        return element;
+    }
+
+    bool unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return false;
+        }
+        if (a < b) parent[b] = a;
+        else parent[a] = b;
+        return true;
+    }
+
+    const MazeGrid & maze;
+    const std::vector<uint64_t> & columnOpen;
+    uint32_t columns;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> relabel;
+    std::vector<unsigned char> continued;
+    std::vector<uint32_t> seenAt;
+    std::vector<uint32_t> roots;
+    std::vector<uint32_t> runs;     // First column of every run of the current row, then C
+};
+
+// Check that a maze is perfect: every band of rows is labelled on its own thread, then the
+// bands' boundary rows are joined in a DisjointSets across the walls between bands. Throws
+// std::runtime_error naming a wall that closes a loop or a cell that cannot be reached from
+// (0, 0). Returns the number of open passages.
+inline long long validate_perfect_maze(const MazeGrid & maze, int threads, const std::string & name)
+{
+    const int rows = maze.rows(), columns = maze.columns();
+    if (3 * (long long)columns > (long long)UINT32_MAX) {
+        throw std::length_error(name + ": the validator numbers cells of a row with 32 bits, the maze is too wide");
+    }
+    if (maze.cellCount() == 0) {
+        return 0;
+    }
+    const size_t stride = maze.wordsPerRow();
+    // The columns of each word of a row; bits past the last column are not walls of the maze
+    std::vector<uint64_t> columnMask(stride);
+    for (size_t w = 0; w < stride; w++) {
+        columnMask[w] = bits_below((long long)columns - (long long)w * 64);
+    }
+
+    threads = default_thread_count(threads);
+    const long long setsPerBand = 2 * (long long)columns;
+    const int bandCount = (int)std::min(std::min((long long)rows, threads == 1 ? 1LL : threads * 4LL),
+                                        std::max(1LL, (long long)UINT32_MAX / setsPerBand));
+    std::vector<band_labels> bands((size_t)bandCount);
+    FirstProblem problem;
+    parallel_for_stealing((size_t)bandCount, threads, [&](size_t band) {
+        BandLabeller labeller(maze, columnMask);
+        labeller.label((int)((long long)rows * band / bandCount), (int)((long long)rows * (band + 1) / bandCount), bands[band],
+                       problem, name);
+    });
+    if (problem.found()) {
+        throw std::runtime_error(problem.what());
+    }
+
+    // Join the bands across the rows between them, then everything must be one set
+    DisjointSets sets((uint32_t)(bandCount * setsPerBand));
+    long long passages = 0;
+    for (int band = 0; band < bandCount; band++) {
+        passages += bands[band].passages;
+        if (band + 1 == bandCount) {
+            break;
+        }
+        int y = (int)((long long)rows * (band + 1) / bandCount) - 1;
+        const uint64_t * upWalls = maze.upWalls(y);
+        for (size_t w = 0; w < stride; w++) {
+            for (uint64_t open = ~upWalls[w] & columnMask[w]; open; open &= open - 1) {
+                int x = (int)(w * 64) + lowest_bit(open);
+                passages++;
+                if (!sets.unite((uint32_t)(band * setsPerBand + bands[band].top[x]),
+                                (uint32_t)((band + 1) * setsPerBand + bands[band + 1].bottom[x]))) {
+                    throw std::runtime_error(name + ": the open wall between " + cell_name(x, y) + " and " + cell_name(x, y + 1) +
+                                             " closes a loop");
+                }
+            }
+        }
+    }
+    uint32_t origin = sets.find(bands[0].bottom[0]);
+    for (int band = 0; band < bandCount; band++) {
+        int y0 = (int)((long long)rows * band / bandCount), y1 = (int)((long long)rows * (band + 1) / bandCount);
+        for (int x = 0; x < columns; x++) {
+            if (sets.find((uint32_t)(band * setsPerBand + bands[band].bottom[x])) != origin) {
+                throw std::runtime_error(name + ": cell " + cell_name(x, y0) + " cannot be reached from (0, 0)");
+            }
+            if (sets.find((uint32_t)(band * setsPerBand + bands[band].top[x])) != origin) {
+                throw std::runtime_error(name + ": cell " + cell_name(x, y1 - 1) + " cannot be reached from (0, 0)");
+            }
+        }
+    }
+    return passages;
+}
+
+// A whole file as bytes: mapped read-only where that is possible, read into memory otherwise
+class ValidatorInput
+{
+public:
+    explicit ValidatorInput(const std::string & filename) : mapping(NULL), length(0)
+    {
+#if !defined(_WIN32)
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            if (fd >= 0) close(fd);
+            throw std::runtime_error("cannot open " + filename);
+        }
+        length = (size_t)info.st_size;
+        if (length > 0) {
+            mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                mapping = NULL;
+                close(fd);
+                throw std::runtime_error("cannot map " + filename);
+            }
+            madvise(mapping, length, MADV_SEQUENTIAL);
+        }
+        close(fd);
+#else
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::runtime_error("cannot open " + filename);
+        }
+        length = (size_t)file.tellg();
+        file.seekg(0);
+        storage.resize(length);
+        file.read(storage.data(), (std::streamsize)length);
+#endif
+    }
+
+    ~ValidatorInput() {
+#if !defined(_WIN32)
+        if (mapping != NULL) {
+            munmap(mapping, length);
+        }
+#endif
+    }
+
+    ValidatorInput(const ValidatorInput &) = delete;
+    ValidatorInput & operator=(const ValidatorInput &) = delete;
+
+    const char * data() const {
+#if !defined(_WIN32)
+        return static_cast<const char *>(mapping);
+#else
+        return storage.data();
+#endif
+    }
+    size_t size() const { return length; }
+
+private:
+    void * mapping;
+    size_t length;
+#if defined(_WIN32)
+    std::vector<char> storage;
+#endif
+};
+
+// Fields of one cell line of a text maze file
+struct text_cell_line {
+    long long x, y;
+    int left, right, up, down;
+};
+
+// Parse "x=.. y=.. l=.. r=.. u=.. d=.." from p up to the end of the line (end is the newline or
+// the end of the file). Returns NULL on success, otherwise what is wrong with the line.
+inline const char * parse_text_cell_line(const char * p, const char * end, text_cell_line & cell)
+{
+    static const char keys[6] = {'x', 'y', 'l', 'r', 'u', 'd'};
+    long long values[6];
+    for (int field = 0; field < 6; field++) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (end - p < 3 || p[0] != keys[field] || p[1] != '=') {
+            return "expected \"x=.. y=.. l=.. r=.. u=.. d=..\"";
+        }
+        p += 2;
+        bool negative = p < end && *p == '-';
+        if (negative) p++;
+        const char * digits = p;
+        long long value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            // Anything this long is out of range anyway, stop before it overflows
+            if (value < ((long long)1 << 40)) value = value * 10 + (*p - '0');
+            p++;
+        }
+        if (p == digits || (p < end && *p != ' ' && *p != '\t' && *p != '\r')) {
+            return "expected \"x=.. y=.. l=.. r=.. u=.. d=..\"";
+        }
+        values[field] = negative ? -value : value;
+        if (field >= 2 && (negative || value > 1)) {
+            return "a wall must be 0 or 1";
+        }
+    }
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    if (p != end) {
+        return "unexpected text after the d= field";
+    }
+    cell.x = values[0];
+    cell.y = values[1];
+    cell.left = (int)values[2];
+    cell.right = (int)values[3];
+    cell.up = (int)values[4];
+    cell.down = (int)values[5];
+    return NULL;
+}
+
+// Check a text maze file line by line and build its grid. Every cell line must be well formed,
+// in range and the only one for its cell; every cell must be present, agree with its right and
+// upper neighbours on their shared walls and keep the outer border closed. The first problem in
+// the file (or, for missing cells and walls, the first cell row by row) is thrown as a
+// std::runtime_error with its line number or cell.
+inline MazeGrid validate_text_maze(const std::string & filename, int threads)
+{
+    ValidatorInput input(filename);
+    const char * data = input.data();
+    const char * fileEnd = data + input.size();
+    const char * bodyStart = std::find(data, fileEnd, '\n');
+    long long rows = 0, columns = 0;
+    {
+        std::istringstream header(std::string(data, bodyStart));
+        // The size, then at most a seed and an algorithm, all of them numbers
+        std::string field;
+        int fields = 0;
+        bool numbers = true;
+        while (header >> field) {
+            numbers = numbers && ++fields <= 4 && field.find_first_not_of("0123456789") == std::string::npos;
+        }
+        header.clear();
+        header.seekg(0);
+        if (!(header >> rows >> columns) || rows < 1 || columns < 1 || rows > INT_MAX || columns > INT_MAX || !numbers) {
+            throw std::runtime_error(filename + " line 1: expected \"rows columns [seed [algorithm]]\"");
+        }
+    }
+    if (rows * columns > (long long)UINT32_MAX) {
+        throw std::length_error(filename + ": the validator numbers cells with 32 bits, the maze has too many");
+    }
+    if (bodyStart != fileEnd) {
+        bodyStart++;
+    }
+
+    // One byte per cell, filled by the lines: SEEN plus the four wall bits
+    const unsigned char SEEN = 16, LEFT = 1, RIGHT = 2, UP = 4, DOWN = 8;
+    const long long cellCount = rows * columns;
+    std::unique_ptr<std::atomic<unsigned char>[]> cells(new std::atomic<unsigned char>[(size_t)cellCount]());
+    threads = default_thread_count(threads);
+    FirstProblem lineProblem;
+
+    // Chunks of about 1 MB; a chunk parses the lines that start inside it
+    const size_t bodyBytes = (size_t)(fileEnd - bodyStart);
+    const size_t chunkCount = std::max((size_t)1, std::min(bodyBytes >> 20, (size_t)1 << 16));
+    parallel_for_stealing(chunkCount, threads, [&](size_t chunk) {
+        const char * p = bodyStart + bodyBytes * chunk / chunkCount;
+        const char * chunkEnd = bodyStart + bodyBytes * (chunk + 1) / chunkCount;
+        if (chunk > 0 && p[-1] != '\n') {
+            p = std::find(p, fileEnd, '\n');
+            if (p != fileEnd) p++;
+        }
+        long long checked = 0;
+        while (p < chunkEnd) {
+            if ((++checked & 1023) == 0 && lineProblem.foundBefore(p - data)) {
+                return;
+            }
+            const char * lineEnd = std::find(p, fileEnd, '\n');
+            text_cell_line cell;
+            const char * error = parse_text_cell_line(p, lineEnd, cell);
+            if (error != NULL) {
+                lineProblem.report(p - data, error);
+                return;
+            }
+            if (cell.x < 0 || cell.x >= columns || cell.y < 0 || cell.y >= rows) {
+                lineProblem.report(p - data, "cell (" + std::to_string(cell.x) + ", " + std::to_string(cell.y) +
+                                   ") is outside the " + std::to_string(rows) + " x " + std::to_string(columns) + " maze");
+                return;
+            }
+            unsigned char walls = (unsigned char)(SEEN | cell.left * LEFT | cell.right * RIGHT | cell.up * UP | cell.down * DOWN);
+            if (cells[(size_t)(cell.y * columns + cell.x)].exchange(walls, std::memory_order_relaxed) != 0) {
+                lineProblem.report(p - data, "cell " + cell_name((int)cell.x, (int)cell.y) + " appears more than once");
+                return;
+            }
+            p = lineEnd == fileEnd ? fileEnd : lineEnd + 1;
+        }
+    });
+    if (lineProblem.found()) {
+        long long line = 1 + std::count(data, data + lineProblem.where(), '\n');
+        throw std::runtime_error(filename + " line " + std::to_string(line) + ": " + lineProblem.what());
+    }
+
+    // Every cell against its neighbours, by bands of rows, writing the grid on the way
+    MazeGrid maze((int)rows, (int)columns);
+    FirstProblem cellProblem;
+    const int bandCount = (int)std::min(rows, (long long)threads * 4);
+    parallel_for_stealing((size_t)bandCount, threads, [&](size_t band) {
+        int y0 = (int)(rows * band / bandCount), y1 = (int)(rows * (band + 1) / bandCount);
+        for (int y = y0; y < y1; y++) {
+            if (cellProblem.foundBefore((long long)y0 * columns)) {
+                return;
+            }
+            uint64_t * rightWalls = maze.rightWalls(y);
+            uint64_t * upWalls = maze.upWalls(y);
+            const std::atomic<unsigned char> * row = &cells[(size_t)y * columns];
+            for (int x = 0; x < (int)columns; x++) {
+                unsigned char walls = row[x].load(std::memory_order_relaxed);
+                std::string problem;
+                if (walls == 0) {
+                    problem = "cell " + cell_name(x, y) + " is missing";
+                }
+                else if ((x == 0 && !(walls & LEFT)) || (x == columns - 1 && !(walls & RIGHT)) ||
+                         (y == 0 && !(walls & DOWN)) || (y == rows - 1 && !(walls & UP))) {
+                    problem = "cell " + cell_name(x, y) + " has an open wall on the outer border";
+                }
+                else if (x + 1 < columns) {
+                    unsigned char right = row[x + 1].load(std::memory_order_relaxed);
+                    if ((right & SEEN) && ((right & LEFT) != 0) != ((walls & RIGHT) != 0)) {
+                        problem = "cell " + cell_name(x, y) + " has r=" + ((walls & RIGHT) ? "1" : "0") + " but cell " +
+                                  cell_name(x + 1, y) + " has l=" + ((right & LEFT) ? "1" : "0");
+                    }
+                }
+                if (problem.empty() && y + 1 < rows) {
+                    unsigned char above = row[x + columns].load(std::memory_order_relaxed);
+                    if ((above & SEEN) && ((above & DOWN) != 0) != ((walls & UP) != 0)) {
+                        problem = "cell " + cell_name(x, y) + " has u=" + ((walls & UP) ? "1" : "0") + " but cell " +
+                                  cell_name(x, y + 1) + " has d=" + ((above & DOWN) ? "1" : "0");
+                    }
+                }
+                if (!problem.empty()) {
+                    cellProblem.report((long long)y * columns + x, filename + ": " + problem);
+                    return;
+                }
+                uint64_t bit = (uint64_t)1 << (x & 63);
+                if (!(walls & RIGHT)) rightWalls[x >> 6] &= ~bit;
+                if (!(walls & UP)) upWalls[x >> 6] &= ~bit;
+            }
+        }
+    });
+    if (cellProblem.found()) {
+        throw std::runtime_error(cellProblem.what());
+    }
+    return maze;
+}
+
+// Check that the walls a wall-plane file stores for the outer border are there: the right wall of
+// the last column, every up wall of the top row, and the padding bits past the last column of
+// every row. The grid itself treats the border as closed, so these bits are only ever seen by
+// code that works on whole wall words, like the flood fill. Throws on the first one that is open.
+inline void validate_stored_border(const MazeGrid & maze, const std::string & name)
+{
+    const int rows = maze.rows(), columns = maze.columns();
+    if (maze.cellCount() == 0) {
+        return;
+    }
+    const size_t stride = maze.wordsPerRow();
+    const size_t last = stride - 1;
+    // Bits of the last word from the last column on, and past the last column
+    const uint64_t rightBorder = ~bits_below((long long)columns - 1 - (long long)last * 64);
+    const uint64_t padding = ~bits_below((long long)columns - (long long)last * 64);
+    // Report the lowest open bit of word w of row y
+    auto fail = [&](int y, size_t w, uint64_t open) {
+        int x = (int)(w * 64) + lowest_bit(open);
+        if (x < columns) {
+            throw std::runtime_error(name + ": cell " + cell_name(x, y) + " has an open wall on the outer border");
+        }
+        throw std::runtime_error(name + ": row " + std::to_string(y) + " has open padding walls past the last column");
+    };
+    for (int y = 0; y < rows; y++) {
+        uint64_t openRight = ~maze.rightWalls(y)[last] & rightBorder;
+        if (openRight != 0) {
+            fail(y, last, openRight);
+        }
+        const uint64_t * upWalls = maze.upWalls(y);
+        for (size_t w = y == rows - 1 ? 0 : last; w < stride; w++) {
+            uint64_t openUp = ~upWalls[w] & (y == rows - 1 ? ~(uint64_t)0 : padding);
+            if (openUp != 0) {
+                fail(y, w, openUp);
+            }
+        }
+    }
+}
+
+// Validate a maze file of any format. Text files get every check. Binary and compressed files
+// store each wall once, so their headers, the stored border and padding walls and whether the
+// maze is perfect are what can be wrong.
+inline maze_validation validate_maze_file(const std::string & filename, int threads)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    maze_validation result;
+    if (is_binary_maze_file(filename) || is_compressed_maze_file(filename)) {
+        MazeFile file(filename);
+        validate_stored_border(file.grid(), filename);
+        result.openPassages = validate_perfect_maze(file.grid(), threads, filename);
+        result.rows = file.grid().rows();
+        result.columns = file.grid().columns();
+    }
+    else {
+        MazeGrid maze = validate_text_maze(filename, threads);
+        result.openPassages = validate_perfect_maze(maze, threads, filename);
+        result.rows = maze.rows();
+        result.columns = maze.columns();
+    }
+    result.cells = (long long)result.rows * result.columns;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+#endif /* MazeValidator_h */
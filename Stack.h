@@ -10,80 +10,311 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
 
-// Template class representing a stack data structure
+// Memory arena that stacks can take their storage from.
+// Memory is handed out from large blocks and is never given back one allocation at a time;
+// everything is released together by reset() or by the destructor. Stacks that are created
+// and thrown away over and over (one per maze, one per query) can then share the same blocks
+// instead of going back to the heap every time.
+// The arena must outlive every stack that uses it, and reset() may only be called once none of
+// them hold elements any more.
+class StackArena
+{
+public:
+    //Constructor
+    explicit StackArena(size_t blockSize = 1 << 20)
+        : firstBlock(NULL), currentBlock(NULL), defaultBlockSize(blockSize) {}
+
+    //Destructor
+    ~StackArena() {
+        while (firstBlock != NULL) {
+            Block * next = firstBlock->next;
+            ::operator delete(firstBlock);
+            firstBlock = next;
+        }
+    }
+
+    // Hand out bytes aligned to alignment, opening a new block when the current one is full
+    void * allocate(size_t bytes, size_t alignment)
+    {
+        Block * block = currentBlock;
+        while (block != NULL) {
+            uintptr_t start = reinterpret_cast<uintptr_t>(block->data());
+            size_t offset = ((start + block->used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - start;
+            if (offset + bytes <= block->size) {
+                block->used = offset + bytes;
+                currentBlock = block;
+                return block->data() + offset;
+            }
+            block = block->next;
+        }
+        // No block left with enough room: chain a new one at the end
+        size_t size = bytes + alignment > defaultBlockSize ? bytes + alignment : defaultBlockSize;
+        Block * newBlock = new (::operator new(sizeof(Block) + size)) Block(size);
+        if (currentBlock == NULL) {
+            firstBlock = newBlock;
+        }
+        else {
+            Block * last = currentBlock;
+            while (last->next != NULL) {
+                last = last->next;
+            }
+            last->next = newBlock;
+        }
+        currentBlock = newBlock;
+        return allocate(bytes, alignment);
+    }
+
+    // Make all blocks available again without freeing them
+    void reset()
+    {
+        for (Block * block = firstBlock; block != NULL; block = block->next) {
+            block->used = 0;
+        }
+        currentBlock = firstBlock;
+    }
+
+    // Number of bytes currently handed out
+    size_t bytesUsed() const
+    {
+        size_t total = 0;
+        for (Block * block = firstBlock; block != NULL; block = block->next) {
+            total += block->used;
+        }
+        return total;
+    }
+
+private:
+    // Header placed in front of every block's memory
+    struct Block
+    {
+        size_t size;
+        size_t used;
+        Block *next;
+        Block(size_t theSize) : size(theSize), used(0), next(NULL) {}
+        char * data() { return reinterpret_cast<char *>(this + 1); }
+    };
+
+    Block *firstBlock;
+    Block *currentBlock;
+    size_t defaultBlockSize;
+
+    StackArena(const StackArena &);
+    StackArena & operator=(const StackArena &);
+};
+
+// Template class representing a stack data structure.
+// Elements are kept in one contiguous buffer that doubles when it is full, so push and pop
+// do not touch the allocator in the steady state. The buffer comes from the heap, or from a
+// StackArena when one is passed to the constructor.
 template <class Object>
 class Stack
 {
 public:
     //Constructor
-    Stack() {
-        topOfStack = NULL;
+    Stack() : elements(NULL), count(0), capacityOfStack(0), arena(NULL) {}
+
+    // Constructor for a stack whose storage is taken from the given arena
+    explicit Stack(StackArena & theArena) : elements(NULL), count(0), capacityOfStack(0), arena(&theArena) {}
+
+    //Copy constructor, the copy uses the same arena as the original
+    Stack(const Stack &other) : elements(NULL), count(0), capacityOfStack(0), arena(other.arena) {
+        reserve(other.count);
+        for (size_t i = 0; i < other.count; i++) {
+            new (elements + i) Object(other.elements[i]);
+        }
+        count = other.count;
+    }
+
+    //Move constructor, takes over the buffer of the other stack
+    Stack(Stack &&other) : elements(other.elements), count(other.count), capacityOfStack(other.capacityOfStack), arena(other.arena) {
+        other.elements = NULL;
+        other.count = 0;
+        other.capacityOfStack = 0;
+    }
+
+    //Assignment operators
+    Stack & operator=(const Stack &other) {
+        if (this != &other) {
+            Stack copy(other);
+            swap(copy);
+        }
+        return *this;
     }
- 
-//Destructor
+
+    Stack & operator=(Stack &&other) {
+        if (this != &other) {
+            Stack moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    //Destructor
     ~Stack() {
-        while (!isEmpty())
-            pop();
+        clear();
+        release(elements);
     }
-    
+
     //Member function to check if the stack is empty
     bool isEmpty() const {
-        return (topOfStack == nullptr);
+        return (count == 0);
+    }
+
+    // Number of elements in the stack
+    size_t size() const {
+        return count;
+    }
+
+    // Number of elements the stack can hold before its buffer has to grow
+    size_t capacity() const {
+        return capacityOfStack;
     }
-    
-    
-    
+
+    // Make room for at least n elements
+    void reserve(size_t n)
+    {
+        if (n <= capacityOfStack)
+        {
+            return;
+        }
+        Object * newElements = static_cast<Object *>(acquire(n));
+        for (size_t i = 0; i < count; i++) {
+            new (newElements + i) Object(std::move(elements[i]));
+            elements[i].~Object();
+        }
+        release(elements);
+        elements = newElements;
+        capacityOfStack = n;
+    }
+
     // Member function to pop up elements from the stack
     void pop()
     {
         if (!isEmpty())
         {
-            ListNode * newTop = topOfStack->next;
-            delete topOfStack;
-            topOfStack = newTop;
-            
+            count--;
+            elements[count].~Object();
         }
     }
+
+    // Pop every element, keeping the buffer for later pushes
+    void clear()
+    {
+        while (!isEmpty())
+            pop();
+    }
+
     // Insert x into stack
     void push(const Object &x) {
-        topOfStack = new ListNode(x, topOfStack);
+        if (count == capacityOfStack) {
+            // x may live inside the buffer that is about to move
+            Object copy(x);
+            grow();
+            new (elements + count) Object(std::move(copy));
+        }
+        else {
+            new (elements + count) Object(x);
+        }
+        count++;
+    }
+
+    void push(Object &&x) {
+        if (count == capacityOfStack) {
+            Object moved(std::move(x));
+            grow();
+            new (elements + count) Object(std::move(moved));
+        }
+        else {
+            new (elements + count) Object(std::move(x));
+        }
+        count++;
+    }
+
+    // Construct a new top element in place from the given constructor arguments
+    template <class... Args>
+    void emplace(Args &&... args) {
+        if (count == capacityOfStack) {
+            // The arguments may refer to elements of the buffer that is about to move
+            Object element(std::forward<Args>(args)...);
+            grow();
+            new (elements + count) Object(std::move(element));
+        }
+        else {
+            new (elements + count) Object(std::forward<Args>(args)...);
+        }
+        count++;
     }
-    
-    // Return the top element of the stack
+
+    // Return the top element of the stack (the stack must not be empty)
     const Object &top() const
     {
-        if (!isEmpty())
-        {
-            return topOfStack->element;
-        }
-        return topOfStack->element;
+        return elements[count - 1];
+    }
+
+    Object &top()
+    {
+        return elements[count - 1];
     }
-  
+
     // Member function to set the attributes of the top element based on the given direction
     void setTop(int direction)
     {
         if (!isEmpty())
         {
-            if(direction == 1){topOfStack->element.left = false;}
-            else if(direction == 2) {topOfStack->element.right = false;}
-            else if(direction == 3) {topOfStack->element.up =false;}
-            else if(direction == 4) {topOfStack->element.down = false;}
+            Object & element = elements[count - 1];
+            if(direction == 1){element.left = false;}
+            else if(direction == 2) {element.right = false;}
+            else if(direction == 3) {element.up =false;}
+            else if(direction == 4) {element.down = false;}
         }
     }
 
+    // Exchange the contents of two stacks
+    void swap(Stack &other)
+    {
+        std::swap(elements, other.elements);
+        std::swap(count, other.count);
+        std::swap(capacityOfStack, other.capacityOfStack);
+        std::swap(arena, other.arena);
+    }
+
 private:
-    // Struct representing a node in the stack
-    struct ListNode
+    // Double the buffer (starting from 16 elements)
+    void grow()
     {
-        Object element;
-        ListNode *next;
-        // Constructor for a ListNode with given element and next node
-        ListNode(const Object &theElement, ListNode *n = NULL)
-            : element(theElement), next(n) {}
-    };
-    // Pointer to the top of the stack
-    ListNode *topOfStack;
+        reserve(capacityOfStack == 0 ? 16 : capacityOfStack * 2);
+    }
+
+    // Raw storage for n elements from the arena or the heap
+    void * acquire(size_t n)
+    {
+        if (arena != NULL)
+        {
+            return arena->allocate(n * sizeof(Object), alignof(Object));
+        }
+        return ::operator new(n * sizeof(Object));
+    }
+
+    // Give storage back; arena memory is only released by the arena itself
+    void release(Object * buffer)
+    {
+        if (arena == NULL)
+        {
+            ::operator delete(buffer);
+        }
+    }
+
+    // Contiguous buffer holding the elements, the top is elements[count - 1]
+    Object *elements;
+    size_t count;
+    size_t capacityOfStack;
+    // Arena the buffer comes from, NULL for the heap
+    StackArena *arena;
 };
 
 
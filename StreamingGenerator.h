@@ -0,0 +1,274 @@
+//
+//  StreamingGenerator.h
+//
+//  Streaming maze generation with Eller's algorithm: the maze is produced one line at a time
+//  and written out immediately, keeping only O(line length) state in memory.
+//
+
+#ifndef StreamingGenerator_h
+#define StreamingGenerator_h
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+#include "MazeGrid.h"
+#include "MazeFile.h"
+
+// Root of a label in the union-find of one line, with path halving
+inline int find_set(std::vector<int> & parent, int label) {
+    while (parent[label] != label) {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+// Eller's algorithm over lineCount lines of lineLength cells.
+// Cells of the current line carry the label of the set (connected part of the maze generated so
+// far) they belong to. Neighbours in different sets are joined at random, then every set opens
+// at least one passage to the next line; the last line joins whatever sets are left. The result
+// is a perfect maze.
+//
+// For every line sink(line, along, across) is called once:
+//   along[c]  is 1 when cells c and c+1 of the line are connected (c < lineLength - 1)
+//   across[c] is 1 when cell c is connected to cell c of the next line (always 0 on the last line)
+//
+// rnd needs RandInt(low, high) and choice(count) (MazeRandom).
+template <class Random, class LineSink>
+void eller_generate(int lineCount, int lineLength, Random & rnd, LineSink & sink)
+{
+    const int NONE = -1;
+    std::vector<int> label(lineLength, NONE);          // Set label of every cell of the line
+    std::vector<int> parent(2 * (size_t)lineLength);   // Union-find over the labels of one line
+    std::vector<int> relabel(2 * (size_t)lineLength);  // Label a set carries over to the next line
+    std::vector<int> members(2 * (size_t)lineLength);  // Cells of a set seen so far (reservoir sampling)
+    std::vector<int> chosen(2 * (size_t)lineLength);   // Cell a set opens downwards if nothing else does
+    std::vector<unsigned char> hasPassage(2 * (size_t)lineLength);
+    std::vector<unsigned char> along(lineLength, 0);
+    std::vector<unsigned char> across(lineLength, 0);
+
+    for (int line = 0; line < lineCount; line++) {
+        bool last = (line == lineCount - 1);
+
+        // Carried labels are below lineLength, cells without a set get a fresh one above it
+        for (int c = 0; c < lineLength; c++) {
+            if (label[c] == NONE) {
+                label[c] = lineLength + c;
+            }
+        }
+        for (size_t i = 0; i < parent.size(); i++) {
+            parent[i] = (int)i;
+        }
+
+        // Join neighbours that are in different sets, at random (always on the last line)
+        for (int c = 0; c + 1 < lineLength; c++) {
+            int a = find_set(parent, label[c]);
+            int b = find_set(parent, label[c + 1]);
+            along[c] = 0;
+            if (a != b && (last || rnd.choice(2) == 1)) {
+                parent[b] = a;
+                along[c] = 1;
+            }
+        }
+        if (lineLength > 0) {
+            along[lineLength - 1] = 0;
+        }
+
+        if (last) {
+            std::fill(across.begin(), across.end(), 0);
+            sink(line, along, across);
+            break;
+        }
+
+        // Open passages to the next line at random, then make sure every set has one
+        for (int c = 0; c < lineLength; c++) {
+            label[c] = find_set(parent, label[c]);
+        }
+        std::fill(members.begin(), members.end(), 0);
+        std::fill(hasPassage.begin(), hasPassage.end(), 0);
+        for (int c = 0; c < lineLength; c++) {
+            int set = label[c];
+            across[c] = (unsigned char)rnd.choice(2);
+            if (across[c]) {
+                hasPassage[set] = 1;
+            }
+            members[set]++;
+            if (members[set] == 1 || rnd.RandInt(0, members[set] - 1) == 0) {
+                chosen[set] = c;
+            }
+        }
+        for (int c = 0; c < lineLength; c++) {
+            int set = label[c];
+            if (!hasPassage[set]) {
+                across[chosen[set]] = 1;
+                hasPassage[set] = 1;
+            }
+        }
+
+        sink(line, along, across);
+
+        // Cells reached from above keep their set (renumbered below lineLength), the others start over
+        std::fill(relabel.begin(), relabel.end(), NONE);
+        int nextLabel = 0;
+        for (int c = 0; c < lineLength; c++) {
+            if (across[c]) {
+                int set = label[c];
+                if (relabel[set] == NONE) {
+                    relabel[set] = nextLabel++;
+                }
+                label[c] = relabel[set];
+            }
+            else {
+                label[c] = NONE;
+            }
+        }
+    }
+}
+
+// Writes the lines of a streamed maze as rows of the binary format.
+// Lines run along x, so every line is one row of the grid and goes out as soon as it is made.
+// finish() flushes the file once the last row is in and reports a failed write.
+class BinaryRowWriter
+{
+public:
+    BinaryRowWriter(const std::string & filename, int rows, int columns, uint64_t seed, uint32_t algorithm)
+        : outFile(filename, std::ios::binary), name(filename), columnCount(columns),
+          rightWords(MazeGrid::wordsPerRowFor(columns)), upWords(MazeGrid::wordsPerRowFor(columns))
+    {
+        // The header only needs the dimensions, a grid with no rows allocated gives the same values
+        maze_file_header header = make_maze_header(MazeGrid(0, columns), seed, algorithm);
+        header.rows = (uint32_t)rows;
+        header.wall_words = (uint64_t)rows * 2 * header.words_per_row;
+        outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + filename);
+        }
+    }
+
+    void operator()(int, const std::vector<unsigned char> & along, const std::vector<unsigned char> & across)
+    {
+        std::fill(rightWords.begin(), rightWords.end(), ~(uint64_t)0);
+        std::fill(upWords.begin(), upWords.end(), ~(uint64_t)0);
+        for (int x = 0; x < columnCount; x++) {
+            if (along[x]) rightWords[x >> 6] &= ~((uint64_t)1 << (x & 63));
+            if (across[x]) upWords[x >> 6] &= ~((uint64_t)1 << (x & 63));
+        }
+        outFile.write(reinterpret_cast<const char *>(rightWords.data()), (std::streamsize)(rightWords.size() * sizeof(uint64_t)));
+        outFile.write(reinterpret_cast<const char *>(upWords.data()), (std::streamsize)(upWords.size() * sizeof(uint64_t)));
+    }
+
+    void finish()
+    {
+        outFile.flush();
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + name);
+        }
+    }
+
+private:
+    std::ofstream outFile;
+    std::string name;
+    int columnCount;
+    std::vector<uint64_t> rightWords;
+    std::vector<uint64_t> upWords;
+};
+
+// Sink for eller_generate that appends each row to a compressed maze file (row = y, from 0 up).
+// finish() flushes the encoder once the last row is in.
+class CompressedRowWriter
+{
+public:
+    CompressedRowWriter(const std::string & filename, int rows, int columns, uint64_t seed, uint32_t algorithm)
+        : outFile(filename, rows, columns, seed, algorithm), columnCount(columns),
+          rightWords(MazeGrid::wordsPerRowFor(columns)), upWords(MazeGrid::wordsPerRowFor(columns))
+    {
+    }
+
+    void operator()(int, const std::vector<unsigned char> & along, const std::vector<unsigned char> & across)
+    {
+        std::fill(rightWords.begin(), rightWords.end(), ~(uint64_t)0);
+        std::fill(upWords.begin(), upWords.end(), ~(uint64_t)0);
+        for (int x = 0; x < columnCount; x++) {
+            if (along[x]) rightWords[x >> 6] &= ~((uint64_t)1 << (x & 63));
+            if (across[x]) upWords[x >> 6] &= ~((uint64_t)1 << (x & 63));
+        }
+        outFile.writeRow(rightWords.data(), upWords.data());
+    }
+
+    void finish() { outFile.finish(); }
+
+private:
+    CompressedMazeWriter outFile;
+    int columnCount;
+    std::vector<uint64_t> rightWords;
+    std::vector<uint64_t> upWords;
+};
+
+// Writes the lines of a streamed maze in the text format.
+// The text file lists the cells column by column, so here a line is one column of the maze
+// (along = up walls inside the column, across = right walls to the next column). Only the
+// previous column is kept, for the left walls. finish() flushes the file and reports a failed write.
+class TextColumnWriter
+{
+public:
+    TextColumnWriter(const std::string & filename, int rows, int columns, uint64_t seed, uint32_t algorithm)
+        : outFile(filename), name(filename), rowCount(rows), openLeft(rows, 0)
+    {
+        outFile << rows << " " << columns << " " << seed << " " << algorithm << '\n';
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + filename);
+        }
+    }
+
+    void operator()(int x, const std::vector<unsigned char> & along, const std::vector<unsigned char> & across)
+    {
+        for (int y = 0; y < rowCount; y++) {
+            bool left = !openLeft[y];
+            bool right = !across[y];
+            bool up = !along[y];
+            bool down = (y == 0) || !along[y - 1];
+            outFile << "x=" << x << " y=" << y << " l=" << left << " r=" << right << " u=" << up << " d=" << down << '\n';
+        }
+        openLeft = across;
+    }
+
+    void finish()
+    {
+        outFile.flush();
+        if (!outFile) {
+            throw std::runtime_error("cannot write " + name);
+        }
+    }
+
+private:
+    std::ofstream outFile;
+    std::string name;
+    int rowCount;
+    std::vector<unsigned char> openLeft;
+};
+
+// Generate a rows x columns maze with Eller's algorithm straight into a maze file.
+// Memory stays proportional to the columns (binary, compressed) or rows (text), whatever the size of the maze.
+template <class Random>
+void streaming_maze_generator(int rows, int columns, const std::string & filename, maze_file_format format, Random & rnd, uint64_t seed = 0)
+{
+    check_maze_size(rows, columns);
+    if (format == MAZE_FORMAT_BINARY) {
+        BinaryRowWriter writer(filename, rows, columns, seed, MAZE_ALGORITHM_ELLER);
+        eller_generate(rows, columns, rnd, writer);
+        writer.finish();
+    }
+    else if (format == MAZE_FORMAT_COMPRESSED) {
+        CompressedRowWriter writer(filename, rows, columns, seed, MAZE_ALGORITHM_ELLER);
+        eller_generate(rows, columns, rnd, writer);
+        writer.finish();
+    }
+    else {
+        TextColumnWriter writer(filename, rows, columns, seed, MAZE_ALGORITHM_ELLER);
+        eller_generate(columns, rows, rnd, writer);
+        writer.finish();
+    }
+}
+
+#endif /* StreamingGenerator_h */
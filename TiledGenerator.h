@@ -0,0 +1,161 @@
+//
+//  TiledGenerator.h
+//
+//  Generates one large maze on several threads: the grid is cut into tiles, every tile gets a
+//  maze of its own in parallel, and the tiles are then joined into a single perfect maze.
+//
+
+#ifndef TiledGenerator_h
+#define TiledGenerator_h
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <cstdint>
+#include "MazeGrid.h"
+#include "MazeFile.h"
+#include "MazeRandom.h"
+#include "MazeGeneration.h"
+#include "WorkStealing.h"
+#include "MazeStats.h"
+
+// Union-find over the tiles, used to join them without creating a loop
+class TileSets
+{
+public:
+    explicit TileSets(size_t count) : parent(count), rank(count, 0) {
+        for (size_t i = 0; i < count; i++) {
+            parent[i] = i;
+        }
+    }
+
+    size_t find(size_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    // Join the sets of a and b, false if they were already one set
+    bool join(size_t a, size_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return false;
+        }
+        if (rank[a] < rank[b]) std::swap(a, b);
+        parent[b] = a;
+        if (rank[a] == rank[b]) rank[a]++;
+        return true;
+    }
+
+private:
+    std::vector<size_t> parent;
+    std::vector<unsigned char> rank;
+};
+
+// Generate a maze over the whole grid using tiles of tileSize x tileSize cells.
+//
+// Tile widths are rounded up to a multiple of 64 columns, so two tiles never write to the same
+// wall word and the tiles can be carved concurrently without locks. Each tile is a spanning tree
+// of its cells (recursive backtracker restricted to the tile). The stitch step then treats every
+// tile as one node: the borders between neighbouring tiles are shuffled and, Kruskal style, a
+// border gets one random opening only if it joins two tiles that are not yet connected. A
+// spanning tree of spanning trees joined by single passages is again a spanning tree, so the
+// maze is perfect.
+//
+// The generator seeded with seed does the stitching; tile t uses a copy of it jumped t + 1 times
+// (2^128 steps each), so the streams never overlap and the result is the same for any number
+// of threads.
+inline void generate_tiled_maze(MazeGrid & maze, uint64_t seed, int tileSize, int threads) {
+    int rows = maze.rows(), columns = maze.columns();
+    if (rows == 0 || columns == 0) {
+        return;
+    }
+    int tileWidth = std::max(64, (tileSize + 63) / 64 * 64);
+    int tileHeight = std::max(1, tileSize);
+    int tilesAcross = (columns + tileWidth - 1) / tileWidth;
+    int tilesUp = (rows + tileHeight - 1) / tileHeight;
+    size_t tileCount = (size_t)tilesAcross * tilesUp;
+
+    // One stream per tile, each a jump further along the stitch stream
+    MazeRandom rnd(seed);
+    std::vector<MazeRandom> streams(tileCount, rnd);
+    MazeRandom jumped = rnd;
+    for (size_t t = 0; t < tileCount; t++) {
+        jumped.jump();
+        streams[t] = jumped;
+    }
+
+    // Carve every tile in parallel. The counters of each tile are gathered for the calling
+    // thread, whichever thread carved it.
+    std::mutex statsLock;
+    maze_stats tileStats = maze_stats();
+    parallel_for_stealing(tileCount, threads, [&](size_t t) {
+        int tx = (int)(t % tilesAcross), ty = (int)(t / tilesAcross);
+        int x0 = tx * tileWidth, y0 = ty * tileHeight;
+        maze_stats saved = current_maze_stats();
+        reset_maze_stats();
+        generate_maze_region(maze, x0, y0, std::min(tileWidth, columns - x0), std::min(tileHeight, rows - y0), streams[t]);
+        {
+            std::lock_guard<std::mutex> guard(statsLock);
+            add_maze_stats(tileStats, current_maze_stats());
+        }
+        current_maze_stats() = saved;
+    });
+    add_maze_stats(current_maze_stats(), tileStats);
+
+    // Borders between neighbouring tiles: tile index and 0 for the border on its right, 1 for the one above
+    std::vector<uint64_t> borders;
+    for (int ty = 0; ty < tilesUp; ty++) {
+        for (int tx = 0; tx < tilesAcross; tx++) {
+            uint64_t t = (uint64_t)ty * tilesAcross + tx;
+            if (tx + 1 < tilesAcross) borders.push_back(t * 2);
+            if (ty + 1 < tilesUp) borders.push_back(t * 2 + 1);
+        }
+    }
+
+    // Shuffle the borders (Fisher-Yates) and open one passage through each border that joins two separate parts
+    for (size_t i = borders.size(); i > 1; i--) {
+        size_t j = (size_t)(rnd.next() % i);
+        std::swap(borders[i - 1], borders[j]);
+    }
+    TileSets sets(tileCount);
+    for (size_t i = 0; i < borders.size(); i++) {
+        uint64_t t = borders[i] / 2;
+        bool above = (borders[i] % 2) == 1;
+        int tx = (int)(t % tilesAcross), ty = (int)(t / tilesAcross);
+        int x0 = tx * tileWidth, y0 = ty * tileHeight;
+        if (!above) {
+            if (sets.join(t, t + 1)) {
+                // Right wall of the tile's last column, at a random row of the tile
+                int y = y0 + rnd.RandInt(0, std::min(tileHeight, rows - y0) - 1);
+                maze.removeWall(x0 + tileWidth - 1, y, DIR_RIGHT);
+            }
+        }
+        else if (sets.join(t, t + tilesAcross)) {
+            // Up wall of the tile's top row, at a random column of the tile
+            int x = x0 + rnd.RandInt(0, std::min(tileWidth, columns - x0) - 1);
+            maze.removeWall(x, y0 + tileHeight - 1, DIR_UP);
+        }
+    }
+}
+
+// Generate one maze on several threads and write it to maze_<mazeID>.txt (or .bin)
+inline void tiled_maze_generator(int row, int column, int mazeID, maze_file_format format, uint64_t globalSeed, int tileSize, int threads) {
+    check_maze_size(row, column);
+    reset_maze_stats();
+    uint64_t seed = maze_seed(globalSeed, mazeID);
+    MazeGrid maze(row, column);
+    {
+        MAZE_STAT_TIMER(generate_seconds);
+        generate_tiled_maze(maze, seed, tileSize, threads);
+    }
+    {
+        MAZE_STAT_TIMER(write_seconds);
+        writing_output_file(maze, mazeID, format, seed, MAZE_ALGORITHM_TILED_BACKTRACKER);
+    }
+    MazeStatsLog::report(mazeID, "generate", row, column);
+}
+
+#endif /* TiledGenerator_h */
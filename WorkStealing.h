@@ -0,0 +1,115 @@
+//
+//  WorkStealing.h
+//
+//  Runs a range of independent tasks on several threads. Every thread owns a queue of task
+//  indices and takes work from the back of it; a thread whose queue is empty steals from the
+//  front of another thread's queue, so uneven tasks still keep all threads busy.
+//
+
+#ifndef WorkStealing_h
+#define WorkStealing_h
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <cstddef>
+
+// Number of threads to use when the caller asks for 0 (all hardware threads)
+inline int default_thread_count(int requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : (int)hardware;
+}
+
+// Call task(i) for every i in [0, count) on the given number of threads and wait for all of them.
+// Each thread starts with a contiguous block of indices. If a task throws, the remaining tasks
+// are skipped and the first exception is rethrown here.
+template <class Task>
+void parallel_for_stealing(size_t count, int threads, Task task)
+{
+    threads = default_thread_count(threads);
+    if ((size_t)threads > count) {
+        threads = count == 0 ? 1 : (int)count;
+    }
+    if (threads == 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    // Queue of task indices owned by one thread
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<size_t> indices;
+    };
+    std::vector<WorkQueue> queues(threads);
+    for (int t = 0; t < threads; t++) {
+        size_t begin = count * t / threads, end = count * (t + 1) / threads;
+        for (size_t i = begin; i < end; i++) {
+            queues[t].indices.push_back(i);
+        }
+    }
+
+    std::mutex errorLock;
+    std::exception_ptr firstError;
+    std::atomic<bool> failed(false);
+
+    // Take the next index of thread t: its own queue first, then the other queues
+    auto take = [&](int t, size_t & index) -> bool {
+        {
+            std::lock_guard<std::mutex> guard(queues[t].lock);
+            if (!queues[t].indices.empty()) {
+                index = queues[t].indices.back();
+                queues[t].indices.pop_back();
+                return true;
+            }
+        }
+        for (int k = 1; k < threads; k++) {
+            WorkQueue & victim = queues[(t + k) % threads];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.indices.empty()) {
+                index = victim.indices.front();
+                victim.indices.pop_front();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto worker = [&](int t) {
+        size_t index;
+        while (!failed.load(std::memory_order_relaxed) && take(t, index)) {
+            try {
+                task(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> guard(errorLock);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+                failed = true;
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.push_back(std::thread(worker, t));
+    }
+    worker(0);
+    for (size_t t = 0; t < pool.size(); t++) {
+        pool[t].join();
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+#endif /* WorkStealing_h */